@@ -0,0 +1,123 @@
+/*
+ * Micro-benchmark hote: ancien filtre (copie + tri par selection, somme
+ * complete) contre SlidingMedian / MovingAverage, en ns par echantillon.
+ * Verifie aussi que les deux implementations donnent les memes sorties.
+ *
+ * Depuis Ruches/:
+ *   g++ -O2 -std=gnu++11 -Ilib/RucheFilters/src bench/filter_bench.cpp -o filter_bench
+ *   ./filter_bench
+ */
+
+#include <MovingAverage.h>
+#include <SlidingMedian.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Reproduction de l'ancien medianFilter() de main.cpp.
+template <uint16_t N>
+struct LegacyMedian {
+    float window[N];
+    uint16_t index = 0;
+    uint16_t count = 0;
+
+    float push(float raw) {
+        window[index] = raw;
+        index = (index + 1) % N;
+        if (count < N) count++;
+        float tmp[N];
+        for (uint16_t i = 0; i < count; i++) tmp[i] = window[i];
+        for (uint16_t i = 0; i < count; i++) {
+            for (uint16_t j = i + 1; j < count; j++) {
+                if (tmp[j] < tmp[i]) {
+                    float t = tmp[i];
+                    tmp[i] = tmp[j];
+                    tmp[j] = t;
+                }
+            }
+        }
+        return tmp[count / 2];
+    }
+};
+
+// Reproduction de la moyenne de l'ancien filterWeight().
+template <uint16_t N>
+struct LegacyAverage {
+    float window[N];
+    uint16_t index = 0;
+    uint16_t count = 0;
+
+    float push(float raw) {
+        window[index] = raw;
+        index = (index + 1) % N;
+        if (count < N) count++;
+        float sum = 0.0f;
+        for (uint16_t i = 0; i < count; i++) sum += window[i];
+        return sum / count;
+    }
+};
+
+// Trace synthetique: 25 kg + bruit, pics isoles et marches de charge.
+static void makeTrace(float* out, size_t n) {
+    srand(1234);
+    float base = 25000.0f;
+    for (size_t i = 0; i < n; i++) {
+        if (i % 5000 == 2500) base += (rand() % 2) ? 1500.0f : -1500.0f;
+        float noise = ((rand() % 2001) - 1000) / 100.0f;
+        float spike = (rand() % 200 == 0) ? 800.0f : 0.0f;
+        out[i] = base + noise + spike;
+    }
+}
+
+static double nowNs() {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static volatile float gSink;
+
+template <uint16_t N>
+static void benchSize(const float* trace, size_t n) {
+    static LegacyMedian<N> oldMed;
+    static LegacyAverage<N> oldAvg;
+    static SlidingMedian<N> newMed;
+    static MovingAverage<N> newAvg;
+    oldMed = LegacyMedian<N>();
+    oldAvg = LegacyAverage<N>();
+    newMed.reset();
+    newAvg.reset();
+
+    size_t medMismatch = 0;
+    float avgMaxErr = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        if (oldMed.push(trace[i]) != newMed.push(trace[i])) medMismatch++;
+        float e = fabsf(oldAvg.push(trace[i]) - newAvg.push(trace[i]));
+        if (e > avgMaxErr) avgMaxErr = e;
+    }
+
+    double t0 = nowNs();
+    float acc = 0.0f;
+    for (size_t i = 0; i < n; i++) acc += oldMed.push(trace[i]) + oldAvg.push(trace[i]);
+    double t1 = nowNs();
+    for (size_t i = 0; i < n; i++) acc += newMed.push(trace[i]) + newAvg.push(trace[i]);
+    double t2 = nowNs();
+    gSink = acc;
+
+    printf("N=%4u  ancien %9.1f ns/ech  nouveau %7.1f ns/ech  x%6.1f  mediane diff=%zu  moyenne err max=%.4f g\n",
+           (unsigned)N, (t1 - t0) / n, (t2 - t1) / n, (t1 - t0) / (t2 - t1), medMismatch, avgMaxErr);
+}
+
+int main() {
+    const size_t n = 200000;
+    static float trace[n];
+    makeTrace(trace, n);
+
+    benchSize<7>(trace, n);
+    benchSize<20>(trace, n);
+    benchSize<63>(trace, n);
+    benchSize<255>(trace, n);
+    return 0;
+}
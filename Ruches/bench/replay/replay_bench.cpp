@@ -0,0 +1,395 @@
+﻿/*
+ * Banc de rejeu hote de la chaine de poids (env PlatformIO "native").
+ *
+ * Rejoue des traces HX711 brutes (conversions horodatees) a travers le meme
+ * decoupage en lots et la meme chaine que taskHX711 (TrimmedBatchMean +
+ * HiveWeightConfig.h), avec stubs Hx711Sampler / FreeRTOS et horloge
+ * simulee, puis mesure:
+ *   - temps d'etablissement apres une marche de charge
+ *   - nombre de lots traites avant que stableWeight ne bouge
+ *   - declenchements d'envoi rapide injustifies (charge de reference stable)
+ *   - cout de traitement en ns par lot
+ * Sort en code 1 si un seuil est depasse: a lancer avant toute
+ * modification des constantes de StandardHiveParams.
+ *
+ * Format CSV (lignes '#' et en-tete ignores):
+ *   t_ms,raw_g[,ref_g]
+ * ref_g = charge reellement posee (annotation); sans elle seuls les
+ * declenchements et le cout sont rapportes. Les lignes "RAW,ms,g" de la
+ * commande serie r de l'emetteur sont acceptees telles quelles.
+ *
+ * Depuis Ruches/:
+ *   pio run -e native -t exec -a "--synth"
+ *   pio run -e native -t exec -a "traces/rucher.csv --max-settle-ms 6000"
+ * ou sans PlatformIO:
+ *   g++ -O2 -std=gnu++11 -Ibench/replay/stubs -Ilib/RucheFilters/src \
+ *       bench/replay/replay_bench.cpp -o replay_bench
+ */
+
+#include <Arduino.h>
+#include <Hx711Sampler.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <HiveWeightConfig.h>
+#include <TrimmedBatchMean.h>
+
+#include <chrono>
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+typedef StandardHiveParams WeightParams;
+typedef StandardHiveChain WeightChain;
+typedef StandardHiveTelemetryFilter TelemetryFilter;
+
+// Miroir des constantes de src/main.cpp (taskLoRa / demarrage).
+const uint32_t SEND_INTERVAL_MS = 15000;
+const uint32_t STARTUP_SETTLE_IGNORE_MS = 5000;
+
+// Une marche plus petite que 2 bandes mortes n'est pas resolue par la chaine.
+const float STEP_MIN_G = 2.0f * WeightParams::deadbandG;
+
+struct Trace {
+    std::vector<uint32_t> tMs;
+    std::vector<float> rawG;
+    std::vector<float> refG;
+    bool hasRef;
+};
+
+struct GateLimits {
+    uint32_t maxSettleMs;
+    float settleTolG;
+    uint32_t maxFalseTriggers;
+    double maxNsPerSample;   // 0 = pas de seuil (depend de la machine)
+};
+
+struct StepResult {
+    uint32_t atMs;
+    float fromG;
+    float toG;
+    long samplesToUpdate;   // -1: stableWeight n'a pas bouge avant la marche suivante
+    long settleMs;          // -1: jamais dans la tolerance
+};
+
+struct ReplayResult {
+    size_t processed;
+    uint32_t sends;
+    uint32_t fastTriggers;
+    uint32_t falseTriggers;
+    std::vector<StepResult> steps;
+    double nsPerSample;
+};
+
+// ===== Lecture des traces =====
+
+static bool loadCsv(const char* path, Trace& trace) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "Trace introuvable: %s\n", path);
+        return false;
+    }
+    trace.hasRef = true;
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char* p = line;
+        if (strncmp(p, "RAW,", 4) == 0) p += 4;
+        if (*p == '#' || !(isdigit((unsigned char)*p) || *p == '-')) continue;
+        char* end = NULL;
+        unsigned long t = strtoul(p, &end, 10);
+        if (end == p || *end != ',') continue;
+        p = end + 1;
+        float raw = strtof(p, &end);
+        if (end == p) continue;
+        float ref = NAN;
+        if (*end == ',') {
+            p = end + 1;
+            ref = strtof(p, &end);
+            if (end == p) ref = NAN;
+        }
+        if (isnan(ref)) trace.hasRef = false;
+        trace.tMs.push_back((uint32_t)t);
+        trace.rawG.push_back(raw);
+        trace.refG.push_back(ref);
+    }
+    fclose(f);
+    if (trace.tMs.empty()) {
+        fprintf(stderr, "Trace vide: %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Trace synthetique 10 SPS: 25 kg, bruit, pics isoles, legere derive,
+// marches franches, petites marches (activite) et rafales de vent sans
+// changement de charge.
+static void makeSyntheticTrace(Trace& trace) {
+    srand(20240611);
+    const uint32_t periodMs = 100;
+    const size_t n = 36000;   // 1 h
+    const float steps[] = {1500.0f, -1500.0f, 40.0f, -40.0f, 300.0f, -300.0f, 3000.0f, -3000.0f};
+    const size_t stepCount = sizeof(steps) / sizeof(steps[0]);
+    float ref = 25000.0f;
+    size_t nextStep = 0;
+    trace.hasRef = true;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t t = (uint32_t)(i * periodMs);
+        if (i > 0 && i % 3000 == 0 && nextStep < stepCount) {
+            ref += steps[nextStep++];
+        }
+        float noise = 0.0f;
+        for (int k = 0; k < 4; k++) noise += ((rand() % 2001) - 1000) / 1000.0f;
+        noise *= 3.5f;
+        float spike = (rand() % 300 == 0) ? 800.0f : 0.0f;
+        float drift = 6.0f * sinf((float)i / n * 6.2832f);
+        float gust = 0.0f;
+        if (i % 3000 >= 1500 && i % 3000 < 1530) {
+            gust = 150.0f * sinf((float)i * 1.7f);
+        }
+        trace.tMs.push_back(t);
+        trace.rawG.push_back(ref + noise + spike + drift + gust);
+        trace.refG.push_back(ref);
+    }
+}
+
+// ===== Rejeu =====
+
+static double nowNs() {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static volatile float gSink;
+
+static void replay(const Trace& trace, const GateLimits& limits, ReplayResult& out) {
+    static Hx711Sampler hx711;
+    static WeightChain weightChain;
+    static TelemetryFilter telemetryFilter;
+    TrimmedBatchMean batch;
+    weightChain.reset();
+    telemetryFilter.reset();
+    batch.reset();
+    hx711.load(&trace.tMs[0], &trace.rawG[0], trace.tMs.size());
+
+    out = ReplayResult();
+    std::vector<float> processedRaw;
+    processedRaw.reserve(trace.tMs.size());
+
+    replayClockMs() = trace.tMs[0];
+    const uint32_t bootMs = millis();
+    unsigned long nextBatchMs = millis() + WeightParams::samplePeriodMs;
+    bool startupReady = false;
+    float stableWeight = 0.0f;
+    float lastSentWeight = 0.0f;
+    bool lastSentWeightReady = false;
+    bool forceFastSend = false;
+    unsigned long previousMillis = millis();
+
+    float prevRef = NAN;
+    bool stepOpen = false;
+    float stableAtStep = 0.0f;
+    long samplesSinceStep = 0;
+
+    // Boucle calquee sur taskHX711 (un lot par periode, toutes les
+    // conversions du ring) + decision d'envoi de taskLoRa.
+    while (!hx711.finished()) {
+        long untilBatch = (long)(nextBatchMs - millis());
+        if (untilBatch > 0) vTaskDelay(pdMS_TO_TICKS(untilBatch));
+        unsigned long now = millis();
+        Hx711Sample smp;
+        while (hx711.pop(smp)) {
+            batch.add((float)smp.raw / REPLAY_CAL_FACTOR);
+        }
+        nextBatchMs += WeightParams::samplePeriodMs;
+        if (batch.count() > 0) {
+            float rawWeight = batch.mean();
+            batch.reset();
+            float ref = trace.refG[hx711.index() - 1];
+            processedRaw.push_back(rawWeight);
+            out.processed++;
+
+            stableWeight = weightChain.process(rawWeight);
+            telemetryFilter.process(stableWeight);
+            if (lastSentWeightReady && fabsf(stableWeight - lastSentWeight) >= WeightParams::fastChangeTriggerG) {
+                if (!forceFastSend) {
+                    out.fastTriggers++;
+                    // Injustifie si la valeur deja envoyee etait encore proche
+                    // de la charge reelle (bruit, vent, pic).
+                    if (trace.hasRef && fabsf(ref - lastSentWeight) < 0.5f * WeightParams::fastChangeTriggerG) {
+                        out.falseTriggers++;
+                    }
+                }
+                forceFastSend = true;
+            }
+            if (!startupReady && (now - bootMs) > STARTUP_SETTLE_IGNORE_MS) {
+                startupReady = true;
+                telemetryFilter.prime(stableWeight);
+            }
+
+            if (trace.hasRef) {
+                if (!isnan(prevRef) && fabsf(ref - prevRef) >= STEP_MIN_G) {
+                    StepResult step;
+                    step.atMs = now;
+                    step.fromG = prevRef;
+                    step.toG = ref;
+                    step.samplesToUpdate = -1;
+                    step.settleMs = -1;
+                    out.steps.push_back(step);
+                    stepOpen = true;
+                    stableAtStep = stableWeight;
+                    samplesSinceStep = 0;
+                }
+                prevRef = ref;
+                if (stepOpen) {
+                    StepResult& step = out.steps.back();
+                    samplesSinceStep++;
+                    if (step.samplesToUpdate < 0 && stableWeight != stableAtStep) {
+                        step.samplesToUpdate = samplesSinceStep;
+                    }
+                    if (step.settleMs < 0 && fabsf(stableWeight - ref) <= limits.settleTolG) {
+                        step.settleMs = (long)(now - step.atMs);
+                    }
+                    if (step.samplesToUpdate >= 0 && step.settleMs >= 0) stepOpen = false;
+                }
+            }
+
+            if (startupReady && (forceFastSend || (now - previousMillis >= SEND_INTERVAL_MS))) {
+                out.sends++;
+                forceFastSend = false;
+                lastSentWeight = stableWeight;
+                lastSentWeightReady = true;
+                previousMillis = now;
+            }
+        }
+    }
+
+    // Cout pur de la chaine (hors boucle simulee), repete pour la resolution.
+    double elapsed = 0.0;
+    size_t done = 0;
+    float acc = 0.0f;
+    while (elapsed < 2.0e8 && !processedRaw.empty()) {
+        weightChain.reset();
+        telemetryFilter.reset();
+        double t0 = nowNs();
+        for (size_t i = 0; i < processedRaw.size(); i++) {
+            acc += telemetryFilter.process(weightChain.process(processedRaw[i]));
+        }
+        elapsed += nowNs() - t0;
+        done += processedRaw.size();
+    }
+    gSink = acc;
+    out.nsPerSample = done ? elapsed / done : 0.0;
+}
+
+// ===== Rapport =====
+
+static bool report(const char* name, const Trace& trace, const ReplayResult& r, const GateLimits& limits) {
+    bool ok = true;
+    printf("== %s: %zu conversions, %zu lots, %.1f min\n", name, trace.tMs.size(), r.processed,
+           (trace.tMs.back() - trace.tMs.front()) / 60000.0);
+
+    if (trace.hasRef) {
+        uint32_t maxSettle = 0;
+        double sumSettle = 0.0;
+        size_t settled = 0;
+        for (size_t i = 0; i < r.steps.size(); i++) {
+            const StepResult& s = r.steps[i];
+            printf("   marche %8.1f -> %8.1f g a %7.1f s: ", s.fromG, s.toG, s.atMs / 1000.0);
+            if (s.samplesToUpdate >= 0) {
+                printf("stable bouge apres %3ld lots, ", s.samplesToUpdate);
+            } else {
+                printf("stable inchange, ");
+            }
+            if (s.settleMs >= 0) {
+                printf("etabli en %5ld ms\n", s.settleMs);
+                if ((uint32_t)s.settleMs > maxSettle) maxSettle = (uint32_t)s.settleMs;
+                sumSettle += s.settleMs;
+                settled++;
+            } else {
+                printf("NON ETABLI\n");
+                ok = false;
+            }
+        }
+        if (settled > 0) {
+            printf("   etablissement: moyen %.0f ms, max %u ms (seuil %u ms, tolerance %.1f g)\n",
+                   sumSettle / settled, (unsigned)maxSettle, (unsigned)limits.maxSettleMs, limits.settleTolG);
+        }
+        if (maxSettle > limits.maxSettleMs) ok = false;
+        printf("   envois: %u, rapides: %u, rapides injustifies: %u (seuil %u)\n",
+               (unsigned)r.sends, (unsigned)r.fastTriggers, (unsigned)r.falseTriggers,
+               (unsigned)limits.maxFalseTriggers);
+        if (r.falseTriggers > limits.maxFalseTriggers) ok = false;
+    } else {
+        printf("   pas de charge de reference: marches et faux declenchements non evalues\n");
+        printf("   envois: %u, rapides: %u\n", (unsigned)r.sends, (unsigned)r.fastTriggers);
+    }
+
+    printf("   cout: %.1f ns/lot", r.nsPerSample);
+    if (limits.maxNsPerSample > 0.0) {
+        printf(" (seuil %.1f)", limits.maxNsPerSample);
+        if (r.nsPerSample > limits.maxNsPerSample) ok = false;
+    }
+    printf("\n   %s\n", ok ? "OK" : "ECHEC");
+    return ok;
+}
+
+static void usage() {
+    printf("Usage: replay_bench [--synth] [trace.csv ...] [--max-settle-ms N] [--settle-tol G]\n"
+           "                    [--max-false N] [--max-ns N]\n");
+}
+
+int main(int argc, char** argv) {
+    GateLimits limits;
+    limits.maxSettleMs = 10000;
+    limits.settleTolG = 2.0f * WeightParams::deadbandG;
+    limits.maxFalseTriggers = 0;
+    limits.maxNsPerSample = 0.0;
+
+    std::vector<const char*> paths;
+    bool synth = false;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(a, "--synth") == 0) {
+            synth = true;
+        } else if (strcmp(a, "--max-settle-ms") == 0 && hasValue) {
+            limits.maxSettleMs = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--settle-tol") == 0 && hasValue) {
+            limits.settleTolG = strtof(argv[++i], NULL);
+        } else if (strcmp(a, "--max-false") == 0 && hasValue) {
+            limits.maxFalseTriggers = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--max-ns") == 0 && hasValue) {
+            limits.maxNsPerSample = strtod(argv[++i], NULL);
+        } else if (a[0] == '-') {
+            usage();
+            return 2;
+        } else {
+            paths.push_back(a);
+        }
+    }
+    if (paths.empty()) synth = true;
+
+    bool ok = true;
+    ReplayResult result;
+    if (synth) {
+        Trace trace;
+        makeSyntheticTrace(trace);
+        replay(trace, limits, result);
+        ok = report("synthetique", trace, result, limits) && ok;
+    }
+    for (size_t i = 0; i < paths.size(); i++) {
+        Trace trace;
+        if (!loadCsv(paths[i], trace)) {
+            ok = false;
+            continue;
+        }
+        replay(trace, limits, result);
+        ok = report(paths[i], trace, result, limits) && ok;
+    }
+
+    printf("GATE %s\n", ok ? "OK" : "ECHEC");
+    return ok ? 0 : 1;
+}
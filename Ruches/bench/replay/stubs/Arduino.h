@@ -0,0 +1,20 @@
+/*
+ * Stub Arduino pour l'env native: horloge simulee pilotee par le banc
+ * (millis() avance avec vTaskDelay(), pas avec le temps reel).
+ */
+
+#ifndef REPLAY_STUB_ARDUINO_H
+#define REPLAY_STUB_ARDUINO_H
+
+#include <math.h>
+#include <stdint.h>
+
+inline uint32_t& replayClockMs() {
+    static uint32_t nowMs = 0;
+    return nowMs;
+}
+
+inline unsigned long millis() { return replayClockMs(); }
+inline void delay(unsigned long ms) { replayClockMs() += (uint32_t)ms; }
+
+#endif
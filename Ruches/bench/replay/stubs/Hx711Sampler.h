@@ -0,0 +1,53 @@
+/*
+ * Stub Hx711Sampler pour l'env native: rejoue une trace enregistree.
+ * Chaque echantillon de la trace devient une conversion brute horodatee
+ * (g * REPLAY_CAL_FACTOR, tare nulle); pop() rend les conversions dont
+ * l'horodatage est atteint par l'horloge simulee, comme le ring de l'ISR.
+ */
+
+#ifndef REPLAY_STUB_HX711_SAMPLER_H
+#define REPLAY_STUB_HX711_SAMPLER_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Arduino.h"
+
+const float REPLAY_CAL_FACTOR = 696.0f;
+
+struct Hx711Sample {
+    uint32_t tMs;
+    int32_t raw;
+};
+
+class Hx711Sampler {
+public:
+    Hx711Sampler() : times_(NULL), values_(NULL), count_(0), next_(0) {}
+
+    void load(const uint32_t* timesMs, const float* values, size_t count) {
+        times_ = timesMs;
+        values_ = values;
+        count_ = count;
+        next_ = 0;
+    }
+
+    bool finished() const { return next_ >= count_; }
+    size_t index() const { return next_; }
+
+    bool pop(Hx711Sample& out) {
+        if (next_ >= count_ || times_[next_] > millis()) return false;
+        out.tMs = times_[next_];
+        out.raw = (int32_t)lroundf(values_[next_] * REPLAY_CAL_FACTOR);
+        next_++;
+        return true;
+    }
+
+private:
+    const uint32_t* times_;
+    const float* values_;
+    size_t count_;
+    size_t next_;
+};
+
+#endif
@@ -0,0 +1,15 @@
+/*
+ * Stub FreeRTOS pour l'env native: un tick = 1 ms d'horloge simulee.
+ */
+
+#ifndef REPLAY_STUB_FREERTOS_H
+#define REPLAY_STUB_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef REPLAY_STUB_FREERTOS_TASK_H
+#define REPLAY_STUB_FREERTOS_TASK_H
+
+#include "Arduino.h"
+#include "freertos/FreeRTOS.h"
+
+inline void vTaskDelay(TickType_t ticks) { replayClockMs() += ticks; }
+
+#endif
@@ -0,0 +1,296 @@
+/*
+ * Banc hote des trames texte (RucheText): comparaison avec l'ancienne
+ * lecture du recepteur (indexOf / substring / toFloat sur String),
+ * entrees aleatoires et mutees, puis ns par trame.
+ *
+ * Depuis Ruches/:
+ *   g++ -O2 -std=gnu++11 -Ilib/RucheFrame/src bench/text_bench.cpp lib/RucheFrame/src/RucheText.cpp -o text_bench
+ *   ./text_bench              (code de sortie 1 si une verification echoue)
+ * Avec -fsanitize=address,undefined, la passe aleatoire verifie aussi
+ * qu'aucune fonction ne lit au-dela de la longueur donnee.
+ */
+
+#include <RucheText.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+// ===== Reference: ancien code du recepteur, String -> std::string =====
+
+static float legacyToFloat(const std::string& s) {
+    return (float)atof(s.c_str());          // String::toFloat()
+}
+
+static float legacyField(const std::string& payload, const std::string& key, float fallback) {
+    size_t idx = payload.find(key);
+    if (idx == std::string::npos) return fallback;
+    size_t start = idx + key.length();
+    size_t end = payload.find(',', start);
+    std::string token = (end != std::string::npos) ? payload.substr(start, end - start) : payload.substr(start);
+    return legacyToFloat(token);
+}
+
+struct LegacyTelemetry {
+    bool hasWeight;
+    float weightG;
+    float tempC;
+    float humPct;
+    float battPct;
+};
+
+static void legacyParse(const std::string& received, LegacyTelemetry* out) {
+    size_t idx = received.find("POIDS_G:");
+    size_t offset = 8;
+    if (idx == std::string::npos) {
+        idx = received.find("POIDS:");
+        offset = 6;
+    }
+    out->hasWeight = idx != std::string::npos;
+    if (out->hasWeight) out->weightG = legacyToFloat(received.substr(idx + offset));
+    out->tempC = legacyField(received, "T_C:", out->tempC);
+    out->humPct = legacyField(received, "H_P:", out->humPct);
+    out->battPct = legacyField(received, "B_P:", out->battPct);
+}
+
+// ===== Generation =====
+
+static uint32_t gRng = 1234;
+
+static uint32_t rnd() {
+    gRng ^= gRng << 13;
+    gRng ^= gRng >> 17;
+    gRng ^= gRng << 5;
+    return gRng;
+}
+
+// Trame telle que l'envoyaient les emetteurs texte; champs facultatifs.
+static size_t makeFrame(char* out, size_t outSize, bool* hasTemp, bool* hasHum, bool* hasBatt) {
+    float w = (float)((int32_t)(rnd() % 12000000) - 1000000) / 100.0f;
+    int n = snprintf(out, outSize, "%s:%.2f", (rnd() % 8 == 0) ? "POIDS" : "POIDS_G", w);
+    *hasTemp = rnd() % 4 != 0;
+    *hasHum = rnd() % 4 != 0;
+    *hasBatt = rnd() % 4 != 0;
+    if (*hasTemp) n += snprintf(out + n, outSize - n, ",T_C:%.1f", (float)((int)(rnd() % 900) - 300) / 10.0f);
+    if (*hasHum) n += snprintf(out + n, outSize - n, ",H_P:%u", (unsigned)(rnd() % 101));
+    if (*hasBatt) n += snprintf(out + n, outSize - n, ",B_P:%u", (unsigned)(rnd() % 101));
+    return (size_t)n;
+}
+
+static bool sameFloat(float a, float b) {
+    return fabsf(a - b) <= 1e-6f * fmaxf(1.0f, fabsf(b));
+}
+
+static double nowNs() {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static volatile float gSink;
+static unsigned gFailures = 0;
+
+static void fail(const char* what, const char* input, size_t len) {
+    if (gFailures++ < 10) printf("ECHEC %s: \"%.*s\"\n", what, (int)len, input);
+}
+
+// ===== Comparaison avec l'ancienne lecture =====
+
+static void differential(size_t n) {
+    char frame[96];
+    size_t checked = 0;
+    for (size_t i = 0; i < n; i++) {
+        bool hasTemp, hasHum, hasBatt;
+        size_t len = makeFrame(frame, sizeof(frame), &hasTemp, &hasHum, &hasBatt);
+        LegacyTelemetry old;
+        old.tempC = old.humPct = old.battPct = -1.0f;
+        legacyParse(std::string(frame, len), &old);
+        RucheTextTelemetry tm;
+        if (!rucheParseTextTelemetry(frame, len, &tm) || !tm.hasWeight) {
+            fail("trame valide refusee", frame, len);
+            continue;
+        }
+        bool ok = sameFloat(tm.weightG, old.weightG) &&
+                  tm.hasTemp == hasTemp && (!hasTemp || sameFloat(tm.tempC, old.tempC)) &&
+                  tm.hasHum == hasHum && (!hasHum || sameFloat(tm.humPct, old.humPct)) &&
+                  tm.hasBatt == hasBatt && (!hasBatt || sameFloat(tm.battPct, old.battPct));
+        if (!ok) fail("ecart avec l'ancienne lecture", frame, len);
+        checked++;
+    }
+    printf("differentiel: %zu trames comparees\n", checked);
+}
+
+// ===== Entrees aleatoires et mutees =====
+
+static const char* const kAlphabet = "0123456789.,:-+ eEnaifPOIDS_GTCHBRUCMDtrecl\t\r\n*";
+
+// Copie exacte sur le tas: un debordement de lecture est vu par ASan.
+static void checkInput(const char* src, size_t len) {
+    char* buf = (char*)malloc(len > 0 ? len : 1);
+    memcpy(buf, src, len);
+
+    RucheTextTelemetry tm;
+    if (rucheParseTextTelemetry(buf, len, &tm)) {
+        if (!tm.hasWeight && !tm.hasTemp && !tm.hasHum && !tm.hasBatt) fail("succes sans champ", src, len);
+        if ((tm.hasWeight && !isfinite(tm.weightG)) || (tm.hasTemp && !isfinite(tm.tempC)) ||
+            (tm.hasHum && !isfinite(tm.humPct)) || (tm.hasBatt && !isfinite(tm.battPct))) {
+            fail("valeur non finie", src, len);
+        }
+    }
+    float v;
+    if (rucheParseDecimal(buf, len, &v) && !isfinite(v)) fail("decimal non fini", src, len);
+
+    char out[48];
+    size_t n = rucheBuildCommandFrame(buf, len, "RUCHE1", out, sizeof(out));
+    if (n > 0 && (n >= sizeof(out) || strlen(out) != n || strncmp(out, "CMD:", 4) != 0)) {
+        fail("commande mal formee", src, len);
+    }
+    free(buf);
+}
+
+static void fuzz(size_t n) {
+    char input[80];
+    for (size_t i = 0; i < n; i++) {
+        size_t len;
+        if (rnd() % 2) {
+            // Octets quelconques, ou alphabet des trames pour aller plus loin.
+            len = rnd() % sizeof(input);
+            bool bytes = rnd() % 4 == 0;
+            size_t alpha = strlen(kAlphabet);
+            for (size_t k = 0; k < len; k++) {
+                input[k] = bytes ? (char)(rnd() & 0xFF) : kAlphabet[rnd() % alpha];
+            }
+        } else {
+            // Trame valide mutee: remplacement, suppression, troncature.
+            bool t, h, b;
+            len = makeFrame(input, sizeof(input), &t, &h, &b);
+            uint32_t edits = 1 + rnd() % 4;
+            for (uint32_t e = 0; e < edits && len > 0; e++) {
+                size_t pos = rnd() % len;
+                switch (rnd() % 3) {
+                case 0:
+                    input[pos] = kAlphabet[rnd() % strlen(kAlphabet)];
+                    break;
+                case 1:
+                    memmove(input + pos, input + pos + 1, len - pos - 1);
+                    len--;
+                    break;
+                default:
+                    len = pos;
+                    break;
+                }
+            }
+        }
+        checkInput(input, len);
+    }
+    printf("aleatoire: %zu entrees\n", n);
+}
+
+// ===== Cas connus =====
+
+static void expectDecimal(const char* s, bool ok, float want) {
+    float v = 0.0f;
+    bool got = rucheParseDecimal(s, strlen(s), &v);
+    if (got != ok || (ok && !sameFloat(v, want))) fail("rucheParseDecimal", s, strlen(s));
+}
+
+static void expectCommand(const char* in, const char* want) {
+    char out[48];
+    size_t n = rucheBuildCommandFrame(in, strlen(in), "RUCHE1", out, sizeof(out));
+    if (want == NULL ? n != 0 : (n == 0 || strcmp(out, want) != 0)) fail("rucheBuildCommandFrame", in, strlen(in));
+}
+
+static void knownCases() {
+    expectDecimal("12.34", true, 12.34f);
+    expectDecimal(" -0.5 ", true, -0.5f);
+    expectDecimal("+7", true, 7.0f);
+    expectDecimal(".25", true, 0.25f);
+    expectDecimal("3.", true, 3.0f);
+    expectDecimal("", false, 0.0f);
+    expectDecimal("-", false, 0.0f);
+    expectDecimal(".", false, 0.0f);
+    expectDecimal("nan", false, 0.0f);
+    expectDecimal("inf", false, 0.0f);
+    expectDecimal("1e3", false, 0.0f);
+    expectDecimal("1.2.3", false, 0.0f);
+    expectDecimal("12a", false, 0.0f);
+    expectDecimal("1234567890123456789", false, 0.0f);
+
+    expectCommand("tare", "CMD:RUCHE1:tare");
+    expectCommand("  TARE ", "CMD:RUCHE1:TARE");
+    expectCommand("CAL_START", "CMD:RUCHE1:CAL_START");
+    expectCommand("cal 500", "CMD:RUCHE1:CAL:500");
+    expectCommand("cal500", "CMD:RUCHE1:CAL:500");
+    expectCommand("cal:500", "CMD:RUCHE1:cal:500");     // emetteur insensible a la casse
+    expectCommand("CAL:250.5", "CMD:RUCHE1:CAL:250.5");
+    expectCommand("RUCHE3:CAL_START", "CMD:RUCHE3:CAL_START");
+    expectCommand("RUCHE3 : tare", "CMD:RUCHE3:tare");
+    expectCommand("*:TARE", "CMD:*:TARE");
+    expectCommand("CMD:RUCHE2:TARE", "CMD:RUCHE2:TARE");
+    expectCommand("cal", NULL);
+    expectCommand("cal abc", NULL);
+    expectCommand("RUCHE3:reboot", NULL);
+    expectCommand(":TARE", NULL);
+    expectCommand("", NULL);
+
+    // Champ "nan": l'ancien toFloat() donnait 0, le champ est maintenant absent.
+    const char* nanFrame = "POIDS_G:10.00,T_C:nan,H_P:50";
+    RucheTextTelemetry tm;
+    if (!rucheParseTextTelemetry(nanFrame, strlen(nanFrame), &tm) || tm.hasTemp || !tm.hasHum) {
+        fail("champ nan", nanFrame, strlen(nanFrame));
+    }
+}
+
+// ===== Debit =====
+
+static void throughput(size_t n) {
+    const size_t kFrames = 256;
+    static char frames[kFrames][96];
+    static size_t lens[kFrames];
+    for (size_t i = 0; i < kFrames; i++) {
+        bool t, h, b;
+        lens[i] = makeFrame(frames[i], sizeof(frames[i]), &t, &h, &b);
+    }
+
+    float acc = 0.0f;
+    double t0 = nowNs();
+    for (size_t i = 0; i < n; i++) {
+        LegacyTelemetry old;
+        old.tempC = old.humPct = old.battPct = 0.0f;
+        legacyParse(std::string(frames[i % kFrames], lens[i % kFrames]), &old);
+        acc += old.weightG + old.tempC;
+    }
+    double t1 = nowNs();
+    for (size_t i = 0; i < n; i++) {
+        RucheTextTelemetry tm;
+        rucheParseTextTelemetry(frames[i % kFrames], lens[i % kFrames], &tm);
+        acc += tm.weightG + tm.tempC;
+    }
+    double t2 = nowNs();
+    char out[48];
+    for (size_t i = 0; i < n; i++) {
+        acc += (float)rucheBuildCommandFrame("RUCHE3:CAL:500", 14, "RUCHE1", out, sizeof(out));
+    }
+    double t3 = nowNs();
+    gSink = acc;
+
+    printf("trame texte: ancien %7.1f ns  nouveau %7.1f ns  x%.1f\n",
+           (t1 - t0) / n, (t2 - t1) / n, (t1 - t0) / (t2 - t1));
+    printf("commande:    %7.1f ns\n", (t3 - t2) / n);
+}
+
+int main() {
+    knownCases();
+    differential(200000);
+    fuzz(2000000);
+    throughput(1000000);
+    if (gFailures > 0) {
+        printf("%u verification(s) en echec\n", gFailures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
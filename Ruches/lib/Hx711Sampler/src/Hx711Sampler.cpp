@@ -0,0 +1,74 @@
+#include "Hx711Sampler.h"
+#include <driver/gpio.h>
+#include <hal/gpio_ll.h>
+
+// Reveil de secours si un front a ete manque (DOUT deja bas a l'armement).
+static const uint32_t HX711_IDLE_RECHECK_MS = 1000;
+
+Hx711Sampler::Hx711Sampler(int doutPin, int sckPin)
+    : dout_(doutPin), sck_(sckPin), task_(NULL) {
+    portMUX_INITIALIZE(&mux_);
+}
+
+bool Hx711Sampler::begin(UBaseType_t priority, BaseType_t core) {
+    pinMode(sck_, OUTPUT);
+    digitalWrite(sck_, LOW);   // SCK bas: sortie de power-down
+    pinMode(dout_, INPUT);
+    if (xTaskCreatePinnedToCore(taskEntry, "hx711_sampler", 3072, this, priority, &task_, core) != pdPASS) {
+        task_ = NULL;
+        return false;
+    }
+    attachInterruptArg(digitalPinToInterrupt(dout_), onDataReady, this, ONLOW);
+    return true;
+}
+
+void IRAM_ATTR Hx711Sampler::onDataReady(void* arg) {
+    Hx711Sampler* self = static_cast<Hx711Sampler*>(arg);
+    // Niveau bas: masquee jusqu'a ce que la tache ait vide les conversions.
+    gpio_ll_intr_disable(&GPIO, (gpio_num_t)self->dout_);
+    if (self->task_ == NULL) return;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->task_, &woken);
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void Hx711Sampler::taskEntry(void* arg) {
+    static_cast<Hx711Sampler*>(arg)->run();
+}
+
+void Hx711Sampler::run() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(HX711_IDLE_RECHECK_MS));
+        // Les bits lus font aussi basculer DOUT (fronts parasites): seul le
+        // niveau bas indique une conversion prete.
+        while (digitalRead(dout_) == LOW) {
+            Hx711Sample s;
+            s.tMs = millis();
+            s.raw = readConversion();
+            ring_.push(s);
+        }
+        // DOUT haut: prochaine conversion attendue. Si elle est deja la,
+        // l'interruption de niveau part tout de suite (aucun front perdu).
+        gpio_intr_enable((gpio_num_t)dout_);
+    }
+}
+
+int32_t Hx711Sampler::readConversion() {
+    uint32_t value = 0;
+    portENTER_CRITICAL(&mux_);
+    for (uint8_t i = 0; i < 24; i++) {
+        digitalWrite(sck_, HIGH);
+        delayMicroseconds(1);
+        value = (value << 1) | (digitalRead(dout_) == HIGH ? 1u : 0u);
+        digitalWrite(sck_, LOW);
+        delayMicroseconds(1);
+    }
+    // 25e impulsion: voie A, gain 128 pour la conversion suivante.
+    digitalWrite(sck_, HIGH);
+    delayMicroseconds(1);
+    digitalWrite(sck_, LOW);
+    portEXIT_CRITICAL(&mux_);
+    return (int32_t)(value ^ 0x800000u);
+}
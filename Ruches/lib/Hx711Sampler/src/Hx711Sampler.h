@@ -0,0 +1,58 @@
+/*
+ * Acquisition HX711 pilotee par interruption.
+ *
+ * Le HX711 passe DOUT a l'etat bas quand une conversion est prete (10 ou
+ * 80 SPS selon la broche RATE). L'interruption sur niveau bas (masquee
+ * par l'ISR, reactivee une fois DOUT remonte) reveille une tache dediee
+ * de haute priorite qui lit les 24 bits en section critique (SCK ne doit
+ * pas rester haut plus de 60 us) et range l'echantillon horodate dans une
+ * file sans verrou. La tache de traitement vide la file a son propre
+ * rythme: plus d'attente active sur DOUT. Le niveau (pas le front) permet
+ * aussi le reveil GPIO du light sleep automatique.
+ *
+ * Les valeurs brutes sont en binaire decale (raw24 ^ 0x800000), la meme
+ * unite que HX711_ADC: les offsets de tare deja sauves restent valables.
+ */
+
+#ifndef HX711_SAMPLER_H
+#define HX711_SAMPLER_H
+
+#include <Arduino.h>
+#include <SpscRing.h>
+
+struct Hx711Sample {
+    uint32_t tMs;
+    int32_t raw;
+};
+
+class Hx711Sampler {
+public:
+    // 6.4 s de conversions a 10 SPS, 0.8 s a 80 SPS.
+    static const uint16_t RING_SIZE = 64;
+
+    Hx711Sampler(int doutPin, int sckPin);
+
+    // Alimente le HX711 (gain 128, voie A) et demarre la tache de lecture.
+    // core: celui de l'appelant (le masque d'interruption est par coeur).
+    bool begin(UBaseType_t priority, BaseType_t core);
+
+    // Consommateur unique.
+    bool pop(Hx711Sample& out) { return ring_.pop(out); }
+    void flush() { ring_.clear(); }
+    uint32_t pending() const { return ring_.size(); }
+    uint32_t dropped() const { return ring_.dropped(); }
+
+private:
+    static void IRAM_ATTR onDataReady(void* arg);
+    static void taskEntry(void* arg);
+    void run();
+    int32_t readConversion();
+
+    int dout_;
+    int sck_;
+    TaskHandle_t task_;
+    portMUX_TYPE mux_;
+    SpscRing<Hx711Sample, RING_SIZE> ring_;
+};
+
+#endif
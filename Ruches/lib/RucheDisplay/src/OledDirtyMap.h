@@ -0,0 +1,117 @@
+/*
+ * Suivi des zones modifiees d'un ecran SSD1306 128x64.
+ *
+ * La RAM du SSD1306 est rangee en 8 pages de 8 lignes, un octet par
+ * colonne et par page (meme ordre que le tampon Adafruit_SSD1306). On
+ * garde pour chaque page l'intervalle de colonnes touche depuis le
+ * dernier envoi; oledCommitDirty() le resserre ensuite en comparant le
+ * tampon au miroir de ce que l'ecran affiche deja.
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef RUCHE_OLED_DIRTY_MAP_H
+#define RUCHE_OLED_DIRTY_MAP_H
+
+#include <stdint.h>
+#include <string.h>
+
+const uint8_t OLED_WIDTH = 128;
+const uint8_t OLED_PAGES = 8;
+const uint16_t OLED_BUFFER_SIZE = (uint16_t)OLED_WIDTH * OLED_PAGES;
+
+struct OledDirtyMap {
+    uint8_t lo[OLED_PAGES];     // lo > hi: page propre
+    uint8_t hi[OLED_PAGES];
+
+    void clear() {
+        memset(lo, 0xFF, sizeof(lo));
+        memset(hi, 0x00, sizeof(hi));
+    }
+
+    void markAll() {
+        memset(lo, 0x00, sizeof(lo));
+        memset(hi, OLED_WIDTH - 1, sizeof(hi));
+    }
+
+    bool pageDirty(uint8_t page) const { return lo[page] <= hi[page]; }
+
+    bool any() const {
+        for (uint8_t p = 0; p < OLED_PAGES; p++) {
+            if (pageDirty(p)) return true;
+        }
+        return false;
+    }
+
+    // Rectangle en pixels, rogne a l'ecran.
+    void markRect(int16_t x, int16_t y, int16_t w, int16_t h) {
+        int16_t x1 = x + w - 1;
+        int16_t y1 = y + h - 1;
+        if (x < 0) x = 0;
+        if (y < 0) y = 0;
+        if (x1 > OLED_WIDTH - 1) x1 = OLED_WIDTH - 1;
+        if (y1 > OLED_PAGES * 8 - 1) y1 = OLED_PAGES * 8 - 1;
+        if (x > x1 || y > y1) return;
+        for (int16_t p = y / 8; p <= y1 / 8; p++) {
+            if ((uint8_t)x < lo[p]) lo[p] = (uint8_t)x;
+            if ((uint8_t)x1 > hi[p]) hi[p] = (uint8_t)x1;
+        }
+    }
+};
+
+// Recopie dans mirror les octets marques qui different du tampon et
+// decrit dans out, par page, les colonnes a envoyer. dirty est remis a
+// zero. Retourne le nombre d'octets a envoyer (0: rien n'a change).
+inline uint16_t oledCommitDirty(OledDirtyMap& dirty, const uint8_t* fb, uint8_t* mirror, OledDirtyMap& out) {
+    uint16_t total = 0;
+    out.clear();
+    for (uint8_t p = 0; p < OLED_PAGES; p++) {
+        if (!dirty.pageDirty(p)) continue;
+        const uint8_t* src = fb + (uint16_t)p * OLED_WIDTH;
+        uint8_t* dst = mirror + (uint16_t)p * OLED_WIDTH;
+        uint8_t a = dirty.lo[p];
+        uint8_t b = dirty.hi[p];
+        while (a <= b && src[a] == dst[a]) a++;
+        if (a > b) continue;
+        while (src[b] == dst[b]) b--;
+        memcpy(dst + a, src + a, (size_t)(b - a) + 1);
+        out.lo[p] = a;
+        out.hi[p] = b;
+        total += (uint16_t)(b - a) + 1;
+    }
+    dirty.clear();
+    return total;
+}
+
+// Cle d'un widget a partir du texte affiche (FNV-1a 32 bits).
+inline uint32_t oledKeyText(const char* s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Zone d'ecran redessinee seulement quand sa cle change (texte affiche,
+// nombre de barres...) ou quand l'ecran a ete efface depuis son dernier
+// dessin (generation differente).
+struct OledWidget {
+    int16_t x;
+    int16_t y;
+    uint8_t w;
+    uint8_t h;
+    uint32_t key;
+    uint16_t gen;               // 0: jamais dessine
+
+    OledWidget(int16_t x_, int16_t y_, uint8_t w_, uint8_t h_)
+        : x(x_), y(y_), w(w_), h(h_), key(0), gen(0) {}
+
+    bool update(uint32_t k, uint16_t screenGen) {
+        if (gen == screenGen && k == key) return false;
+        key = k;
+        gen = screenGen;
+        return true;
+    }
+};
+
+#endif
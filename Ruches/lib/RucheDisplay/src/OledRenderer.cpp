@@ -0,0 +1,142 @@
+#include "OledRenderer.h"
+#include <Wire.h>
+
+// Octets de donnees par transaction I2C (octet de controle 0x40 en plus).
+#if defined(I2C_BUFFER_LENGTH)
+static const uint8_t OLED_I2C_CHUNK = (I2C_BUFFER_LENGTH > 256 ? 256 : I2C_BUFFER_LENGTH) - 1;
+#else
+static const uint8_t OLED_I2C_CHUNK = 31;
+#endif
+static const uint32_t OLED_I2C_CLOCK_HZ = 400000;
+
+OledRenderer::OledRenderer(Adafruit_SSD1306& oled, uint8_t i2cAddr)
+    : oled_(oled), addr_(i2cAddr), gen_(1), task_(NULL),
+      busy_(false), powerReq_(-1), bytesSent_(0), flushes_(0) {
+    dirty_.clear();
+    job_.clear();
+}
+
+bool OledRenderer::begin(UBaseType_t priority, BaseType_t core) {
+    memcpy(mirror_, oled_.getBuffer(), OLED_BUFFER_SIZE);
+    dirty_.clear();
+    // Adafruit repasse a 100 kHz apres chaque display(): la tache garde
+    // le bus a 400 kHz.
+    Wire.setClock(OLED_I2C_CLOCK_HZ);
+    if (xTaskCreatePinnedToCore(taskEntry, "task_oled", 3072, this, priority, &task_, core) != pdPASS) {
+        task_ = NULL;
+        return false;
+    }
+    return true;
+}
+
+void OledRenderer::clear() {
+    oled_.clearDisplay();
+    gen_++;
+    if (gen_ == 0) gen_ = 1;
+    dirty_.markAll();
+}
+
+bool OledRenderer::beginWidget(OledWidget& w, uint32_t key) {
+    if (!w.update(key, gen_)) return false;
+    oled_.fillRect(w.x, w.y, w.w, w.h, SSD1306_BLACK);
+    dirty_.markRect(w.x, w.y, w.w, w.h);
+    return true;
+}
+
+void OledRenderer::text(OledWidget& w, uint8_t size, const char* s) {
+    if (!beginWidget(w, oledKeyText(s))) return;
+    oled_.setTextSize(size);
+    oled_.setTextColor(SSD1306_WHITE);
+    oled_.setCursor(w.x, w.y);
+    oled_.print(s);
+}
+
+bool OledRenderer::flush() {
+    if (!dirty_.any()) return true;
+    if (busy_.load(std::memory_order_acquire)) return false;
+    if (oledCommitDirty(dirty_, oled_.getBuffer(), mirror_, job_) == 0) return true;
+    flushes_++;
+    if (task_ == NULL) {
+        sendJob();
+        return true;
+    }
+    busy_.store(true, std::memory_order_release);
+    xTaskNotifyGive(task_);
+    return true;
+}
+
+bool OledRenderer::waitIdle(uint32_t timeoutMs) {
+    unsigned long start = millis();
+    while (busy_.load(std::memory_order_acquire)) {
+        if (millis() - start > timeoutMs) return false;
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
+    return true;
+}
+
+bool OledRenderer::flushAndWait(uint32_t timeoutMs) {
+    if (!waitIdle(timeoutMs)) return false;
+    flush();
+    return waitIdle(timeoutMs);
+}
+
+void OledRenderer::setPower(bool on) {
+    if (task_ == NULL) {
+        uint8_t cmd = on ? SSD1306_DISPLAYON : SSD1306_DISPLAYOFF;
+        sendCommands(&cmd, 1);
+        return;
+    }
+    powerReq_.store(on ? 1 : 0, std::memory_order_release);
+    xTaskNotifyGive(task_);
+}
+
+void OledRenderer::taskEntry(void* arg) {
+    static_cast<OledRenderer*>(arg)->run();
+}
+
+void OledRenderer::run() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int8_t power = powerReq_.exchange(-1, std::memory_order_acq_rel);
+        if (power >= 0) {
+            uint8_t cmd = power ? SSD1306_DISPLAYON : SSD1306_DISPLAYOFF;
+            sendCommands(&cmd, 1);
+        }
+        if (busy_.load(std::memory_order_acquire)) {
+            sendJob();
+            busy_.store(false, std::memory_order_release);
+        }
+    }
+}
+
+void OledRenderer::sendCommands(const uint8_t* cmds, uint8_t n) {
+    Wire.beginTransmission(addr_);
+    Wire.write((uint8_t)0x00);
+    Wire.write(cmds, n);
+    Wire.endTransmission();
+}
+
+// Fenetre page p, colonnes lo..hi: l'adressage horizontal (regle par
+// Adafruit) fait avancer la colonne a chaque octet recu.
+void OledRenderer::sendJob() {
+    for (uint8_t p = 0; p < OLED_PAGES; p++) {
+        if (!job_.pageDirty(p)) continue;
+        uint8_t a = job_.lo[p];
+        uint8_t b = job_.hi[p];
+        const uint8_t window[] = {SSD1306_PAGEADDR, p, p, SSD1306_COLUMNADDR, a, b};
+        sendCommands(window, sizeof(window));
+        const uint8_t* src = mirror_ + (uint16_t)p * OLED_WIDTH + a;
+        uint16_t left = (uint16_t)(b - a) + 1;
+        bytesSent_ += left;
+        while (left > 0) {
+            uint8_t n = left > OLED_I2C_CHUNK ? OLED_I2C_CHUNK : (uint8_t)left;
+            Wire.beginTransmission(addr_);
+            Wire.write((uint8_t)0x40);
+            Wire.write(src, n);
+            Wire.endTransmission();
+            src += n;
+            left -= n;
+        }
+    }
+    job_.clear();
+}
@@ -0,0 +1,77 @@
+/*
+ * Rendu OLED a widgets retenus pour Adafruit_SSD1306.
+ *
+ * Le dessin se fait toujours dans le tampon Adafruit, mais un widget
+ * n'est efface et redessine que si sa cle change. Seules les colonnes
+ * modifiees des pages touchees partent en I2C (au lieu des 1024 octets
+ * de display()), depuis une tache dediee: flush() ne bloque pas
+ * l'appelant. Apres begin(), cette tache est seule a utiliser le bus I2C
+ * de l'ecran: ne plus appeler oled.display() ni oled.ssd1306_command().
+ *
+ * Proprietaire unique: une seule tache dessine dans le tampon Adafruit et
+ * appelle les methodes du rendu (clear, markRect, widgets, flush,
+ * setPower). Aucun verrou ici: flush() teste busy_ puis fige les zones en
+ * deux temps et markRect() ecrit dirty_ sans synchronisation; une tache
+ * qui preempte le proprietaire en plein dessin perdrait des zones, qui ne
+ * seraient plus renvoyees avant que leur cle change. Les autres taches
+ * passent leurs messages au proprietaire (file, instantane).
+ */
+
+#ifndef RUCHE_OLED_RENDERER_H
+#define RUCHE_OLED_RENDERER_H
+
+#include <Arduino.h>
+#include <Adafruit_SSD1306.h>
+#include <atomic>
+#include "OledDirtyMap.h"
+
+class OledRenderer {
+public:
+    OledRenderer(Adafruit_SSD1306& oled, uint8_t i2cAddr);
+
+    // Apres oled.begin() et un oled.display(): l'ecran montre le tampon.
+    // Sans tache (echec de creation), flush() envoie de facon bloquante.
+    bool begin(UBaseType_t priority, BaseType_t core);
+
+    // Nouvel ecran: tampon efface, tous les widgets a redessiner.
+    void clear();
+    // Dessin libre deja fait dans le tampon.
+    void markRect(int16_t x, int16_t y, int16_t w, int16_t h) { dirty_.markRect(x, y, w, h); }
+
+    // true: zone du widget effacee et marquee, a redessiner par l'appelant.
+    bool beginWidget(OledWidget& w, uint32_t key);
+    // Widget texte (couleur blanche), cle = texte.
+    void text(OledWidget& w, uint8_t size, const char* s);
+
+    // Envoi des zones modifiees sans attendre. false: envoi precedent en
+    // cours, les zones restent marquees pour le prochain appel.
+    bool flush();
+    // Bloquant jusqu'a l'affichage effectif (avant de couper l'ecran).
+    bool flushAndWait(uint32_t timeoutMs);
+    // Extinction / rallumage du panneau, RAM conservee.
+    void setPower(bool on);
+
+    uint32_t bytesSent() const { return bytesSent_; }
+    uint32_t flushes() const { return flushes_; }
+
+private:
+    static void taskEntry(void* arg);
+    void run();
+    void sendCommands(const uint8_t* cmds, uint8_t n);
+    void sendJob();
+    bool waitIdle(uint32_t timeoutMs);
+
+    Adafruit_SSD1306& oled_;
+    uint8_t addr_;
+    uint16_t gen_;
+    TaskHandle_t task_;
+    OledDirtyMap dirty_;        // dessine depuis le dernier flush()
+    OledDirtyMap job_;          // colonnes en cours d'envoi, lues dans mirror_
+    uint8_t mirror_[OLED_BUFFER_SIZE];
+    std::atomic<bool> busy_;
+    std::atomic<int8_t> powerReq_;  // -1: rien, 0: eteindre, 1: allumer
+    volatile uint32_t bytesSent_;
+    volatile uint32_t flushes_;
+};
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * Piles de filtres par type de ruche. Pour un autre type (ruchette,
+ * balance de sol...), declarer une nouvelle struct de parametres et un
+ * nouveau typedef de chaine, puis le selectionner dans main.cpp.
+ */
+
+#ifndef HIVE_WEIGHT_CONFIG_H
+#define HIVE_WEIGHT_CONFIG_H
+
+#include "WeightPipeline.h"
+
+// Parametres historiques de la balance RUCHE1 (HX711 + cellule 50 kg).
+struct StandardHiveParams {
+    // Echantillonnage (taskHX711)
+    static constexpr uint32_t samplePeriodMs = 200;      // ecart mini entre 2 echantillons traites
+    // Auto-zero
+    static constexpr float autoZeroWindowG = 120.0f;     // zone "balance vide" pour corriger la derive
+    static constexpr float autoZeroMaxStepG = 1.5f;      // variation max entre 2 mesures pour corriger
+    static constexpr float autoZeroAlpha = 0.015f;       // vitesse de correction derive
+    // Rejet de pics + EMA adaptative
+    static constexpr float impossibleJumpG = 10000.0f;
+    static constexpr float negativeClampG = 200.0f;      // petites valeurs negatives forcees a 0
+    static constexpr float outlierJumpG = 100.0f;
+    static constexpr uint8_t stepConfirmSamples = 2;
+    static constexpr float emaAlphaSlow = 0.10f;
+    static constexpr float emaAlphaMed = 0.30f;
+    static constexpr float emaAlphaFast = 0.60f;
+    static constexpr float emaMediumDeltaG = 100.0f;
+    static constexpr float emaFastDeltaG = 500.0f;
+    // Bande morte + verrou zero
+    static constexpr float deadbandG = 12.0f;
+    static constexpr uint8_t stableConfirmSamples = 4;
+    static constexpr float zeroLockG = 8.0f;             // affichage force a 0 sous ce seuil
+    // Lissage telemetrie
+    static constexpr float telemetryAlpha = 0.10f;       // lissage dedie aux trames envoyees
+    static constexpr float telemetryMaxStepG = 120.0f;   // limite de variation par echantillon
+    static constexpr float fastChangeTriggerG = 60.0f;   // envoi immediat sur variation brusque
+};
+
+const uint16_t STANDARD_HIVE_MEDIAN_WINDOW = 7;
+const uint16_t STANDARD_HIVE_FILTER_WINDOW = 20;
+
+// Ordre des etages de la chaine standard (index pour stage<I>()).
+enum StandardHiveStage {
+    HIVE_STAGE_AUTO_ZERO = 0,
+    HIVE_STAGE_MEDIAN = 1,
+    HIVE_STAGE_EMA = 2,
+    HIVE_STAGE_STABLE = 3
+};
+
+typedef WeightPipeline<
+    AutoZeroStage<StandardHiveParams>,
+    MedianStage<STANDARD_HIVE_MEDIAN_WINDOW>,
+    AdaptiveEmaStage<STANDARD_HIVE_FILTER_WINDOW, StandardHiveParams>,
+    StableDeadbandStage<StandardHiveParams> > StandardHiveChain;
+
+typedef SlewLimitedEmaStage<StandardHiveParams> StandardHiveTelemetryFilter;
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Moyenne glissante sur N echantillons avec somme courante: O(1) par
+ * echantillon. La somme est recalculee a chaque tour de buffer pour
+ * borner la derive d'arrondi float (cout amorti O(1)).
+ *
+ * Aucun constructeur: un objet a zero est une fenetre vide (RTC_DATA_ATTR).
+ */
+
+#ifndef MOVING_AVERAGE_H
+#define MOVING_AVERAGE_H
+
+#include <stdint.h>
+
+template <uint16_t N>
+class MovingAverage {
+    static_assert(N >= 1, "MovingAverage: fenetre vide");
+
+public:
+    void reset() {
+        head_ = 0;
+        count_ = 0;
+        sum_ = 0.0f;
+    }
+
+    uint16_t count() const { return count_; }
+
+    // Ajoute un echantillon et retourne la moyenne courante.
+    float push(float v) {
+        if (count_ < N) {
+            count_++;
+        } else {
+            sum_ -= values_[head_];
+        }
+        values_[head_] = v;
+        sum_ += v;
+        head_++;
+        if (head_ == N) {
+            head_ = 0;
+            resync();
+        }
+        return mean();
+    }
+
+    float mean() const {
+        return (count_ == 0) ? 0.0f : sum_ / count_;
+    }
+
+private:
+    void resync() {
+        float s = 0.0f;
+        for (uint16_t i = 0; i < count_; i++) {
+            s += values_[i];
+        }
+        sum_ = s;
+    }
+
+    float values_[N];
+    float sum_;
+    uint16_t head_;
+    uint16_t count_;
+};
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * Mediane glissante incrementale sur une fenetre de N echantillons.
+ * Deux tas (max-tas "bas", min-tas "haut") indexant un buffer circulaire:
+ * chaque echantillon coute O(log N) au lieu d'un tri complet.
+ *
+ * Aucun constructeur: un objet a zero est une fenetre vide, ce qui permet
+ * de le placer en RTC_DATA_ATTR et de le copier tel quel.
+ */
+
+#ifndef SLIDING_MEDIAN_H
+#define SLIDING_MEDIAN_H
+
+#include <stdint.h>
+
+template <uint16_t N>
+class SlidingMedian {
+    static_assert(N >= 1, "SlidingMedian: fenetre vide");
+
+public:
+    void reset() {
+        head_ = 0;
+        count_ = 0;
+        size_[LO] = 0;
+        size_[HI] = 0;
+    }
+
+    uint16_t count() const { return count_; }
+
+    // Ajoute un echantillon (remplace le plus ancien si la fenetre est pleine)
+    // et retourne la mediane. Pour un nombre pair d'echantillons, retourne
+    // l'element median superieur (sorted[count / 2]).
+    float push(float v) {
+        uint16_t slot = head_;
+        values_[slot] = v;
+        if (count_ < N) {
+            heapPush((size_[HI] > 0 && v < values_[heap_[HI][0]]) ? LO : HI, slot);
+            count_++;
+            if (size_[HI] > size_[LO] + 1) {
+                heapPush(LO, heapPop(HI));
+            } else if (size_[LO] > size_[HI]) {
+                heapPush(HI, heapPop(LO));
+            }
+        } else {
+            // Fenetre pleine: la valeur remplace la plus ancienne dans son tas.
+            uint8_t side = side_[slot];
+            siftUp(side, pos_[slot]);
+            siftDown(side, pos_[slot]);
+            // Une seule valeur a change: au plus un echange de sommets suffit.
+            if (size_[LO] > 0 && values_[heap_[LO][0]] > values_[heap_[HI][0]]) {
+                uint16_t a = heap_[LO][0];
+                uint16_t b = heap_[HI][0];
+                place(LO, 0, b);
+                place(HI, 0, a);
+                siftDown(LO, 0);
+                siftDown(HI, 0);
+            }
+        }
+        head_ = (uint16_t)((head_ + 1) % N);
+        return median();
+    }
+
+    float median() const {
+        return (count_ == 0) ? 0.0f : values_[heap_[HI][0]];
+    }
+
+private:
+    enum { LO = 0, HI = 1 };
+
+    bool before(uint8_t side, uint16_t a, uint16_t b) const {
+        return (side == HI) ? (values_[a] < values_[b]) : (values_[a] > values_[b]);
+    }
+
+    void place(uint8_t side, uint16_t i, uint16_t slot) {
+        heap_[side][i] = slot;
+        pos_[slot] = i;
+        side_[slot] = side;
+    }
+
+    void siftUp(uint8_t side, uint16_t i) {
+        uint16_t slot = heap_[side][i];
+        while (i > 0) {
+            uint16_t parent = (uint16_t)((i - 1) / 2);
+            if (!before(side, slot, heap_[side][parent])) break;
+            place(side, i, heap_[side][parent]);
+            i = parent;
+        }
+        place(side, i, slot);
+    }
+
+    void siftDown(uint8_t side, uint16_t i) {
+        uint16_t slot = heap_[side][i];
+        uint16_t n = size_[side];
+        while (true) {
+            uint16_t child = (uint16_t)(2 * i + 1);
+            if (child >= n) break;
+            if (child + 1 < n && before(side, heap_[side][child + 1], heap_[side][child])) child++;
+            if (!before(side, heap_[side][child], slot)) break;
+            place(side, i, heap_[side][child]);
+            i = child;
+        }
+        place(side, i, slot);
+    }
+
+    void heapPush(uint8_t side, uint16_t slot) {
+        uint16_t i = size_[side]++;
+        place(side, i, slot);
+        siftUp(side, i);
+    }
+
+    uint16_t heapPop(uint8_t side) {
+        uint16_t top = heap_[side][0];
+        size_[side]--;
+        if (size_[side] > 0) {
+            place(side, 0, heap_[side][size_[side]]);
+            siftDown(side, 0);
+        }
+        return top;
+    }
+
+    float values_[N];
+    uint16_t heap_[2][N];   // indices dans values_, par tas
+    uint16_t pos_[N];       // position de chaque slot dans son tas
+    uint8_t side_[N];       // tas contenant chaque slot
+    uint16_t size_[2];
+    uint16_t head_;         // prochain slot a ecrire (= plus ancien quand plein)
+    uint16_t count_;
+};
+
+#endif
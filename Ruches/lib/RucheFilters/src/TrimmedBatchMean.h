@@ -0,0 +1,45 @@
+/*
+ * Reduit les conversions HX711 recues pendant une periode de traitement a
+ * une seule valeur: moyenne sans le minimum ni le maximum des qu'il y a au
+ * moins 3 conversions (comme IGN_HIGH_SAMPLE / IGN_LOW_SAMPLE de HX711_ADC).
+ *
+ * Aucun constructeur: un objet a zero est un lot vide.
+ */
+
+#ifndef TRIMMED_BATCH_MEAN_H
+#define TRIMMED_BATCH_MEAN_H
+
+#include <stdint.h>
+
+class TrimmedBatchMean {
+public:
+    void reset() {
+        sum_ = 0.0;
+        min_ = 0.0f;
+        max_ = 0.0f;
+        count_ = 0;
+    }
+
+    void add(float v) {
+        if (count_ == 0 || v < min_) min_ = v;
+        if (count_ == 0 || v > max_) max_ = v;
+        sum_ += v;
+        count_++;
+    }
+
+    uint16_t count() const { return count_; }
+
+    float mean() const {
+        if (count_ == 0) return 0.0f;
+        if (count_ < 3) return (float)(sum_ / count_);
+        return (float)((sum_ - min_ - max_) / (count_ - 2));
+    }
+
+private:
+    double sum_;
+    float min_;
+    float max_;
+    uint16_t count_;
+};
+
+#endif
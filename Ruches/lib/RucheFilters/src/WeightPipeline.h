@@ -0,0 +1,287 @@
+/*
+ * Chaine de traitement du poids composee a la compilation.
+ *
+ * Chaque etage possede son etat et expose:
+ *   float process(float x);   // echantillon suivant
+ *   void reset();             // retour a l'etat initial
+ * Les parametres sont des structs de constantes (static constexpr), ce qui
+ * permet au compilateur de tout inliner en une seule boucle.
+ *
+ * Pas de constructeurs: un objet a zero est un etage reinitialise, on peut
+ * donc placer une chaine en RTC_DATA_ATTR et la copier telle quelle.
+ * Aucune dependance Arduino: meme code sur ESP32 et sur hote Linux.
+ */
+
+#ifndef WEIGHT_PIPELINE_H
+#define WEIGHT_PIPELINE_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "MovingAverage.h"
+#include "SlidingMedian.h"
+
+// ===== Etages =====
+
+// Correction lente de la derive autour de zero (balance vide).
+// P: autoZeroWindowG, autoZeroMaxStepG, autoZeroAlpha
+template <typename P>
+class AutoZeroStage {
+public:
+    void reset() {
+        offset_ = 0.0f;
+        prev_ = 0.0f;
+        prevReady_ = false;
+        frozen_ = false;
+    }
+
+    float process(float raw) {
+        float corrected = raw - offset_;
+        if (!frozen_ && prevReady_) {
+            float d = fabsf(corrected - prev_);
+            if (fabsf(corrected) <= P::autoZeroWindowG && d <= P::autoZeroMaxStepG) {
+                offset_ += P::autoZeroAlpha * corrected;
+                corrected = raw - offset_;
+            }
+        }
+        prev_ = corrected;
+        prevReady_ = true;
+        return corrected;
+    }
+
+    // Gele la correction (calibration en cours).
+    void setFrozen(bool frozen) { frozen_ = frozen; }
+    void adjustOffset(float delta) { offset_ += delta; }
+    float offset() const { return offset_; }
+
+private:
+    float offset_;
+    float prev_;
+    bool prevReady_;
+    bool frozen_;
+};
+
+template <uint16_t N>
+class MedianStage {
+public:
+    void reset() { window_.reset(); }
+    float process(float x) { return window_.push(x); }
+
+private:
+    SlidingMedian<N> window_;
+};
+
+// Rejet des pics, recalage sur marche de charge, moyenne glissante puis
+// EMA a coefficient adaptatif.
+// P: impossibleJumpG, negativeClampG, outlierJumpG, stepConfirmSamples,
+//    emaAlphaSlow/Med/Fast, emaMediumDeltaG, emaFastDeltaG
+template <uint16_t N, typename P>
+class AdaptiveEmaStage {
+public:
+    void reset() {
+        average_.reset();
+        ema_ = 0.0f;
+        ready_ = false;
+        jumpStreak_ = 0;
+    }
+
+    float process(float raw) {
+        // Rejette les sauts impossibles avant d'alimenter les buffers de lissage.
+        if (ready_ && fabsf(raw - ema_) > P::impossibleJumpG) {
+            return ema_;
+        }
+
+        // Petite derive negative autour de zero: on force a zero pour eviter
+        // d'alimenter l'EMA avec un poids negatif non physique.
+        if (raw < 0.0f && raw >= -P::negativeClampG) {
+            raw = 0.0f;
+        }
+
+        if (ready_) {
+            if (fabsf(raw - ema_) > P::outlierJumpG) {
+                jumpStreak_++;
+                if (jumpStreak_ >= P::stepConfirmSamples) {
+                    // Changement reel de charge: recaler rapidement le filtre.
+                    ema_ = raw;
+                    average_.reset();
+                    average_.push(raw);
+                    jumpStreak_ = 0;
+                }
+                // Pic isole: ignorer.
+                return ema_;
+            }
+            jumpStreak_ = 0;
+        }
+
+        float avg = average_.push(raw);
+        if (!ready_) {
+            ema_ = avg;
+            ready_ = true;
+        } else {
+            float delta = fabsf(avg - ema_);
+            float alpha = P::emaAlphaSlow;
+            if (delta > P::emaFastDeltaG) {
+                alpha = P::emaAlphaFast;
+            } else if (delta > P::emaMediumDeltaG) {
+                alpha = P::emaAlphaMed;
+            }
+            ema_ = alpha * avg + (1.0f - alpha) * ema_;
+        }
+
+        if (ema_ < 0.0f && ema_ >= -P::negativeClampG) {
+            ema_ = 0.0f;
+        }
+        return ema_;
+    }
+
+    float value() const { return ema_; }
+    bool ready() const { return ready_; }
+
+private:
+    MovingAverage<N> average_;
+    float ema_;
+    bool ready_;
+    uint8_t jumpStreak_;
+};
+
+// Bande morte: la valeur stable ne change qu'apres stableConfirmSamples
+// echantillons concordants hors de la bande. Le verrou zero s'applique a
+// l'etat de l'etage (une petite valeur stable devient exactement 0).
+// P: deadbandG, stableConfirmSamples, zeroLockG
+template <typename P>
+class StableDeadbandStage {
+public:
+    void reset() {
+        stable_ = 0.0f;
+        clearPending();
+    }
+
+    void clearPending() {
+        candidate_ = 0.0f;
+        pendingCount_ = 0;
+    }
+
+    float process(float filtered) {
+        if (fabsf(filtered - stable_) >= P::deadbandG) {
+            if (pendingCount_ == 0 || fabsf(filtered - candidate_) >= P::deadbandG) {
+                candidate_ = filtered;
+                pendingCount_ = 1;
+            } else {
+                pendingCount_++;
+                if (pendingCount_ >= P::stableConfirmSamples) {
+                    stable_ = candidate_;
+                    pendingCount_ = 0;
+                }
+            }
+        } else {
+            pendingCount_ = 0;
+        }
+        if (fabsf(stable_) < P::zeroLockG) {
+            stable_ = 0.0f;
+        }
+        return stable_;
+    }
+
+    float value() const { return stable_; }
+
+private:
+    float stable_;
+    float candidate_;
+    uint8_t pendingCount_;
+};
+
+// Lissage dedie aux trames envoyees: EMA a pas limite.
+// P: telemetryAlpha, telemetryMaxStepG
+template <typename P>
+class SlewLimitedEmaStage {
+public:
+    void reset() { ready_ = false; value_ = 0.0f; }
+
+    // Part directement d'une valeur connue (fin de demarrage).
+    void prime(float v) {
+        value_ = v;
+        ready_ = true;
+    }
+
+    float process(float x) {
+        if (!ready_) {
+            prime(x);
+            return value_;
+        }
+        float delta = x - value_;
+        if (delta > P::telemetryMaxStepG) delta = P::telemetryMaxStepG;
+        if (delta < -P::telemetryMaxStepG) delta = -P::telemetryMaxStepG;
+        value_ += P::telemetryAlpha * delta;
+        return value_;
+    }
+
+    float value() const { return value_; }
+
+private:
+    float value_;
+    bool ready_;
+};
+
+// ===== Composition =====
+
+template <typename... Stages>
+class WeightPipeline;
+
+template <size_t I, typename Pipeline>
+struct PipelineStage;
+
+template <>
+class WeightPipeline<> {
+public:
+    float process(float x) { return x; }
+    void reset() {}
+};
+
+template <typename Head, typename... Tail>
+class WeightPipeline<Head, Tail...> {
+public:
+    float process(float x) { return tail_.process(head_.process(x)); }
+
+    void reset() {
+        head_.reset();
+        tail_.reset();
+    }
+
+    Head& head() { return head_; }
+    const Head& head() const { return head_; }
+    WeightPipeline<Tail...>& tail() { return tail_; }
+    const WeightPipeline<Tail...>& tail() const { return tail_; }
+
+    // Acces a l'etage I (0 = premier) pour lire son etat ou le piloter.
+    template <size_t I>
+    typename PipelineStage<I, WeightPipeline>::type& stage() {
+        return PipelineStage<I, WeightPipeline>::get(*this);
+    }
+
+    template <size_t I>
+    const typename PipelineStage<I, WeightPipeline>::type& stage() const {
+        return PipelineStage<I, WeightPipeline>::get(*this);
+    }
+
+private:
+    Head head_;
+    WeightPipeline<Tail...> tail_;
+};
+
+template <typename Head, typename... Tail>
+struct PipelineStage<0, WeightPipeline<Head, Tail...> > {
+    typedef Head type;
+    static Head& get(WeightPipeline<Head, Tail...>& p) { return p.head(); }
+    static const Head& get(const WeightPipeline<Head, Tail...>& p) { return p.head(); }
+};
+
+template <size_t I, typename Head, typename... Tail>
+struct PipelineStage<I, WeightPipeline<Head, Tail...> > {
+    typedef PipelineStage<I - 1, WeightPipeline<Tail...> > Next;
+    typedef typename Next::type type;
+    static type& get(WeightPipeline<Head, Tail...>& p) { return Next::get(p.tail()); }
+    static const type& get(const WeightPipeline<Head, Tail...>& p) { return Next::get(p.tail()); }
+};
+
+#endif
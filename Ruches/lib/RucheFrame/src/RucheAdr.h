@@ -0,0 +1,115 @@
+/*
+ * Debit adaptatif (SF + puissance) pilote par le recepteur.
+ *
+ * Le recepteur garde l'historique SNR d'un noeud et, a la maniere de
+ * LoRaWAN, convertit la marge au-dessus du plancher de demodulation en
+ * pas de 3 dB: d'abord baisser le SF, puis la puissance; marge negative:
+ * remonter la puissance puis le SF. La recommandation part dans l'ACK.
+ *
+ * Un SX1262 ne demodule qu'un SF a la fois: emetteur et recepteur
+ * changent de SF ensemble (le recepteur juste apres l'ACK) et reviennent
+ * tous deux au profil par defaut si le lien est perdu.
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef RUCHE_ADR_H
+#define RUCHE_ADR_H
+
+#include <stdint.h>
+
+const uint8_t RUCHE_ADR_SF_MIN = 7;
+const uint8_t RUCHE_ADR_SF_MAX = 12;
+const int8_t RUCHE_ADR_POWER_MIN_DBM = 2;
+const int8_t RUCHE_ADR_POWER_MAX_DBM = 14;     // 25 mW ERP, bande 868.0 MHz
+const int8_t RUCHE_ADR_POWER_STEP_DB = 3;
+// Profil commun de repli (= reglage historique des deux firmwares).
+const uint8_t RUCHE_ADR_DEFAULT_SF = 7;
+const int8_t RUCHE_ADR_DEFAULT_POWER_DBM = 14;
+const float RUCHE_ADR_MARGIN_DB = 10.0f;        // marge gardee au-dessus du plancher
+const uint8_t RUCHE_ADR_HISTORY = 8;            // trames avant de baisser SF/puissance
+const uint8_t RUCHE_ADR_MIN_SAMPLES_UP = 2;     // trames avant de remonter
+
+struct RucheAdrSetting {
+    uint8_t sf;
+    int8_t powerDbm;
+};
+
+inline RucheAdrSetting rucheAdrDefault() {
+    RucheAdrSetting s;
+    s.sf = RUCHE_ADR_DEFAULT_SF;
+    s.powerDbm = RUCHE_ADR_DEFAULT_POWER_DBM;
+    return s;
+}
+
+inline bool rucheAdrEqual(const RucheAdrSetting& a, const RucheAdrSetting& b) {
+    return a.sf == b.sf && a.powerDbm == b.powerDbm;
+}
+
+inline bool rucheAdrValid(const RucheAdrSetting& s) {
+    return s.sf >= RUCHE_ADR_SF_MIN && s.sf <= RUCHE_ADR_SF_MAX &&
+           s.powerDbm >= RUCHE_ADR_POWER_MIN_DBM && s.powerDbm <= RUCHE_ADR_POWER_MAX_DBM;
+}
+
+// SNR minimal demodulable a 125 kHz (datasheet SX1262).
+inline float rucheAdrSnrFloorDb(uint8_t sf) {
+    return -7.5f - 2.5f * (float)(sf - RUCHE_ADR_SF_MIN);
+}
+
+// Historique SNR d'un lien. Objet a zero = historique vide.
+struct RucheLinkStats {
+    float snrDb[RUCHE_ADR_HISTORY];
+    uint8_t count;
+    uint8_t head;
+
+    void reset() {
+        count = 0;
+        head = 0;
+    }
+
+    void push(float snr) {
+        snrDb[head] = snr;
+        head = (uint8_t)((head + 1) % RUCHE_ADR_HISTORY);
+        if (count < RUCHE_ADR_HISTORY) count++;
+    }
+
+    float maxSnrDb() const {
+        float m = snrDb[0];
+        for (uint8_t i = 1; i < count; i++) {
+            if (snrDb[i] > m) m = snrDb[i];
+        }
+        return m;
+    }
+};
+
+// Reglage recommande pour le lien, en partant du reglage courant du noeud.
+inline RucheAdrSetting rucheAdrRecommend(const RucheLinkStats& link, const RucheAdrSetting& current) {
+    RucheAdrSetting s = current;
+    if (!rucheAdrValid(s)) s = rucheAdrDefault();
+    if (link.count < RUCHE_ADR_MIN_SAMPLES_UP) return s;
+
+    float margin = link.maxSnrDb() - rucheAdrSnrFloorDb(s.sf) - RUCHE_ADR_MARGIN_DB;
+    int steps = (int)(margin / RUCHE_ADR_POWER_STEP_DB);
+    if (margin < 0.0f) steps--;   // arrondi vers le bas
+    if (steps > 0 && link.count < RUCHE_ADR_HISTORY) return s;
+
+    while (steps > 0 && s.sf > RUCHE_ADR_SF_MIN) {
+        s.sf--;
+        steps--;
+    }
+    while (steps > 0 && s.powerDbm - RUCHE_ADR_POWER_STEP_DB >= RUCHE_ADR_POWER_MIN_DBM) {
+        s.powerDbm = (int8_t)(s.powerDbm - RUCHE_ADR_POWER_STEP_DB);
+        steps--;
+    }
+    while (steps < 0 && s.powerDbm < RUCHE_ADR_POWER_MAX_DBM) {
+        int p = s.powerDbm + RUCHE_ADR_POWER_STEP_DB;
+        s.powerDbm = (int8_t)(p > RUCHE_ADR_POWER_MAX_DBM ? RUCHE_ADR_POWER_MAX_DBM : p);
+        steps++;
+    }
+    while (steps < 0 && s.sf < RUCHE_ADR_SF_MAX) {
+        s.sf++;
+        steps++;
+    }
+    return s;
+}
+
+#endif
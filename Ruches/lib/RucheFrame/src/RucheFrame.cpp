@@ -0,0 +1,318 @@
+#include "RucheFrame.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+uint16_t rucheCrc16(const uint8_t* data, size_t len) {
+    // CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF).
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+bool rucheIsBinaryFrame(const uint8_t* data, size_t len) {
+    if (data == NULL || len < sizeof(RucheFrameHeader)) return false;
+    return data[0] == RUCHE_FRAME_MAGIC;
+}
+
+uint8_t rucheFrameVersion(const uint8_t* data, size_t len) {
+    if (!rucheIsBinaryFrame(data, len)) return 0;
+    return data[1] >> 4;
+}
+
+uint8_t rucheFrameType(const uint8_t* data, size_t len) {
+    if (rucheFrameVersion(data, len) != RUCHE_FRAME_VERSION) return 0;
+    return data[1] & 0x0F;
+}
+
+static int32_t scaleClamp(float value, float scale, int32_t lo, int32_t hi) {
+    float scaled = roundf(value * scale);
+    if (scaled < (float)lo) return lo;
+    if (scaled > (float)hi) return hi;
+    return (int32_t)scaled;
+}
+
+static int16_t encodeTemp(float tempC) {
+    return isnan(tempC) ? RUCHE_FRAME_TEMP_ABSENT : (int16_t)scaleClamp(tempC, 10.0f, INT16_MIN + 1, INT16_MAX);
+}
+
+static uint8_t encodeHum(float humPct) {
+    return isnan(humPct) ? RUCHE_FRAME_U8_ABSENT : (uint8_t)scaleClamp(humPct, 1.0f, 0, 100);
+}
+
+static uint8_t clampU8(float value, float scale) {
+    return (uint8_t)scaleClamp(value, scale, 0, 0xFE);
+}
+
+void rucheEncodeStats(const RucheIntervalStats& in, RucheStatsBlock* out) {
+    RucheStatsBlock b;
+    memset(&b, 0, sizeof(b));
+    b.spanS = (uint16_t)(in.spanS > 0xFFFF ? 0xFFFF : in.spanS);
+    b.weightCount = (uint16_t)in.weight.count;
+    if (in.weight.count > 0) {
+        b.weightMeanCg = scaleClamp(in.weight.mean, 100.0f, INT32_MIN + 1, INT32_MAX);
+        b.weightMinDeltaG = (int16_t)scaleClamp(in.weight.min - in.weight.mean, 1.0f, INT16_MIN, INT16_MAX);
+        b.weightMaxDeltaG = (int16_t)scaleClamp(in.weight.max - in.weight.mean, 1.0f, INT16_MIN, INT16_MAX);
+        b.weightStdDg = (uint16_t)scaleClamp(in.weight.stddev, 10.0f, 0, 0xFFFF);
+    }
+    b.envCount = (uint16_t)in.temp.count;
+    b.tempMeanDeciC = RUCHE_FRAME_TEMP_ABSENT;
+    b.tempMinDeciC = RUCHE_FRAME_TEMP_ABSENT;
+    b.tempMaxDeciC = RUCHE_FRAME_TEMP_ABSENT;
+    b.humMeanPct = RUCHE_FRAME_U8_ABSENT;
+    b.humMinPct = RUCHE_FRAME_U8_ABSENT;
+    b.humMaxPct = RUCHE_FRAME_U8_ABSENT;
+    if (in.temp.count > 0) {
+        b.tempMeanDeciC = encodeTemp(in.temp.mean);
+        b.tempMinDeciC = encodeTemp(in.temp.min);
+        b.tempMaxDeciC = encodeTemp(in.temp.max);
+        b.tempStdDeciC = clampU8(in.temp.stddev, 10.0f);
+    }
+    if (in.hum.count > 0) {
+        b.humMeanPct = encodeHum(in.hum.mean);
+        b.humMinPct = encodeHum(in.hum.min);
+        b.humMaxPct = encodeHum(in.hum.max);
+        b.humStdDeciPct = clampU8(in.hum.stddev, 10.0f);
+    }
+    *out = b;
+}
+
+static void absentField(RucheStatField* f) {
+    f->count = 0;
+    f->mean = NAN;
+    f->min = NAN;
+    f->max = NAN;
+    f->stddev = NAN;
+}
+
+void rucheDecodeStats(const RucheStatsBlock& in, RucheIntervalStats* out) {
+    out->spanS = in.spanS;
+    absentField(&out->weight);
+    absentField(&out->temp);
+    absentField(&out->hum);
+    if (in.weightCount > 0) {
+        float mean = in.weightMeanCg / 100.0f;
+        out->weight.count = in.weightCount;
+        out->weight.mean = mean;
+        out->weight.min = mean + (float)in.weightMinDeltaG;
+        out->weight.max = mean + (float)in.weightMaxDeltaG;
+        out->weight.stddev = in.weightStdDg / 10.0f;
+    }
+    if (in.envCount > 0 && in.tempMeanDeciC != RUCHE_FRAME_TEMP_ABSENT) {
+        out->temp.count = in.envCount;
+        out->temp.mean = in.tempMeanDeciC / 10.0f;
+        out->temp.min = in.tempMinDeciC / 10.0f;
+        out->temp.max = in.tempMaxDeciC / 10.0f;
+        out->temp.stddev = in.tempStdDeciC / 10.0f;
+    }
+    if (in.envCount > 0 && in.humMeanPct != RUCHE_FRAME_U8_ABSENT) {
+        out->hum.count = in.envCount;
+        out->hum.mean = (float)in.humMeanPct;
+        out->hum.min = (float)in.humMinPct;
+        out->hum.max = (float)in.humMaxPct;
+        out->hum.stddev = in.humStdDeciPct / 10.0f;
+    }
+}
+
+size_t rucheEncodeTelemetry(const RucheTelemetry& in, uint8_t* out, size_t outSize) {
+    bool withStats = (in.flags & RUCHE_FLAG_STATS) != 0;
+    size_t body = offsetof(RucheTelemetryFrame, crc);
+    size_t total = sizeof(RucheTelemetryFrame) + (withStats ? sizeof(RucheStatsBlock) : 0);
+    if (out == NULL || outSize < total) return 0;
+
+    RucheTelemetryFrame f;
+    f.hdr.magic = RUCHE_FRAME_MAGIC;
+    f.hdr.versionType = (uint8_t)((RUCHE_FRAME_VERSION << 4) | RUCHE_FRAME_TYPE_TELEMETRY);
+    f.hdr.nodeId = in.nodeId;
+    f.hdr.seq = in.seq;
+    f.weightCg = scaleClamp(in.weightG, 100.0f, INT32_MIN + 1, INT32_MAX);
+    f.tempDeciC = encodeTemp(in.tempC);
+    f.humPct = encodeHum(in.humPct);
+    f.battPct = (in.battPct < 0) ? RUCHE_FRAME_U8_ABSENT : (uint8_t)(in.battPct > 100 ? 100 : in.battPct);
+    f.flags = in.flags;
+    memcpy(out, &f, body);
+    if (withStats) {
+        RucheStatsBlock b;
+        rucheEncodeStats(in.stats, &b);
+        memcpy(out + body, &b, sizeof(b));
+        body += sizeof(b);
+    }
+    uint16_t crc = rucheCrc16(out, body);
+    memcpy(out + body, &crc, sizeof(crc));
+    return total;
+}
+
+bool rucheDecodeTelemetry(const uint8_t* data, size_t len, RucheTelemetry* out) {
+    if (out == NULL || len < sizeof(RucheTelemetryFrame)) return false;
+    if (rucheFrameType(data, len) != RUCHE_FRAME_TYPE_TELEMETRY) return false;
+
+    RucheTelemetryFrame f;
+    size_t body = offsetof(RucheTelemetryFrame, crc);
+    memcpy(&f, data, body);
+    bool withStats = (f.flags & RUCHE_FLAG_STATS) != 0;
+    if (len != sizeof(RucheTelemetryFrame) + (withStats ? sizeof(RucheStatsBlock) : 0)) return false;
+    if (withStats) body += sizeof(RucheStatsBlock);
+    memcpy(&f.crc, data + body, sizeof(f.crc));
+    if (f.crc != rucheCrc16(data, body)) return false;
+
+    out->nodeId = f.hdr.nodeId;
+    out->seq = f.hdr.seq;
+    out->weightG = f.weightCg / 100.0f;
+    out->tempC = (f.tempDeciC == RUCHE_FRAME_TEMP_ABSENT) ? NAN : f.tempDeciC / 10.0f;
+    out->humPct = (f.humPct == RUCHE_FRAME_U8_ABSENT) ? NAN : (float)f.humPct;
+    out->battPct = (f.battPct == RUCHE_FRAME_U8_ABSENT) ? -1 : (int)f.battPct;
+    out->flags = f.flags;
+    if (withStats) {
+        RucheStatsBlock b;
+        memcpy(&b, data + offsetof(RucheTelemetryFrame, crc), sizeof(b));
+        rucheDecodeStats(b, &out->stats);
+    }
+    return true;
+}
+
+size_t rucheEncodeBatch(const RucheBatch& in, uint8_t* out, size_t outSize) {
+    if (out == NULL || in.count == 0 || in.count > RUCHE_BATCH_MAX_SAMPLES) return 0;
+    bool withStats = (in.flags & RUCHE_FLAG_STATS) != 0;
+    size_t total = rucheBatchFrameBytes(in.count, withStats);
+    if (outSize < total) return 0;
+
+    RucheBatchHeader h;
+    h.hdr.magic = RUCHE_FRAME_MAGIC;
+    h.hdr.versionType = (uint8_t)((RUCHE_FRAME_VERSION << 4) | RUCHE_FRAME_TYPE_BATCH);
+    h.hdr.nodeId = in.nodeId;
+    h.hdr.seq = in.seq;
+    h.count = in.count;
+    h.battPct = (in.battPct < 0) ? RUCHE_FRAME_U8_ABSENT : (uint8_t)(in.battPct > 100 ? 100 : in.battPct);
+    h.flags = in.flags;
+    memcpy(out, &h, sizeof(h));
+
+    uint8_t* p = out + sizeof(h);
+    for (uint8_t i = 0; i < in.count; i++) {
+        const RucheBatchEntry& e = in.entries[i];
+        RucheBatchSample s;
+        s.ageS = (uint16_t)(e.ageS > 0xFFFF ? 0xFFFF : e.ageS);
+        s.weightCg = scaleClamp(e.weightG, 100.0f, INT32_MIN + 1, INT32_MAX);
+        s.tempDeciC = encodeTemp(e.tempC);
+        s.humPct = encodeHum(e.humPct);
+        memcpy(p, &s, sizeof(s));
+        p += sizeof(s);
+    }
+    if (withStats) {
+        RucheStatsBlock b;
+        rucheEncodeStats(in.stats, &b);
+        memcpy(p, &b, sizeof(b));
+        p += sizeof(b);
+    }
+    uint16_t crc = rucheCrc16(out, (size_t)(p - out));
+    memcpy(p, &crc, sizeof(crc));
+    return total;
+}
+
+bool rucheDecodeBatch(const uint8_t* data, size_t len, RucheBatch* out) {
+    if (out == NULL || len < sizeof(RucheBatchHeader) + sizeof(uint16_t)) return false;
+    if (rucheFrameType(data, len) != RUCHE_FRAME_TYPE_BATCH) return false;
+
+    RucheBatchHeader h;
+    memcpy(&h, data, sizeof(h));
+    if (h.count == 0 || h.count > RUCHE_BATCH_MAX_SAMPLES) return false;
+    size_t samplesEnd = sizeof(h) + h.count * sizeof(RucheBatchSample);
+    bool withStats = (h.flags & RUCHE_FLAG_STATS) != 0;
+    size_t body = samplesEnd + (withStats ? sizeof(RucheStatsBlock) : 0);
+    if (len != body + sizeof(uint16_t)) return false;
+    uint16_t crc;
+    memcpy(&crc, data + body, sizeof(crc));
+    if (crc != rucheCrc16(data, body)) return false;
+
+    out->nodeId = h.hdr.nodeId;
+    out->seq = h.hdr.seq;
+    out->battPct = (h.battPct == RUCHE_FRAME_U8_ABSENT) ? -1 : (int)h.battPct;
+    out->flags = h.flags;
+    out->count = h.count;
+    const uint8_t* p = data + sizeof(h);
+    for (uint8_t i = 0; i < h.count; i++) {
+        RucheBatchSample s;
+        memcpy(&s, p, sizeof(s));
+        p += sizeof(s);
+        RucheBatchEntry& e = out->entries[i];
+        e.ageS = s.ageS;
+        e.weightG = s.weightCg / 100.0f;
+        e.tempC = (s.tempDeciC == RUCHE_FRAME_TEMP_ABSENT) ? NAN : s.tempDeciC / 10.0f;
+        e.humPct = (s.humPct == RUCHE_FRAME_U8_ABSENT) ? NAN : (float)s.humPct;
+    }
+    if (withStats) {
+        RucheStatsBlock b;
+        memcpy(&b, data + samplesEnd, sizeof(b));
+        rucheDecodeStats(b, &out->stats);
+    }
+    return true;
+}
+
+size_t rucheEncodeAck(const RucheAck& in, uint8_t* out, size_t outSize) {
+    if (out == NULL || outSize < sizeof(RucheAckFrame)) return 0;
+
+    RucheAckFrame f;
+    f.hdr.magic = RUCHE_FRAME_MAGIC;
+    f.hdr.versionType = (uint8_t)((RUCHE_FRAME_VERSION << 4) | RUCHE_FRAME_TYPE_ACK);
+    f.hdr.nodeId = in.nodeId;
+    f.hdr.seq = in.seq;
+    f.adrSf = in.adrSf;
+    f.adrPowerDbm = in.adrPowerDbm;
+    f.flags = in.flags;
+    f.tdmaSlot = in.tdmaSlot;
+    f.cyclePosMs = in.cyclePosMs;
+    f.crc = rucheCrc16((const uint8_t*)&f, offsetof(RucheAckFrame, crc));
+
+    memcpy(out, &f, sizeof(f));
+    return sizeof(f);
+}
+
+bool rucheDecodeAck(const uint8_t* data, size_t len, RucheAck* out) {
+    if (out == NULL || len != sizeof(RucheAckFrame)) return false;
+    if (rucheFrameType(data, len) != RUCHE_FRAME_TYPE_ACK) return false;
+
+    RucheAckFrame f;
+    memcpy(&f, data, sizeof(f));
+    if (f.crc != rucheCrc16(data, offsetof(RucheAckFrame, crc))) return false;
+
+    out->nodeId = f.hdr.nodeId;
+    out->seq = f.hdr.seq;
+    out->adrSf = f.adrSf;
+    out->adrPowerDbm = f.adrPowerDbm;
+    out->flags = f.flags;
+    out->tdmaSlot = f.tdmaSlot;
+    out->cyclePosMs = f.cyclePosMs;
+    return true;
+}
+
+void rucheFormatNodeName(uint16_t nodeId, char* out, size_t outSize) {
+    if (out == NULL || outSize == 0) return;
+    snprintf(out, outSize, "RUCHE%u", (unsigned)nodeId);
+}
+
+bool rucheParseNodeName(const char* name, uint16_t* nodeId) {
+    if (name == NULL || strncmp(name, "RUCHE", 5) != 0) return false;
+    const char* p = name + 5;
+    if (*p < '0' || *p > '9') return false;
+    uint32_t v = 0;
+    for (; *p >= '0' && *p <= '9'; p++) {
+        v = v * 10 + (uint32_t)(*p - '0');
+        if (v > 0xFFFF) return false;
+    }
+    if (*p != '\0') return false;
+    if (nodeId != NULL) *nodeId = (uint16_t)v;
+    return true;
+}
+
+uint16_t rucheNodeIdFromMac(uint64_t mac) {
+    // getEfuseMac(): octet 0 = premier octet OUI; octets 3..5 = partie carte.
+    uint32_t nic = (uint32_t)((mac >> 24) & 0xFFFFFFUL);
+    uint32_t h = nic * 2654435761u;        // hachage de Knuth, modulo 2^32
+    uint16_t id = (uint16_t)(h >> 16);
+    return (id == 0) ? 1 : id;
+}
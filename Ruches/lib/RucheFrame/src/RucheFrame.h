@@ -0,0 +1,225 @@
+/*
+ * Trame LoRa binaire partagee emetteur / recepteur.
+ * Format fixe, little-endian, versionne, protege par CRC16.
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef RUCHE_FRAME_H
+#define RUCHE_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Premier octet d'une trame binaire: hors ASCII imprimable, donc jamais
+// confondu avec les anciennes trames texte ("POIDS_G:...", "ACK:...").
+const uint8_t RUCHE_FRAME_MAGIC = 0xB7;
+// A incrementer a chaque changement de disposition d'une trame: les
+// decodeurs n'acceptent que leur version et le signalent (rucheFrameVersion).
+// 1: telemetrie, lot, ACK de 8 octets
+// 2: ACK de 14 octets (ADR, downlink, TDMA), bloc de statistiques
+const uint8_t RUCHE_FRAME_VERSION = 2;
+
+// Type de trame (4 bits de poids faible de l'octet version/type).
+const uint8_t RUCHE_FRAME_TYPE_TELEMETRY = 0x1;
+const uint8_t RUCHE_FRAME_TYPE_BATCH = 0x2;
+const uint8_t RUCHE_FRAME_TYPE_ACK = 0x3;      // recepteur -> emetteur
+
+// Nombre max de mesures dans une trame groupee.
+const uint8_t RUCHE_BATCH_MAX_SAMPLES = 16;
+
+// Valeurs "absentes" dans les champs mis a l'echelle.
+const int16_t RUCHE_FRAME_TEMP_ABSENT = INT16_MIN;
+const uint8_t RUCHE_FRAME_U8_ABSENT = 0xFF;
+
+// Drapeaux de la trame de telemetrie.
+const uint8_t RUCHE_FLAG_FAST_CHANGE = 0x01;   // envoi force par variation brusque
+const uint8_t RUCHE_FLAG_NOT_STABLE = 0x02;    // envoi force avant stabilisation HX711
+const uint8_t RUCHE_FLAG_CHARGING = 0x04;      // tension batterie en hausse
+const uint8_t RUCHE_FLAG_HEARTBEAT = 0x08;     // envoi de garde: valeurs inchangees depuis le dernier ACK
+const uint8_t RUCHE_FLAG_ADR_DEFAULT = 0x10;   // emetteur sur le profil radio par defaut (repli ADR)
+const uint8_t RUCHE_FLAG_RX_ALWAYS = 0x20;     // emetteur en reception continue (pas de deep sleep)
+const uint8_t RUCHE_FLAG_SEQ_RESET = 0x40;     // seq repartie de 0 (demarrage a froid, pas encore d'ACK)
+const uint8_t RUCHE_FLAG_STATS = 0x80;         // bloc RucheStatsBlock juste avant le CRC
+
+// Drapeaux de l'ACK.
+const uint8_t RUCHE_ACK_FLAG_DOWNLINK = 0x01;  // une commande suit dans la fenetre de reception
+
+#pragma pack(push, 1)
+struct RucheFrameHeader {
+    uint8_t magic;
+    uint8_t versionType;    // (version << 4) | type
+    uint16_t nodeId;
+    uint16_t seq;
+};
+
+struct RucheTelemetryFrame {
+    RucheFrameHeader hdr;
+    int32_t weightCg;       // poids en centigrammes (0.01 g)
+    int16_t tempDeciC;      // temperature en 0.1 C
+    uint8_t humPct;         // humidite en %
+    uint8_t battPct;        // batterie en %
+    uint8_t flags;
+    uint16_t crc;           // CRC16-CCITT sur tous les octets precedents
+};
+
+// Trame groupee: en-tete + count echantillons + CRC16.
+struct RucheBatchHeader {
+    RucheFrameHeader hdr;
+    uint8_t count;
+    uint8_t battPct;        // batterie au moment de l'envoi
+    uint8_t flags;
+};
+
+// Acquittement d'une trame de telemetrie ou groupee: hdr.seq = seq acquittee.
+// adrSf = 0: pas de recommandation radio (voir RucheAdr.h).
+// tdmaSlot / cyclePosMs: creneau du noeud et horloge du recepteur (RucheTdma.h).
+struct RucheAckFrame {
+    RucheFrameHeader hdr;
+    uint8_t adrSf;
+    int8_t adrPowerDbm;
+    uint8_t flags;
+    uint8_t tdmaSlot;
+    uint16_t cyclePosMs;
+    uint16_t crc;
+};
+
+struct RucheBatchSample {
+    uint16_t ageS;          // anciennete de la mesure au moment de l'envoi
+    int32_t weightCg;
+    int16_t tempDeciC;
+    uint8_t humPct;
+};
+
+// Statistiques de l'intervalle depuis la trame precedente (RUCHE_FLAG_STATS).
+// Min/max du poids en ecart a la moyenne; temperature et humidite
+// mesurees ensemble (un seul compte). Compte 0: champs absents.
+struct RucheStatsBlock {
+    uint16_t spanS;         // premiere mesure -> envoi
+    uint16_t weightCount;
+    int32_t weightMeanCg;
+    int16_t weightMinDeltaG;
+    int16_t weightMaxDeltaG;
+    uint16_t weightStdDg;   // ecart-type en 0.1 g
+    uint16_t envCount;
+    int16_t tempMeanDeciC;
+    int16_t tempMinDeciC;
+    int16_t tempMaxDeciC;
+    uint8_t tempStdDeciC;
+    uint8_t humMeanPct;
+    uint8_t humMinPct;
+    uint8_t humMaxPct;
+    uint8_t humStdDeciPct;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(RucheFrameHeader) == 6, "RucheFrameHeader doit rester compact");
+static_assert(sizeof(RucheTelemetryFrame) == 17, "RucheTelemetryFrame doit rester compact");
+static_assert(sizeof(RucheBatchHeader) == 9, "RucheBatchHeader doit rester compact");
+static_assert(sizeof(RucheBatchSample) == 9, "RucheBatchSample doit rester compact");
+static_assert(sizeof(RucheAckFrame) == 14, "RucheAckFrame doit rester compact");
+static_assert(sizeof(RucheStatsBlock) == 27, "RucheStatsBlock doit rester compact");
+
+// Taille d'une trame groupee de count mesures, bloc de statistiques compris ou non.
+constexpr size_t rucheBatchFrameBytes(size_t count, bool withStats) {
+    return sizeof(RucheBatchHeader) + count * sizeof(RucheBatchSample) +
+           (withStats ? sizeof(RucheStatsBlock) : 0) + sizeof(uint16_t);
+}
+
+const size_t RUCHE_TELEMETRY_MAX_BYTES = sizeof(RucheTelemetryFrame) + sizeof(RucheStatsBlock);
+const size_t RUCHE_BATCH_MAX_BYTES = rucheBatchFrameBytes(RUCHE_BATCH_MAX_SAMPLES, true);
+
+// Une grandeur de l'intervalle, unites physiques; NAN si count = 0.
+struct RucheStatField {
+    uint16_t count;
+    float mean;
+    float min;
+    float max;
+    float stddev;
+};
+
+struct RucheIntervalStats {
+    uint32_t spanS;
+    RucheStatField weight;
+    RucheStatField temp;
+    RucheStatField hum;     // meme compte que temp une fois decode
+};
+
+// Mesure decodee, unites physiques.
+struct RucheTelemetry {
+    uint16_t nodeId;
+    uint16_t seq;
+    float weightG;
+    float tempC;        // NAN si absente
+    float humPct;       // NAN si absente
+    int battPct;        // -1 si absente
+    uint8_t flags;
+    RucheIntervalStats stats;   // lu seulement avec RUCHE_FLAG_STATS
+};
+
+// Un echantillon d'une trame groupee, unites physiques.
+struct RucheBatchEntry {
+    uint32_t ageS;
+    float weightG;
+    float tempC;        // NAN si absente
+    float humPct;       // NAN si absente
+};
+
+struct RucheBatch {
+    uint16_t nodeId;
+    uint16_t seq;
+    int battPct;        // -1 si absente
+    uint8_t flags;
+    uint8_t count;
+    RucheBatchEntry entries[RUCHE_BATCH_MAX_SAMPLES];   // du plus ancien au plus recent
+    RucheIntervalStats stats;   // lu seulement avec RUCHE_FLAG_STATS
+};
+
+uint16_t rucheCrc16(const uint8_t* data, size_t len);
+
+// true si le buffer commence comme une trame binaire (magic), quelle
+// que soit sa version: jamais a traiter comme du texte.
+bool rucheIsBinaryFrame(const uint8_t* data, size_t len);
+// Version annoncee par une trame binaire, 0 si ce n'en est pas une.
+uint8_t rucheFrameVersion(const uint8_t* data, size_t len);
+// Type d'une trame de la version RUCHE_FRAME_VERSION, 0 sinon.
+uint8_t rucheFrameType(const uint8_t* data, size_t len);
+
+// Bloc de statistiques <-> unites physiques (bornage aux champs du bloc).
+void rucheEncodeStats(const RucheIntervalStats& in, RucheStatsBlock* out);
+void rucheDecodeStats(const RucheStatsBlock& in, RucheIntervalStats* out);
+
+// Encode une mesure (bloc de statistiques si RUCHE_FLAG_STATS); retourne
+// le nombre d'octets ecrits ou 0 si buffer trop petit.
+size_t rucheEncodeTelemetry(const RucheTelemetry& in, uint8_t* out, size_t outSize);
+
+// Decode une trame de telemetrie; false si taille, version ou CRC invalides.
+bool rucheDecodeTelemetry(const uint8_t* data, size_t len, RucheTelemetry* out);
+
+// Encode une trame groupee (count <= RUCHE_BATCH_MAX_SAMPLES).
+size_t rucheEncodeBatch(const RucheBatch& in, uint8_t* out, size_t outSize);
+bool rucheDecodeBatch(const uint8_t* data, size_t len, RucheBatch* out);
+
+// Acquittement decode (nodeId = noeud destinataire, seq = trame acquittee).
+struct RucheAck {
+    uint16_t nodeId;
+    uint16_t seq;
+    uint8_t adrSf;          // 0 si pas de recommandation
+    int8_t adrPowerDbm;
+    uint8_t flags;          // RUCHE_ACK_FLAG_*
+    uint8_t tdmaSlot;       // RUCHE_TDMA_NO_SLOT si aucun
+    uint16_t cyclePosMs;    // position du recepteur dans son cycle a l'emission
+};
+
+size_t rucheEncodeAck(const RucheAck& in, uint8_t* out, size_t outSize);
+bool rucheDecodeAck(const uint8_t* data, size_t len, RucheAck* out);
+
+// Nom lisible du noeud, ex: 1 -> "RUCHE1".
+void rucheFormatNodeName(uint16_t nodeId, char* out, size_t outSize);
+// Inverse: "RUCHE12" -> 12; false si le nom n'a pas cette forme.
+bool rucheParseNodeName(const char* name, uint16_t* nodeId);
+
+// Identifiant derive de l'adresse MAC (eFuse) quand aucun n'est configure:
+// melange des 3 octets propres a la carte, jamais 0 (0 = non configure).
+uint16_t rucheNodeIdFromMac(uint64_t mac);
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Cadence d'emission apprise par noeud, pour dater la prochaine trame
+ * attendue au lieu d'un seuil de silence global.
+ *
+ * Intervalle par trame = ecart d'arrivee / ecart de sequence (une trame
+ * perdue ne double pas l'estimation). Comme le RTO de TCP: moyenne
+ * lissee (1/8) + 4 x ecart moyen (1/4). L'emetteur n'envoie que sur
+ * variation ou battement de garde: le plus long intervalle recent est
+ * aussi retenu (oubli de 1/16 par trame), pour qu'une ruche calme ne
+ * passe pas pour perdue a chaque battement.
+ * Pas de constructeurs: objet remis a zero par reset(). Temps en ms 32
+ * bits, ecarts par soustraction non signee.
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef RUCHE_LIVENESS_H
+#define RUCHE_LIVENESS_H
+
+#include <stdint.h>
+
+// Bornes de l'intervalle attendu; defaut tant qu'aucun ecart n'est connu.
+const uint32_t RUCHE_LIVENESS_DEFAULT_MS = 600000;     // 10 min
+const uint32_t RUCHE_LIVENESS_MIN_MS = 30000;
+const uint32_t RUCHE_LIVENESS_MAX_MS = 7200000;        // 2 h
+const uint32_t RUCHE_LIVENESS_GRACE_MS = 5000;         // temps d'antenne, derive RTC
+const uint16_t RUCHE_LIVENESS_MAX_SEQ_GAP = 16;        // au-dela: ecart non divise
+
+struct RucheCadence {
+    uint32_t meanMs;
+    uint32_t devMs;
+    uint32_t peakMs;
+    uint32_t lastMs;
+    uint16_t intervals;         // ecarts mesures (plafonne)
+    bool seen;
+
+    void reset() {
+        meanMs = 0;
+        devMs = 0;
+        peakMs = 0;
+        lastMs = 0;
+        intervals = 0;
+        seen = false;
+    }
+
+    // Trame recue; seqGap = ecart de sequence avec la precedente (1 sans
+    // perte, 0 si inconnu: resynchro, trame texte).
+    void onFrame(uint32_t nowMs, uint16_t seqGap) {
+        if (seen) {
+            uint32_t dt = nowMs - lastMs;
+            if (seqGap > 1 && seqGap <= RUCHE_LIVENESS_MAX_SEQ_GAP) dt /= seqGap;
+            if (dt > RUCHE_LIVENESS_MAX_MS) dt = RUCHE_LIVENESS_MAX_MS;
+            if (intervals == 0) {
+                meanMs = dt;
+                devMs = dt / 2;
+                peakMs = dt;
+            } else {
+                int32_t err = (int32_t)dt - (int32_t)meanMs;
+                uint32_t absErr = (uint32_t)(err < 0 ? -err : err);
+                meanMs = (uint32_t)((int32_t)meanMs + err / 8);
+                devMs = (uint32_t)((int32_t)devMs + ((int32_t)absErr - (int32_t)devMs) / 4);
+                peakMs -= peakMs / 16;
+                if (dt > peakMs) peakMs = dt;
+            }
+            if (intervals < 0xFFFF) intervals++;
+        }
+        lastMs = nowMs;
+        seen = true;
+    }
+
+    // Intervalle apres lequel une trame est comptee manquante.
+    uint32_t expectedMs() const {
+        uint32_t e = RUCHE_LIVENESS_DEFAULT_MS;
+        if (intervals > 0) {
+            e = meanMs + 4 * devMs;
+            if (peakMs > e) e = peakMs;
+        }
+        if (e < RUCHE_LIVENESS_MIN_MS) e = RUCHE_LIVENESS_MIN_MS;
+        if (e > RUCHE_LIVENESS_MAX_MS) e = RUCHE_LIVENESS_MAX_MS;
+        return e + RUCHE_LIVENESS_GRACE_MS;
+    }
+
+    // Echeance de la n-ieme trame manquante (n >= 1).
+    uint32_t deadlineMs(uint16_t missed) const {
+        return lastMs + (uint32_t)missed * expectedMs();
+    }
+};
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Table d'etat par noeud du recepteur, indexee par nodeId.
+ *
+ * Adressage ouvert (sondage lineaire) dans un tableau fixe: aucune
+ * allocation, recherche en O(1) tant que la table reste a moitie vide
+ * (CAPACITY = puissance de 2, prevoir ~2x le nombre de ruches).
+ * Pas de suppression: un rucher ne perd pas ses noeuds en marche.
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef RUCHE_NODE_TABLE_H
+#define RUCHE_NODE_TABLE_H
+
+#include <stdint.h>
+
+template <typename T, uint16_t CAPACITY>
+struct RucheNodeTable {
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+                  "CAPACITY doit etre une puissance de 2");
+
+    uint16_t keys[CAPACITY];
+    bool used[CAPACITY];
+    T values[CAPACITY];
+    uint16_t count;
+
+    void reset() {
+        for (uint16_t i = 0; i < CAPACITY; i++) used[i] = false;
+        count = 0;
+    }
+
+    static uint16_t home(uint16_t nodeId) {
+        // Hachage multiplicatif: les nodeId voisins (1, 2, 3...) s'etalent.
+        return (uint16_t)(((uint32_t)nodeId * 40503u) & (CAPACITY - 1));
+    }
+
+    // Case du noeud, ou -1 s'il est inconnu.
+    int slotOf(uint16_t nodeId) const {
+        uint16_t i = home(nodeId);
+        for (uint16_t n = 0; n < CAPACITY; n++) {
+            if (!used[i]) return -1;
+            if (keys[i] == nodeId) return i;
+            i = (uint16_t)((i + 1) & (CAPACITY - 1));
+        }
+        return -1;
+    }
+
+    T* find(uint16_t nodeId) {
+        int i = slotOf(nodeId);
+        return (i < 0) ? 0 : &values[i];
+    }
+
+    // Etat du noeud, cree (T remis a zero par reset()) s'il est nouveau;
+    // NULL si la table est pleine.
+    T* findOrInsert(uint16_t nodeId, bool* inserted = 0) {
+        if (inserted) *inserted = false;
+        uint16_t i = home(nodeId);
+        for (uint16_t n = 0; n < CAPACITY; n++) {
+            if (!used[i]) {
+                used[i] = true;
+                keys[i] = nodeId;
+                values[i].reset();
+                count++;
+                if (inserted) *inserted = true;
+                return &values[i];
+            }
+            if (keys[i] == nodeId) return &values[i];
+            i = (uint16_t)((i + 1) & (CAPACITY - 1));
+        }
+        return 0;
+    }
+
+    bool full() const { return count >= CAPACITY; }
+
+    // Parcours par case: for (i = 0; i < CAPACITY; i++) if (used[i]) ...
+    // Case occupee suivant "from" (circulaire), ou -1 si table vide.
+    int nextUsed(int from) const {
+        for (uint16_t n = 1; n <= CAPACITY; n++) {
+            uint16_t i = (uint16_t)((from + n) & (CAPACITY - 1));
+            if (used[i]) return i;
+        }
+        return -1;
+    }
+};
+
+#endif
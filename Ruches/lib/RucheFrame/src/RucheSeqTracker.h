@@ -0,0 +1,106 @@
+/*
+ * Suivi des numeros de sequence d'un noeud cote recepteur.
+ *
+ * Fenetre glissante de 32 trames derriere la plus haute sequence vue
+ * (facon anti-rejeu IPsec): une trame deja vue est un doublon, une trame
+ * en retard comble un trou compte perdu (hors ordre). Les trous au-dela
+ * de la plus haute sequence comptent comme pertes; le PER en decoule.
+ * Apres un redemarrage a froid de l'emetteur (seq repart de 0, trames
+ * marquees RUCHE_FLAG_SEQ_RESET), ou sur un saut enorme, la fenetre
+ * repart de zero sans compter de pertes.
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef RUCHE_SEQ_TRACKER_H
+#define RUCHE_SEQ_TRACKER_H
+
+#include <stdint.h>
+
+const uint8_t RUCHE_SEQ_WINDOW = 32;
+const uint16_t RUCHE_SEQ_MAX_GAP = 1024;       // saut plus grand: emetteur redemarre
+
+enum RucheSeqVerdict {
+    RUCHE_SEQ_NEW = 0,          // trame nouvelle, dans l'ordre
+    RUCHE_SEQ_LATE = 1,         // trame nouvelle, hors ordre (comble un trou)
+    RUCHE_SEQ_DUPLICATE = 2,    // deja recue: a ignorer
+    RUCHE_SEQ_RESYNC = 3        // fenetre repartie de zero (premiere trame, redemarrage)
+};
+
+// Objet a zero = aucune trame vue.
+struct RucheSeqTracker {
+    uint32_t window;            // bit i = trame (highest - i) recue
+    uint16_t highest;
+    bool valid;
+    uint32_t received;          // trames uniques
+    uint32_t lost;              // trous non combles
+    uint32_t duplicates;
+    uint32_t outOfOrder;
+    uint32_t resyncs;
+
+    void reset() {
+        window = 0;
+        highest = 0;
+        valid = false;
+        received = 0;
+        lost = 0;
+        duplicates = 0;
+        outOfOrder = 0;
+        resyncs = 0;
+    }
+
+    // senderRebooted: trame emise avant le premier ACK depuis le
+    // demarrage de l'emetteur, donc seq compte depuis 0.
+    RucheSeqVerdict accept(uint16_t seq, bool senderRebooted = false) {
+        if (!valid) return restart(seq, false);
+        int16_t d = (int16_t)(uint16_t)(seq - highest);
+        if (senderRebooted && (d < 0 || (d > 0 && (uint16_t)d > seq))) {
+            // highest ne vient pas de ce demarrage (sinon highest <= seq).
+            return restart(seq, true);
+        }
+        if (d == 0) {
+            duplicates++;
+            return RUCHE_SEQ_DUPLICATE;
+        }
+        if (d > 0) {
+            if ((uint16_t)d > RUCHE_SEQ_MAX_GAP) return restart(seq, true);
+            lost += (uint32_t)(d - 1);
+            window = ((uint16_t)d >= RUCHE_SEQ_WINDOW) ? 1u : ((window << d) | 1u);
+            highest = seq;
+            received++;
+            return RUCHE_SEQ_NEW;
+        }
+        uint16_t back = (uint16_t)(-d);
+        if (back >= RUCHE_SEQ_WINDOW) {
+            // Trop vieille pour la fenetre: retard enorme ou redemarrage.
+            return restart(seq, true);
+        }
+        uint32_t bit = 1u << back;
+        if (window & bit) {
+            duplicates++;
+            return RUCHE_SEQ_DUPLICATE;
+        }
+        window |= bit;
+        if (lost > 0) lost--;
+        outOfOrder++;
+        received++;
+        return RUCHE_SEQ_LATE;
+    }
+
+    // Taux de perte en %, sur toute la vie du suivi.
+    float perPct() const {
+        uint32_t total = received + lost;
+        return (total == 0) ? 0.0f : 100.0f * (float)lost / (float)total;
+    }
+
+    // Repart de zero sur seq (counted: redemarrage detecte).
+    RucheSeqVerdict restart(uint16_t seq, bool counted) {
+        if (counted) resyncs++;
+        window = 1;
+        highest = seq;
+        valid = true;
+        received++;
+        return RUCHE_SEQ_RESYNC;
+    }
+};
+
+#endif
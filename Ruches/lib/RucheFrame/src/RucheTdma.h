@@ -0,0 +1,117 @@
+/*
+ * Creneaux TDMA des trames montantes, cales sur l'horloge du recepteur.
+ *
+ * Le recepteur decoupe le temps en cycles de RUCHE_TDMA_CYCLE_MS et
+ * attribue un creneau a chaque noeud. Pas de balise dediee: chaque ACK
+ * porte le creneau du noeud et la position du recepteur dans le cycle.
+ * L'emetteur en deduit son decalage d'horloge (et la derive de son RTC
+ * pendant le deep sleep), puis cale son reveil pour emettre au debut de
+ * son creneau, apres une garde. Les durees de sommeil (30/60/300/900 s)
+ * sont des multiples du cycle: le creneau reste le meme a chaque reveil.
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef RUCHE_TDMA_H
+#define RUCHE_TDMA_H
+
+#include <stdint.h>
+
+const uint32_t RUCHE_TDMA_CYCLE_MS = 30000;
+const uint32_t RUCHE_TDMA_SLOT_MS = 500;        // trame + ACK + commande a SF7
+const uint8_t RUCHE_TDMA_SLOTS = (uint8_t)(RUCHE_TDMA_CYCLE_MS / RUCHE_TDMA_SLOT_MS);
+const uint32_t RUCHE_TDMA_GUARD_MS = 50;        // derive residuelle en debut de creneau
+const uint8_t RUCHE_TDMA_NO_SLOT = 0xFF;        // pas de creneau: acces libre (ALOHA)
+const uint32_t RUCHE_TDMA_DRIFT_TAU_MS = 300000; // lissage de l'estimation de derive
+
+// Position d'emission dans le cycle pour un creneau.
+inline uint32_t rucheTdmaSlotStartMs(uint8_t slot) {
+    return (uint32_t)slot * RUCHE_TDMA_SLOT_MS + RUCHE_TDMA_GUARD_MS;
+}
+
+// Ecart signe a - b ramene dans ]-cycle/2, cycle/2].
+inline int32_t rucheTdmaWrap(int64_t deltaMs) {
+    int64_t c = (int64_t)RUCHE_TDMA_CYCLE_MS;
+    int64_t d = deltaMs % c;
+    if (d > c / 2) d -= c;
+    if (d <= -c / 2) d += c;
+    return (int32_t)d;
+}
+
+// Horloge de l'emetteur calee sur le cycle du recepteur. Temps local en
+// ms sur une base continue a travers le deep sleep. Objet a zero = non
+// synchronise (RTC_DATA_ATTR).
+struct RucheTdmaClock {
+    uint64_t syncLocalMs;       // temps local du dernier ACK
+    uint32_t syncCyclePosMs;    // position du recepteur a cet instant
+    float driftPpm;             // ecart du temps local mesure sur le recepteur
+    uint8_t slot;
+    bool synced;
+
+    void reset() {
+        syncLocalMs = 0;
+        syncCyclePosMs = 0;
+        driftPpm = 0.0f;
+        slot = RUCHE_TDMA_NO_SLOT;
+        synced = false;
+    }
+
+    bool hasSlot() const {
+        return synced && slot != RUCHE_TDMA_NO_SLOT && slot < RUCHE_TDMA_SLOTS;
+    }
+
+    // Position estimee du recepteur dans son cycle au temps local t.
+    uint32_t cyclePosAt(uint64_t localMs) const {
+        int64_t elapsed = (int64_t)(localMs - syncLocalMs);
+        int64_t corrected = elapsed + (int64_t)((double)elapsed * driftPpm * 1e-6);
+        int64_t pos = ((int64_t)syncCyclePosMs + corrected) % (int64_t)RUCHE_TDMA_CYCLE_MS;
+        if (pos < 0) pos += RUCHE_TDMA_CYCLE_MS;
+        return (uint32_t)pos;
+    }
+
+    // ACK recu au temps local t (deja corrige du temps d'antenne).
+    void onSync(uint64_t localMs, uint32_t cyclePosMs, uint8_t newSlot) {
+        if (synced && localMs > syncLocalMs) {
+            // Erreur de phase depuis la derniere synchro: derive du RTC.
+            // Ambigue modulo un cycle: ignoree au-dela d'un quart de cycle.
+            uint64_t elapsed = localMs - syncLocalMs;
+            int32_t err = rucheTdmaWrap((int64_t)cyclePosMs - (int64_t)cyclePosAt(localMs));
+            bool plausible = err < (int32_t)(RUCHE_TDMA_CYCLE_MS / 4) && err > -(int32_t)(RUCHE_TDMA_CYCLE_MS / 4);
+            if (elapsed >= RUCHE_TDMA_CYCLE_MS && plausible) {
+                float measured = driftPpm + (float)((double)err * 1e6 / (double)elapsed);
+                if (measured > 50000.0f) measured = 50000.0f;
+                if (measured < -50000.0f) measured = -50000.0f;
+                // Poids croissant avec l'intervalle: les longs sommeils
+                // mesurent la derive du RTC bien mieux que les reveils courts.
+                float w = (float)elapsed / (float)(elapsed + RUCHE_TDMA_DRIFT_TAU_MS);
+                driftPpm += w * (measured - driftPpm);
+            }
+        }
+        syncLocalMs = localMs;
+        syncCyclePosMs = cyclePosMs % RUCHE_TDMA_CYCLE_MS;
+        slot = newSlot;
+        synced = true;
+    }
+
+    // Attente (ms locales) avant le debut du creneau, dans [0, cycle[.
+    uint32_t msUntilSlot(uint64_t localMs) const {
+        if (!hasSlot()) return 0;
+        int64_t d = (int64_t)rucheTdmaSlotStartMs(slot) - (int64_t)cyclePosAt(localMs);
+        d %= (int64_t)RUCHE_TDMA_CYCLE_MS;
+        if (d < 0) d += RUCHE_TDMA_CYCLE_MS;
+        return (uint32_t)((double)d / (1.0 + driftPpm * 1e-6));
+    }
+
+    // Duree de sommeil proche de wantedMs qui reveille leadMs avant le
+    // creneau (le temps de mesurer). Sans creneau: wantedMs inchange.
+    uint32_t alignedSleepMs(uint64_t nowLocalMs, uint32_t wantedMs, uint32_t leadMs) const {
+        if (!hasSlot()) return wantedMs;
+        uint64_t wake = nowLocalMs + wantedMs;
+        int64_t target = (int64_t)rucheTdmaSlotStartMs(slot) - (int64_t)leadMs;
+        int32_t shift = rucheTdmaWrap(target - (int64_t)cyclePosAt(wake));
+        int64_t sleepMs = (int64_t)wantedMs + (int64_t)((double)shift / (1.0 + driftPpm * 1e-6));
+        if (sleepMs < (int64_t)RUCHE_TDMA_CYCLE_MS / 2) sleepMs += RUCHE_TDMA_CYCLE_MS;
+        return (uint32_t)sleepMs;
+    }
+};
+
+#endif
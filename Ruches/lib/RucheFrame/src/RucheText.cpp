@@ -0,0 +1,175 @@
+#include "RucheText.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void rucheTrimView(const char** s, size_t* len) {
+    const char* p = *s;
+    size_t n = *len;
+    while (n > 0 && isSpace(*p)) {
+        p++;
+        n--;
+    }
+    while (n > 0 && isSpace(p[n - 1])) n--;
+    *s = p;
+    *len = n;
+}
+
+bool rucheParseDecimal(const char* s, size_t len, float* out) {
+    if (s == NULL) return false;
+    rucheTrimView(&s, &len);
+    const char* end = s + len;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = (*s == '-');
+        s++;
+    }
+    // Mantisse sur 18 chiffres significatifs au plus; les decimales
+    // suivantes sont ignorees, un entier plus long est refuse.
+    uint64_t mantissa = 0;
+    uint8_t digits = 0;
+    uint8_t fracDigits = 0;
+    bool any = false;
+    for (; s < end && *s >= '0' && *s <= '9'; s++) {
+        if (digits >= 18) return false;
+        mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+        if (mantissa != 0) digits++;
+        any = true;
+    }
+    if (s < end && *s == '.') {
+        s++;
+        for (; s < end && *s >= '0' && *s <= '9'; s++) {
+            any = true;
+            if (digits >= 18) continue;
+            mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+            if (mantissa != 0) digits++;
+            fracDigits++;
+        }
+    }
+    if (!any || s != end) return false;
+    double v = (double)mantissa;
+    for (uint8_t i = 0; i < fracDigits; i++) v /= 10.0;
+    if (out != NULL) *out = (float)(negative ? -v : v);
+    return true;
+}
+
+static bool keyIs(const char* key, size_t keyLen, const char* name) {
+    size_t n = strlen(name);
+    return keyLen == n && memcmp(key, name, n) == 0;
+}
+
+bool rucheParseTextTelemetry(const char* s, size_t len, RucheTextTelemetry* out) {
+    if (s == NULL || out == NULL) return false;
+    memset(out, 0, sizeof(*out));
+    bool any = false;
+    const char* end = s + len;
+    const char* tok = s;
+    while (tok < end) {
+        const char* sep = (const char*)memchr(tok, ',', (size_t)(end - tok));
+        const char* tokEnd = (sep != NULL) ? sep : end;
+        const char* colon = (const char*)memchr(tok, ':', (size_t)(tokEnd - tok));
+        if (colon != NULL) {
+            const char* key = tok;
+            size_t keyLen = (size_t)(colon - tok);
+            rucheTrimView(&key, &keyLen);
+            const char* val = colon + 1;
+            size_t valLen = (size_t)(tokEnd - val);
+            float v;
+            if (rucheParseDecimal(val, valLen, &v)) {
+                if (keyIs(key, keyLen, "POIDS_G") || keyIs(key, keyLen, "POIDS")) {
+                    out->weightG = v;
+                    out->hasWeight = true;
+                    any = true;
+                } else if (keyIs(key, keyLen, "T_C")) {
+                    out->tempC = v;
+                    out->hasTemp = true;
+                    any = true;
+                } else if (keyIs(key, keyLen, "H_P")) {
+                    out->humPct = v;
+                    out->hasHum = true;
+                    any = true;
+                } else if (keyIs(key, keyLen, "B_P")) {
+                    out->battPct = v;
+                    out->hasBatt = true;
+                    any = true;
+                }
+            }
+        }
+        tok = tokEnd + 1;
+    }
+    return any;
+}
+
+static bool equalsNoCase(const char* s, size_t len, const char* word) {
+    size_t n = strlen(word);
+    return len == n && strncasecmp(s, word, n) == 0;
+}
+
+static bool startsNoCase(const char* s, size_t len, const char* prefix) {
+    size_t n = strlen(prefix);
+    return len >= n && strncasecmp(s, prefix, n) == 0;
+}
+
+// Commandes comprises par l'emetteur: TARE, CAL_START, CAL:<masse>.
+static bool isNodeCommand(const char* s, size_t len) {
+    if (equalsNoCase(s, len, "TARE") || equalsNoCase(s, len, "CAL_START")) return true;
+    return startsNoCase(s, len, "CAL:") && rucheParseDecimal(s + 4, len - 4, NULL);
+}
+
+static size_t writeFrame(char* out, size_t outSize, const char* target, size_t targetLen,
+                         const char* prefix, const char* cmd, size_t cmdLen) {
+    int n = snprintf(out, outSize, "CMD:%.*s:%s%.*s", (int)targetLen, target, prefix, (int)cmdLen, cmd);
+    return (n > 0 && (size_t)n < outSize) ? (size_t)n : 0;
+}
+
+size_t rucheBuildCommandFrame(const char* in, size_t len, const char* defaultTarget,
+                              char* out, size_t outSize) {
+    if (in == NULL || out == NULL || outSize == 0) return 0;
+    out[0] = '\0';
+    rucheTrimView(&in, &len);
+    if (len == 0) return 0;
+    if (defaultTarget == NULL) defaultTarget = "*";
+
+    if (len >= 4 && memcmp(in, "CMD:", 4) == 0) {
+        if (len >= outSize) return 0;
+        memcpy(out, in, len);
+        out[len] = '\0';
+        return len;
+    }
+    if (isNodeCommand(in, len)) {
+        return writeFrame(out, outSize, defaultTarget, strlen(defaultTarget), "", in, len);
+    }
+    // "cal 500", "cal500", "cal:500": masse connue pour le noeud par defaut.
+    if (startsNoCase(in, len, "cal")) {
+        const char* mass = in + 3;
+        size_t massLen = len - 3;
+        if (massLen > 0 && *mass == ':') {
+            mass++;
+            massLen--;
+        }
+        rucheTrimView(&mass, &massLen);
+        if (massLen > 0 && rucheParseDecimal(mass, massLen, NULL)) {
+            return writeFrame(out, outSize, defaultTarget, strlen(defaultTarget), "CAL:", mass, massLen);
+        }
+        return 0;
+    }
+    // "<cible>:<commande>"
+    const char* sep = (const char*)memchr(in, ':', len);
+    if (sep != NULL && sep > in) {
+        const char* target = in;
+        size_t targetLen = (size_t)(sep - in);
+        const char* cmd = sep + 1;
+        size_t cmdLen = len - targetLen - 1;
+        rucheTrimView(&target, &targetLen);
+        rucheTrimView(&cmd, &cmdLen);
+        if (targetLen > 0 && isNodeCommand(cmd, cmdLen)) {
+            return writeFrame(out, outSize, target, targetLen, "", cmd, cmdLen);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * Trames texte historiques et commandes, sans String ni tas.
+ *
+ * Telemetrie des anciens emetteurs: "POIDS_G:12.34,T_C:21.5,H_P:55,B_P:80"
+ * ("POIDS:" sur les plus anciens), lue en une passe sur une vue
+ * pointeur + longueur. Commandes: "CMD:<cible>:<commande>" construite
+ * dans un tampon fixe a partir de ce que tapent la console serie et le
+ * tableau de bord ("tare", "cal 500", "RUCHE3:CAL_START"...).
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef RUCHE_TEXT_H
+#define RUCHE_TEXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Champs presents dans une trame texte; les autres gardent leur valeur
+// precedente cote recepteur.
+struct RucheTextTelemetry {
+    bool hasWeight;
+    bool hasTemp;
+    bool hasHum;
+    bool hasBatt;
+    float weightG;
+    float tempC;
+    float humPct;
+    float battPct;
+};
+
+// Nombre decimal "[-+]chiffres[.chiffres]", espaces autour toleres.
+// Refuse exposant, "nan", "inf" et texte parasite.
+bool rucheParseDecimal(const char* s, size_t len, float* out);
+
+// true si au moins un champ connu a ete lu.
+bool rucheParseTextTelemetry(const char* s, size_t len, RucheTextTelemetry* out);
+
+// Commande utilisateur -> "CMD:<cible>:<commande>" (cible par defaut si
+// absente). Retourne la longueur ecrite, 0 si invalide ou trop longue.
+size_t rucheBuildCommandFrame(const char* in, size_t len, const char* defaultTarget,
+                              char* out, size_t outSize);
+
+// Vue sans les espaces de debut et de fin.
+void rucheTrimView(const char** s, size_t* len);
+
+#endif
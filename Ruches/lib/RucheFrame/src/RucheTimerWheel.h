@@ -0,0 +1,99 @@
+/*
+ * Roue de temporisation hachee (Varghese & Lauck) pour les echeances
+ * par noeud du recepteur.
+ *
+ * SLOTS cases d'un tick chacune; une echeance va dans la case
+ * (tick & (SLOTS - 1)), les echeances a plus d'un tour y attendent leur
+ * tick. Armer et annuler sont en O(1) (listes chainees par indices dans
+ * un tableau fixe, aucune allocation); avancer d'un tick ne parcourt
+ * qu'une case, quel que soit le nombre de temporisations. Identifiant =
+ * case de la table des noeuds. Temps en ticks 32 bits fournis par
+ * l'appelant, compares par soustraction signee.
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef RUCHE_TIMER_WHEEL_H
+#define RUCHE_TIMER_WHEEL_H
+
+#include <stdint.h>
+
+template <uint16_t SLOTS, uint16_t TIMERS>
+class RucheTimerWheel {
+    static_assert(SLOTS >= 2 && (SLOTS & (SLOTS - 1)) == 0, "SLOTS doit etre une puissance de 2");
+    static const uint16_t NONE = 0xFFFF;
+    static_assert(TIMERS < NONE, "TIMERS trop grand");
+
+public:
+    void reset(uint32_t nowTick) {
+        for (uint16_t s = 0; s < SLOTS; s++) head_[s] = NONE;
+        for (uint16_t i = 0; i < TIMERS; i++) armed_[i] = false;
+        tick_ = nowTick;
+    }
+
+    uint32_t tick() const { return tick_; }
+    bool armed(uint16_t id) const { return id < TIMERS && armed_[id]; }
+    uint32_t expiry(uint16_t id) const { return expiry_[id]; }
+
+    // (Re)arme id; une echeance deja passee part au tick suivant.
+    void schedule(uint16_t id, uint32_t expiryTick) {
+        if (id >= TIMERS) return;
+        cancel(id);
+        if ((int32_t)(expiryTick - tick_) <= 0) expiryTick = tick_ + 1;
+        expiry_[id] = expiryTick;
+        uint16_t s = (uint16_t)(expiryTick & (SLOTS - 1));
+        prev_[id] = NONE;
+        next_[id] = head_[s];
+        if (head_[s] != NONE) prev_[head_[s]] = id;
+        head_[s] = id;
+        armed_[id] = true;
+    }
+
+    void cancel(uint16_t id) {
+        if (id >= TIMERS || !armed_[id]) return;
+        if (prev_[id] != NONE) {
+            next_[prev_[id]] = next_[id];
+        } else {
+            head_[expiry_[id] & (SLOTS - 1)] = next_[id];
+        }
+        if (next_[id] != NONE) prev_[next_[id]] = prev_[id];
+        armed_[id] = false;
+    }
+
+    // Avance jusqu'a nowTick et appelle fire(id) pour chaque echeance
+    // atteinte, desarmee avant l'appel: fire peut la reprogrammer, mais
+    // ne doit toucher a aucune autre. Apres un long arret, au plus un
+    // tour de roue est parcouru. Retourne le nombre d'echeances.
+    template <typename F>
+    uint16_t advance(uint32_t nowTick, F& fire) {
+        int32_t steps = (int32_t)(nowTick - tick_);
+        if (steps <= 0) return 0;
+        if (steps > (int32_t)SLOTS) steps = SLOTS;
+        uint16_t fired = 0;
+        uint32_t t = tick_;
+        tick_ = nowTick;
+        for (int32_t n = 0; n < steps; n++) {
+            uint16_t s = (uint16_t)(++t & (SLOTS - 1));
+            uint16_t id = head_[s];
+            while (id != NONE) {
+                uint16_t next = next_[id];
+                if ((int32_t)(expiry_[id] - nowTick) <= 0) {
+                    cancel(id);
+                    fire(id);
+                    fired++;
+                }
+                id = next;
+            }
+        }
+        return fired;
+    }
+
+private:
+    uint16_t head_[SLOTS];
+    uint16_t next_[TIMERS];
+    uint16_t prev_[TIMERS];
+    uint32_t expiry_[TIMERS];
+    bool armed_[TIMERS];
+    uint32_t tick_;
+};
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Encodeur MessagePack minimal sur un tampon fourni par l'appelant.
+ *
+ * Pas d'allocation: un depassement de capacite arrete l'ecriture et
+ * ok() devient faux (message a abandonner). Formats les plus courts
+ * choisis automatiquement (fixint, fixstr, fixarray...). Flottants en
+ * float32; NAN est ecrit nil (valeur absente).
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef RUCHE_MSGPACK_WRITER_H
+#define RUCHE_MSGPACK_WRITER_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct MsgPackWriter {
+    uint8_t* buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+
+    void begin(uint8_t* buffer, size_t capacity) {
+        buf = buffer;
+        cap = capacity;
+        len = 0;
+        overflow = false;
+    }
+
+    bool ok() const { return !overflow; }
+
+    void nil() { put8(0xC0); }
+
+    void boolean(bool v) { put8(v ? 0xC3 : 0xC2); }
+
+    void uint(uint32_t v) {
+        if (v < 0x80) {
+            put8((uint8_t)v);
+        } else if (v <= 0xFF) {
+            put8(0xCC);
+            put8((uint8_t)v);
+        } else if (v <= 0xFFFF) {
+            put8(0xCD);
+            putBE(v, 2);
+        } else {
+            put8(0xCE);
+            putBE(v, 4);
+        }
+    }
+
+    void sint(int32_t v) {
+        if (v >= 0) {
+            uint((uint32_t)v);
+        } else if (v >= -32) {
+            put8((uint8_t)(int8_t)v);          // negative fixint
+        } else if (v >= -128) {
+            put8(0xD0);
+            put8((uint8_t)(int8_t)v);
+        } else if (v >= -32768) {
+            put8(0xD1);
+            putBE((uint16_t)(int16_t)v, 2);
+        } else {
+            put8(0xD2);
+            putBE((uint32_t)v, 4);
+        }
+    }
+
+    void f32(float v) {
+        if (isnan(v)) {
+            nil();
+            return;
+        }
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        put8(0xCA);
+        putBE(bits, 4);
+    }
+
+    void str(const char* s) {
+        size_t n = (s != NULL) ? strlen(s) : 0;
+        if (n > 0xFFFF) n = 0xFFFF;
+        if (n < 32) {
+            put8((uint8_t)(0xA0 | n));
+        } else if (n <= 0xFF) {
+            put8(0xD9);
+            put8((uint8_t)n);
+        } else {
+            put8(0xDA);
+            putBE((uint32_t)n, 2);
+        }
+        putBytes((const uint8_t*)s, n);
+    }
+
+    void arrayHeader(uint32_t n) { header(n, 0x90, 0xDC, 0xDD); }
+
+    void mapHeader(uint32_t n) { header(n, 0x80, 0xDE, 0xDF); }
+
+private:
+    void header(uint32_t n, uint8_t fix, uint8_t m16, uint8_t m32) {
+        if (n < 16) {
+            put8((uint8_t)(fix | n));
+        } else if (n <= 0xFFFF) {
+            put8(m16);
+            putBE(n, 2);
+        } else {
+            put8(m32);
+            putBE(n, 4);
+        }
+    }
+
+    void put8(uint8_t b) {
+        if (overflow || len >= cap) {
+            overflow = true;
+            return;
+        }
+        buf[len++] = b;
+    }
+
+    void putBE(uint32_t v, uint8_t bytes) {
+        for (int8_t i = (int8_t)bytes - 1; i >= 0; i--) {
+            put8((uint8_t)(v >> (8 * i)));
+        }
+    }
+
+    void putBytes(const uint8_t* p, size_t n) {
+        if (n == 0) return;
+        if (overflow || len + n > cap) {
+            overflow = true;
+            return;
+        }
+        memcpy(buf + len, p, n);
+        len += n;
+    }
+};
+
+#endif
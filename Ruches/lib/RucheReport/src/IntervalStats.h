@@ -0,0 +1,97 @@
+/*
+ * Statistiques d'un intervalle d'envoi: nombre, min, max, moyenne et
+ * ecart-type, accumules mesure par mesure (algorithme de Welford: pas de
+ * somme des carres, donc pas de perte de precision en float autour de
+ * 50 kg).
+ *
+ * Pas de constructeurs: un objet a zero est vide, on peut le placer en
+ * RTC_DATA_ATTR pour couvrir plusieurs reveils (low power).
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef INTERVAL_STATS_H
+#define INTERVAL_STATS_H
+
+#include <math.h>
+#include <stdint.h>
+
+struct RunningStats {
+    uint32_t count;
+    float mean;
+    float m2;                  // somme des carres des ecarts a la moyenne
+    float min;
+    float max;
+
+    void reset() {
+        count = 0;
+        mean = 0.0f;
+        m2 = 0.0f;
+        min = 0.0f;
+        max = 0.0f;
+    }
+
+    void add(float x) {
+        if (isnan(x)) return;
+        count++;
+        if (count == 1) {
+            mean = x;
+            m2 = 0.0f;
+            min = x;
+            max = x;
+            return;
+        }
+        float delta = x - mean;
+        mean += delta / (float)count;
+        m2 += delta * (x - mean);
+        if (x < min) min = x;
+        if (x > max) max = x;
+    }
+
+    // Ecart-type de la population mesuree (0 sous deux mesures).
+    float stddev() const {
+        if (count < 2) return 0.0f;
+        float var = m2 / (float)count;
+        return var > 0.0f ? sqrtf(var) : 0.0f;
+    }
+};
+
+// Poids, temperature et humidite depuis le dernier envoi. Temps en ms
+// sur une base continue a travers le deep sleep.
+struct IntervalStats {
+    RunningStats weight;
+    RunningStats temp;
+    RunningStats hum;
+    uint64_t firstMs;          // premiere mesure de l'intervalle
+
+    void reset() {
+        weight.reset();
+        temp.reset();
+        hum.reset();
+        firstMs = 0;
+    }
+
+    bool empty() const { return weight.count == 0 && temp.count == 0 && hum.count == 0; }
+
+    void addWeight(float g, uint64_t nowMs) {
+        touch(nowMs);
+        weight.add(g);
+    }
+
+    void addEnv(float tempC, float humPct, uint64_t nowMs) {
+        touch(nowMs);
+        temp.add(tempC);
+        hum.add(humPct);
+    }
+
+    uint32_t spanS(uint64_t nowMs) const {
+        if (empty() || nowMs < firstMs) return 0;
+        return (uint32_t)((nowMs - firstMs) / 1000ULL);
+    }
+
+private:
+    void touch(uint64_t nowMs) {
+        if (empty()) firstMs = nowMs;
+    }
+};
+
+#endif
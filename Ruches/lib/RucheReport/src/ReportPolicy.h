@@ -0,0 +1,110 @@
+/*
+ * Politique d'envoi sur variation.
+ *
+ * Une trame n'est utile que si une valeur a quitte sa bande autour des
+ * dernieres valeurs ACQUITTEES par le recepteur, ou si le battement de
+ * garde est du (le recepteur sait alors que rien n'a bouge). Tant qu'aucun
+ * ACK n'est connu (recepteur ancien ou absent), chaque decision est un
+ * envoi: meme comportement qu'avant.
+ *
+ * Pas de constructeurs: un objet a zero est une politique reinitialisee,
+ * on peut la placer en RTC_DATA_ATTR (low power). Les temps sont des ms
+ * sur 32 bits, les ecarts se calculent par soustraction non signee.
+ */
+
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+struct ReportValues {
+    float weightG;
+    float tempC;       // NAN si absente
+    float humPct;      // NAN si absente
+    int battPct;       // -1 si absente
+};
+
+enum ReportDecision {
+    REPORT_SKIP = 0,          // tout est dans les bandes, battement pas du
+    REPORT_CHANGED,           // une valeur est sortie de sa bande (ou pas d'ACK)
+    REPORT_HEARTBEAT          // rien n'a bouge mais le battement est du
+};
+
+// Bandes par defaut de la ruche standard.
+struct StandardReportParams {
+    static constexpr float weightBandG = 50.0f;
+    static constexpr float tempBandC = 1.0f;
+    static constexpr float humBandPct = 5.0f;
+    static constexpr int battBandPct = 5;
+    static constexpr uint32_t heartbeatMs = 30UL * 60UL * 1000UL;   // M = 30 min
+};
+
+template <typename P>
+class ReportPolicy {
+public:
+    void reset() {
+        acked_ = false;
+        pending_ = false;
+        ackedAtMs_ = 0;
+        pendingSeq_ = 0;
+    }
+
+    ReportDecision decide(const ReportValues& v, uint32_t nowMs) const {
+        if (!acked_ || !withinBands(v)) return REPORT_CHANGED;
+        if ((uint32_t)(nowMs - ackedAtMs_) >= P::heartbeatMs) return REPORT_HEARTBEAT;
+        return REPORT_SKIP;
+    }
+
+    // Trame partie: ses valeurs deviendront la reference a son ACK.
+    void onSent(uint16_t seq, const ReportValues& v) {
+        pendingSeq_ = seq;
+        pendingValues_ = v;
+        pending_ = true;
+    }
+
+    // true si l'ACK correspond a la derniere trame envoyee.
+    bool onAck(uint16_t seq, uint32_t nowMs) {
+        if (!pending_ || seq != pendingSeq_) return false;
+        ackedValues_ = pendingValues_;
+        ackedAtMs_ = nowMs;
+        acked_ = true;
+        pending_ = false;
+        return true;
+    }
+
+    // Reference invalide (tare, calibration): le prochain envoi part quoi qu'il arrive.
+    void invalidate() {
+        acked_ = false;
+        pending_ = false;
+    }
+
+    bool hasAck() const { return acked_; }
+    bool awaitingAck() const { return pending_; }
+    const ReportValues& acked() const { return ackedValues_; }
+
+private:
+    static bool outside(float a, float b, float band) {
+        if (isnan(a) != isnan(b)) return true;
+        return !isnan(a) && fabsf(a - b) >= band;
+    }
+
+    bool withinBands(const ReportValues& v) const {
+        if (outside(v.weightG, ackedValues_.weightG, P::weightBandG)) return false;
+        if (outside(v.tempC, ackedValues_.tempC, P::tempBandC)) return false;
+        if (outside(v.humPct, ackedValues_.humPct, P::humBandPct)) return false;
+        if ((v.battPct < 0) != (ackedValues_.battPct < 0)) return false;
+        if (v.battPct >= 0 && abs(v.battPct - ackedValues_.battPct) >= P::battBandPct) return false;
+        return true;
+    }
+
+    ReportValues ackedValues_;
+    ReportValues pendingValues_;
+    uint32_t ackedAtMs_;
+    uint16_t pendingSeq_;
+    bool acked_;
+    bool pending_;
+};
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * Choix de la duree du prochain deep sleep (mode low power).
+ *
+ * Trois signaux, tous observes a chaque reveil:
+ *   - activite: ecart-type glissant (EWMA) des variations de poids entre
+ *     deux reveils; une ruche qui bouge est echantillonnee densement.
+ *   - butinage: pas d'horloge murale sur le noeud, la journee est deduite
+ *     de la temperature (au-dessus du seuil de vol et dans la moitie haute
+ *     de l'enveloppe min/max recente, qui suit le cycle jour/nuit).
+ *   - batterie: batterie basse = reveils espaces quoi qu'il arrive.
+ *
+ * Pas de constructeurs: un objet a zero est un modele vierge, on peut le
+ * placer en RTC_DATA_ATTR et il survit au deep sleep.
+ */
+
+#ifndef SLEEP_SCHEDULER_H
+#define SLEEP_SCHEDULER_H
+
+#include <math.h>
+#include <stdint.h>
+
+// Reglages de la ruche standard.
+struct StandardSleepParams {
+    static constexpr uint32_t defaultSleepS = 60;      // modele vierge
+    static constexpr uint32_t busySleepS = 30;         // forte activite
+    static constexpr uint32_t forageSleepS = 60;       // heures de butinage
+    static constexpr uint32_t restSleepS = 300;        // hors butinage, un peu d'activite
+    static constexpr uint32_t nightSleepS = 900;       // nuit / froid, ruche immobile
+    static constexpr uint32_t lowBattSleepS = 600;     // plancher batterie basse
+    static constexpr uint32_t criticalBattSleepS = 900;
+    static constexpr int lowBattPct = 25;
+    static constexpr int criticalBattPct = 10;
+    static constexpr float busyActivityG = 40.0f;      // ecart-type entre reveils
+    static constexpr float quietActivityG = 10.0f;
+    static constexpr float activityAlpha = 0.3f;
+    static constexpr float forageMinTempC = 12.0f;     // seuil de vol des abeilles
+    static constexpr float tempEnvelopeS = 43200.0f;   // oubli de l'enveloppe (~12 h)
+    static constexpr float tempMinSpanC = 3.0f;        // enveloppe trop plate: pas de jour/nuit
+};
+
+template <typename P>
+class SleepScheduler {
+public:
+    void reset() {
+        activityVar_ = 0.0f;
+        prevWeight_ = 0.0f;
+        tempC_ = NAN;
+        tempHi_ = 0.0f;
+        tempLo_ = 0.0f;
+        weightReady_ = false;
+        tempReady_ = false;
+    }
+
+    // Une mesure par reveil; elapsedS = duree ecoulee depuis la precedente.
+    void observe(float weightG, float tempC, uint32_t elapsedS) {
+        if (weightReady_) {
+            float d = weightG - prevWeight_;
+            activityVar_ += P::activityAlpha * (d * d - activityVar_);
+        }
+        prevWeight_ = weightG;
+        weightReady_ = true;
+
+        tempC_ = tempC;
+        if (isnan(tempC)) return;
+        if (!tempReady_) {
+            tempHi_ = tempC;
+            tempLo_ = tempC;
+            tempReady_ = true;
+            return;
+        }
+        // Enveloppe: suit les extremes, se resserre lentement vers la mesure.
+        float k = (float)elapsedS / P::tempEnvelopeS;
+        if (k > 1.0f) k = 1.0f;
+        tempHi_ = (tempC > tempHi_) ? tempC : tempHi_ - k * (tempHi_ - tempC);
+        tempLo_ = (tempC < tempLo_) ? tempC : tempLo_ + k * (tempC - tempLo_);
+    }
+
+    float activityG() const { return sqrtf(activityVar_); }
+
+    bool foraging() const {
+        if (!tempReady_ || isnan(tempC_) || tempC_ < P::forageMinTempC) return false;
+        float span = tempHi_ - tempLo_;
+        return span < P::tempMinSpanC || tempC_ >= tempLo_ + 0.5f * span;
+    }
+
+    uint32_t nextSleepS(int battPct) const {
+        bool battKnown = battPct >= 0;
+        if (battKnown && battPct <= P::criticalBattPct) return P::criticalBattSleepS;
+        if (!weightReady_) return P::defaultSleepS;
+
+        float activity = activityG();
+        uint32_t s;
+        if (activity >= P::busyActivityG) {
+            s = P::busySleepS;
+        } else if (foraging()) {
+            s = P::forageSleepS;
+        } else if (activity >= P::quietActivityG || !tempReady_) {
+            s = P::restSleepS;
+        } else {
+            s = P::nightSleepS;
+        }
+        if (battKnown && battPct <= P::lowBattPct && s < P::lowBattSleepS) s = P::lowBattSleepS;
+        return s;
+    }
+
+private:
+    float activityVar_;
+    float prevWeight_;
+    float tempC_;
+    float tempHi_;
+    float tempLo_;
+    bool weightReady_;
+    bool tempReady_;
+};
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * File circulaire d'enregistrements de taille fixe sur un tampon fourni
+ * par l'appelant (PSRAM, tas interne...).
+ *
+ * Une seule tache: pas de synchronisation. Pleine, push() ecrase le plus
+ * ancien et le compte dans overwritten: la memoire reste bornee et la
+ * perte explicite. L'appelant vide d'abord vers un support plus lent
+ * s'il veut eviter l'ecrasement (voir nearlyFull()).
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef RUCHE_RECORD_RING_H
+#define RUCHE_RECORD_RING_H
+
+#include <stdint.h>
+
+// Objet a zero = file sans tampon (tout push est perdu).
+template <typename T>
+struct RecordRing {
+    T* slots;
+    uint32_t capacity;
+    uint32_t head;              // prochain indice d'ecriture (modulo capacity)
+    uint32_t count;
+    uint32_t overwritten;       // plus anciens ecrases, file pleine
+
+    void reset() {
+        slots = 0;
+        capacity = 0;
+        head = 0;
+        count = 0;
+        overwritten = 0;
+    }
+
+    void attach(T* buffer, uint32_t cap) {
+        reset();
+        slots = buffer;
+        capacity = (buffer != 0) ? cap : 0;
+    }
+
+    bool empty() const { return count == 0; }
+    bool full() const { return capacity > 0 && count == capacity; }
+    bool nearlyFull(uint32_t margin) const { return count + margin >= capacity; }
+
+    void push(const T& v) {
+        if (capacity == 0) {
+            overwritten++;
+            return;
+        }
+        slots[head] = v;
+        head = (head + 1 == capacity) ? 0 : head + 1;
+        if (count == capacity) {
+            overwritten++;
+        } else {
+            count++;
+        }
+    }
+
+    // i = 0: le plus ancien.
+    T& at(uint32_t i) {
+        uint32_t idx = head + capacity - count + i;
+        return slots[idx % capacity];
+    }
+
+    T& front() { return at(0); }
+
+    void dropFront(uint32_t n = 1) {
+        count = (n >= count) ? 0 : count - n;
+    }
+};
+
+#endif
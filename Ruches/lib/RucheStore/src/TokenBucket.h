@@ -0,0 +1,50 @@
+/*
+ * Limiteur de debit par seau a jetons: ratePerS jetons par seconde,
+ * au plus burst en reserve. Temps en ms fourni par l'appelant.
+ * Aucune dependance Arduino: compile aussi sur hote Linux.
+ */
+
+#ifndef RUCHE_TOKEN_BUCKET_H
+#define RUCHE_TOKEN_BUCKET_H
+
+#include <stdint.h>
+
+struct TokenBucket {
+    uint32_t milliTokens;       // jetons x 1000
+    uint32_t lastMs;
+    bool started;
+
+    void reset() {
+        milliTokens = 0;
+        lastMs = 0;
+        started = false;
+    }
+
+    void refill(uint32_t nowMs, uint16_t ratePerS, uint16_t burst) {
+        uint32_t cap = (uint32_t)burst * 1000u;
+        if (!started) {
+            started = true;
+            lastMs = nowMs;
+            milliTokens = cap;
+            return;
+        }
+        uint32_t elapsed = nowMs - lastMs;
+        lastMs = nowMs;
+        // Plafonne avant multiplication: pas de debordement apres une
+        // longue pause.
+        if (elapsed > 3600000u) elapsed = 3600000u;
+        uint64_t add = (uint64_t)elapsed * ratePerS;
+        uint64_t next = (uint64_t)milliTokens + add;
+        milliTokens = (next > cap) ? cap : (uint32_t)next;
+    }
+
+    uint32_t available() const { return milliTokens / 1000u; }
+
+    bool take() {
+        if (milliTokens < 1000u) return false;
+        milliTokens -= 1000u;
+        return true;
+    }
+};
+
+#endif
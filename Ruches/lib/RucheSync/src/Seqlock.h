@@ -0,0 +1,56 @@
+/*
+ * Publication d'un instantane par un seul ecrivain, lu sans verrou.
+ *
+ * Deux copies alternees + compteur de version: l'ecrivain remplit la copie
+ * inactive puis publie la version. Un lecteur de priorite plus haute qui
+ * preempte l'ecrivain en pleine ecriture lit l'autre copie, toujours
+ * complete: pas de boucle d'attente sur un ecrivain qui ne peut pas tourner
+ * (taches epinglees sur le meme coeur). Le lecteur ne recommence que si
+ * l'ecrivain a entame deux publications pendant sa copie.
+ *
+ * T doit etre copiable trivialement (struct de valeurs).
+ */
+
+#ifndef RUCHE_SEQLOCK_H
+#define RUCHE_SEQLOCK_H
+
+#include <atomic>
+#include <stdint.h>
+
+template <typename T>
+class Seqlock {
+public:
+    Seqlock() : begin_(0), version_(0) {
+        slots_[0] = T();
+        slots_[1] = T();
+    }
+
+    // Ecrivain unique.
+    void publish(const T& value) {
+        uint32_t next = version_.load(std::memory_order_relaxed) + 1;
+        begin_.store(next, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slots_[next & 1] = value;
+        version_.store(next, std::memory_order_release);
+    }
+
+    // Lecteurs: retourne la version lue (change a chaque publication).
+    uint32_t read(T& out) const {
+        while (true) {
+            uint32_t v = version_.load(std::memory_order_acquire);
+            out = slots_[v & 1];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // La copie v & 1 n'est reecrite qu'a partir de la publication v + 2.
+            if (begin_.load(std::memory_order_relaxed) - v <= 1) return v;
+        }
+    }
+
+    uint32_t version() const { return version_.load(std::memory_order_acquire); }
+
+private:
+    T slots_[2];
+    std::atomic<uint32_t> begin_;
+    std::atomic<uint32_t> version_;
+};
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * File circulaire sans verrou, un producteur / un consommateur.
+ *
+ * Le producteur n'ecrit que head_, le consommateur que tail_: aucune
+ * section critique, utilisable entre une tache haute priorite (ou un ISR)
+ * et une tache de traitement. N doit etre une puissance de 2.
+ */
+
+#ifndef RUCHE_SPSC_RING_H
+#define RUCHE_SPSC_RING_H
+
+#include <atomic>
+#include <stdint.h>
+
+template <typename T, uint16_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing: N doit etre une puissance de 2");
+
+public:
+    SpscRing() : head_(0), tail_(0), dropped_(0) {}
+
+    // Producteur. Retourne false (et compte la perte) si la file est pleine.
+    bool push(const T& v) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= N) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slots_[head & (N - 1)] = v;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consommateur.
+    bool pop(T& out) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return false;
+        out = slots_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producteur sans copie: case libre remplie sur place puis publish().
+    // NULL (perte comptee) si la file est pleine.
+    T* claim() {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= N) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &slots_[head & (N - 1)];
+    }
+
+    void publish() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consommateur sans copie: plus ancienne case, lue sur place puis
+    // rendue par consume(). NULL si la file est vide.
+    T* peek() {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return nullptr;
+        return &slots_[tail & (N - 1)];
+    }
+
+    void consume() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consommateur: vide la file (ex: donnees perimees avant une mesure).
+    void clear() {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    uint32_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    T slots_[N];
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+    std::atomic<uint32_t> dropped_;
+};
+
+#endif
@@ -4,7 +4,7 @@
  * Converti en .cpp
  */
 
-#include <HX711_ADC.h>
+#include <Hx711Sampler.h>
 #include <EEPROM.h>
 #include <SPI.h>
 #include <RadioLib.h>
@@ -14,16 +14,36 @@
 #include <Adafruit_SSD1306.h>
 #include <DHT.h>
 #include <esp_sleep.h>
+#include <esp_pm.h>
+#include <driver/gpio.h>
+#include <hal/gpio_ll.h>
+#include <driver/uart.h>
 #include <limits.h>
 #include <ctype.h>
 #include <string.h>
 #include <strings.h>
 #include <stdlib.h>
+#include <RucheFrame.h>
+#include <RucheAdr.h>
+#include <RucheTdma.h>
+#include <HiveWeightConfig.h>
+#include <TrimmedBatchMean.h>
+#include <ReportPolicy.h>
+#include <SleepScheduler.h>
+#include <IntervalStats.h>
+#include <Seqlock.h>
+#include <OledRenderer.h>
 
 // ===== Configuration HX711 =====
 const int HX711_dout = 19;
 const int HX711_sck = 20;
-HX711_ADC LoadCell(HX711_dout, HX711_sck);
+// Lecture sur interruption data-ready (tache dediee, priorite au-dessus de LoRa).
+Hx711Sampler hx711(HX711_dout, HX711_sck);
+const UBaseType_t HX711_SAMPLER_PRIORITY = 5;
+const uint16_t HX711_TARE_SAMPLES = 16;        // conversions moyennees pour la tare
+const uint16_t HX711_LEGACY_CAL_SAMPLES = 16;  // idem calibrage direct (legacy)
+const uint32_t HX711_FIRST_SAMPLE_TIMEOUT_MS = 1000;
+long tareOffset = 0;                           // binaire decale, comme HX711_ADC
 const int calVal_eepromAdress = 0;
 const int tareOffset_eepromAdress = calVal_eepromAdress + (int)sizeof(float);
 const int eepromMagic_eepromAdress = tareOffset_eepromAdress + (int)sizeof(long);
@@ -37,9 +57,17 @@ DHT dht(DHT_PIN, DHT_TYPE);
 
 // ===== Mode economie d'energie =====
 const bool LOW_POWER_MODE = true;
-const uint32_t LOW_POWER_SLEEP_S = 60;         // reveil periodique
+typedef StandardSleepParams LowPowerSleepParams;   // duree du deep sleep: SleepScheduler
 const uint32_t LOW_POWER_ACTIVE_WINDOW_MS = 12000; // fenetre de mesure avant envoi
+const uint8_t LOW_POWER_BATCH_WAKES = 6;       // 1 trame groupee tous les N reveils (1 = chaque reveil)
+const uint8_t LOW_POWER_BATCH_CAPACITY = 10;   // mesures gardees en RTC (plus ancienne ecrasee)
+static_assert(LOW_POWER_BATCH_WAKES >= 1 && LOW_POWER_BATCH_WAKES <= LOW_POWER_BATCH_CAPACITY,
+              "LOW_POWER_BATCH_WAKES hors limites");
+static_assert(LOW_POWER_BATCH_CAPACITY <= RUCHE_BATCH_MAX_SAMPLES, "LOW_POWER_BATCH_CAPACITY trop grand");
 const bool KEEP_AWAKE_WHEN_USB_SERIAL = true;
+// Noeud eveille en continu (USB ou pas de low power): light sleep automatique
+// entre deux evenements si le sdkconfig le permet (CONFIG_PM_ENABLE + tickless idle).
+const bool AUTO_LIGHT_SLEEP_WHEN_AWAKE = true;
 const uint32_t CALIBRATION_COMMAND_WINDOW_MS = 120000;
 const uint32_t CALIBRATION_WAIT_TIMEOUT_MS = 20000;
 const uint32_t CALIBRATION_POLL_MS = 200;
@@ -50,6 +78,11 @@ const uint32_t STARTUP_SETTLE_IGNORE_MS = 5000;
 const uint32_t STARTUP_FORCE_SEND_MS = 25000;
 const uint8_t STARTUP_STABLE_SAMPLES = 12;
 const float STARTUP_STABLE_SPAN_G = 18.0f;
+// Reveil a chaud (timer deep sleep): etat des filtres restaure depuis la RTC.
+const uint32_t WARM_BOOT_MAGIC = 0x5741524D;   // "WARM"
+const unsigned long WARM_BOOT_HX711_SETTLE_MS = 400;
+const uint8_t WARM_BOOT_AGREE_SAMPLES = 3;
+const float WARM_BOOT_AGREE_BAND_G = 18.0f;
 
 // ===== Configuration batterie (Heltec V3) =====
 // Ajuster ces broches si votre revision de carte differe.
@@ -71,6 +104,32 @@ const float BAT_VOLTAGE_EMPTY = 3.30f;  // seuil bas pratique sous charge
 #define SCREEN_HEIGHT 64
 #define OLED_ADDR     0x3C
 Adafruit_SSD1306 oled(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RST);
+// Envoi I2C par task_oled: seules les zones modifiees partent.
+OledRenderer oledRenderer(oled, OLED_ADDR);
+const UBaseType_t OLED_TASK_PRIORITY = 1;
+const uint32_t OLED_SLEEP_FLUSH_TIMEOUT_MS = 200;
+// Tour de loop() (10 ms + un rafraichissement) puis envoi I2C.
+const uint32_t OLED_SLEEP_WAIT_MS = OLED_SLEEP_FLUSH_TIMEOUT_MS + 100;
+const unsigned long DISPLAY_REFRESH_MS = 500;
+// loop() est seule a dessiner dans le tampon oled et a appeler
+// oledRenderer: taskLoRa et taskHX711 deposent leurs messages dans
+// oledMessageSlot (le dernier ecrase le precedent), affiches au tour
+// suivant de loop().
+const uint8_t OLED_MESSAGE_LINE_LEN = 22;      // 21 caracteres en taille 1
+struct OledMessage {
+    char lines[3][OLED_MESSAGE_LINE_LEN];
+    bool notifyShown;                          // oledShownSem donne une fois a l'ecran
+};
+QueueHandle_t oledMessageSlot = NULL;          // longueur 1, xQueueOverwrite
+SemaphoreHandle_t oledShownSem = NULL;
+TaskHandle_t displayTaskHandle = NULL;         // tache de setup() et loop()
+// Ecran de mesures: chaque zone n'est redessinee que si son texte change.
+bool dashboardShown = false;
+OledWidget weightWidget(0, 0, 128, 16);
+OledWidget tempWidget(0, 22, 80, 16);
+OledWidget humWidget(0, 44, 80, 16);
+OledWidget batteryWidget(100, 42, 24, 10);
+OledWidget signalWidget(100, 54, 24, 10);
 
 // ===== Configuration LoRa avec RadioLib =====
 #define LORA_CS    8
@@ -84,10 +143,16 @@ Adafruit_SSD1306 oled(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RST);
 #define PRG_BUTTON_PIN 0
 
 SX1262 radio = new Module(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY);
-const char* LORA_NODE_ID = "RUCHE1";
+// Identifiant du noeud: -DRUCHE_NODE_NUM=<n> dans platformio.ini pour le
+// fixer, sinon derive de l'adresse MAC eFuse (stable, propre a la carte).
+#ifndef RUCHE_NODE_NUM
+#define RUCHE_NODE_NUM 0
+#endif
+uint16_t loraNodeNum = 0;                      // identifiant binaire, nom "RUCHE<num>"
+char loraNodeId[16] = "";
 
 // ===== Variables globales =====
-float lastWeight = 0.0;
+float lastWeight = 0.0;                        // poids telemetrie (taskHX711)
 uint32_t packetsSent = 0;
 uint32_t packetsFailed = 0;
 bool oled_working = false;
@@ -96,6 +161,42 @@ bool waitingKnownMass = false;
 unsigned long previousMillis = 0;
 const long interval = 15000;
 char txpacket[64];
+RTC_DATA_ATTR uint16_t frameSeq = 0;           // conserve entre deux deep sleep
+RTC_DATA_ATTR bool frameSeqAcked = false;      // false: seq repartie de 0, RUCHE_FLAG_SEQ_RESET
+
+// Mesures accumulees entre deux reveils (mode low power).
+struct LowPowerSample {
+    uint64_t tsMs;
+    float weightG;
+    float tempC;
+    float humPct;
+};
+RTC_DATA_ATTR LowPowerSample lpSamples[LOW_POWER_BATCH_CAPACITY];
+RTC_DATA_ATTR uint8_t lpSampleHead = 0;
+RTC_DATA_ATTR uint8_t lpSampleCount = 0;
+RTC_DATA_ATTR uint64_t rtcClockBaseMs = 0;     // temps cumule des cycles precedents
+RTC_DATA_ATTR float lpLastSentWeight = 0.0f;
+RTC_DATA_ATTR bool lpLastSentWeightReady = false;
+// Envoi sur variation: reference = dernieres valeurs acquittees (taskLoRa).
+typedef ReportPolicy<StandardReportParams> TelemetryReportPolicy;
+RTC_DATA_ATTR TelemetryReportPolicy reportPolicy;
+// Low power: fenetre de reception apres chaque trame (facon LoRaWAN classe A).
+const unsigned long LORA_RX_WINDOW_MS = 500;   // ACK du recepteur
+const unsigned long LORA_DOWNLINK_WINDOW_MS = 800;   // commande annoncee par l'ACK
+bool downlinkExpected = false;                 // taskLoRa
+// Duree du prochain deep sleep selon activite, temperature et batterie.
+RTC_DATA_ATTR SleepScheduler<LowPowerSleepParams> sleepScheduler;
+RTC_DATA_ATTR uint32_t lastSleepS = 0;         // 0 = demarrage a froid
+// Reglage radio recommande par le recepteur (ADR). A zero (demarrage a
+// froid): profil par defaut, le meme que celui du recepteur au demarrage.
+RTC_DATA_ATTR RucheAdrSetting radioProfile;
+RTC_DATA_ATTR uint8_t missedReportAcks = 0;
+const uint8_t ADR_FALLBACK_MISSED_ACKS = 4;    // trames sans ACK avant retour au profil par defaut
+// Creneau TDMA et horloge du recepteur, recus dans chaque ACK. A zero
+// (demarrage a froid): pas de creneau, emission des que la mesure est prete.
+RTC_DATA_ATTR RucheTdmaClock tdmaClock;
+const uint32_t TDMA_WAKE_LEAD_MS = 2500;       // reveil avant le creneau: boot + mesure a chaud
+const uint32_t TDMA_MAX_SLOT_WAIT_MS = 4000;   // au-dela, creneau manque: emission immediate
 float currentCalFactor = 696.0f;
 const float DEFAULT_CAL_FACTOR = 696.0f;
 const float MIN_VALID_CAL_FACTOR = 100.0f;
@@ -103,31 +204,35 @@ const float MAX_VALID_CAL_FACTOR = 5000.0f;
 float lastTempC = NAN;
 float lastHumPct = NAN;
 unsigned long lastDhtReadMs = 0;
+bool dhtReadOnce = false;
 const unsigned long DHT_READ_INTERVAL_MS = 10000;
 float batteryVoltage = NAN;
 int batteryPercent = -1;
 bool batteryChargingLikely = false;
 float previousBatteryVoltage = NAN;
 unsigned long lastBatteryReadMs = 0;
+bool batteryReadOnce = false;
 int activeBatteryAdcPin = BAT_ADC_PIN;
 int16_t lastRxRSSI = -120;
-bool prgLastRawState = HIGH;
-bool prgStableState = HIGH;
-unsigned long prgLastChangeMs = 0;
-const unsigned long PRG_DEBOUNCE_MS = 35;
-bool prgPressedLatched = false;
-volatile bool loraRxFlag = false;
+unsigned long prgLastPressMs = 0;
+volatile bool prgIrqMasked = false;            // ISR masquee jusqu'au relachement (taskHX711)
+const unsigned long PRG_LOCKOUT_MS = 500;      // rebonds et appuis repetes ignores
+volatile bool loraDio1Flag = false;           // RX recu ou fin d'emission (ISR)
 bool radioReceiveMode = false;
 bool lowPowerFrameSent = false;
 unsigned long bootMs = 0;
 unsigned long calibrationCommandWindowUntilMs = 0;
 bool startupReady = false;
+bool warmBoot = false;
+uint8_t warmAgreeCount = 0;
+uint8_t warmDisagreeCount = 0;
+bool warmHistoryDropped = false;               // poids change pendant le sommeil: demarrage a froid
 float startupBuf[STARTUP_STABLE_SAMPLES];
 uint8_t startupBufCount = 0;
 uint8_t startupBufIndex = 0;
-float lastSentWeight = 0.0f;
+float lastSentWeight = 0.0f;                   // taskLoRa
 bool lastSentWeightReady = false;
-bool forceFastSend = false;
+uint8_t tareEpoch = 0;
 float calibrationBaseWeight = 0.0f;
 bool calibrationBaseReady = false;
 bool calibrationPending = false;
@@ -136,14 +241,106 @@ unsigned long calibrationPendingSinceMs = 0;
 float calibrationLastDelta = 0.0f;
 float calibrationMaxDelta = 0.0f;
 uint8_t calibrationStableCount = 0;
-SemaphoreHandle_t gDataMutex = NULL;
 TaskHandle_t hxTaskHandle = NULL;
 TaskHandle_t dhtTaskHandle = NULL;
 TaskHandle_t loraTaskHandle = NULL;
 char serialLine[32];
 size_t serialLineLen = 0;
 
+// ===== Instantane des mesures =====
+// Ecrit uniquement par taskHX711 (proprietaire des mesures et des filtres),
+// lu sans verrou par taskLoRa et l'affichage.
+const uint8_t SNAP_STARTUP_READY = 0x01;
+const uint8_t SNAP_CHARGING = 0x02;
+const uint8_t SNAP_CAL_WINDOW = 0x04;          // fenetre de calibration distante: pas d'envoi
+struct MeasurementSnapshot {
+    float weightG;                             // poids telemetrie (lisse)
+    float stableWeightG;                       // reference de l'envoi rapide
+    float tempC;
+    float humPct;
+    int batteryPercent;
+    int16_t rssi;
+    uint8_t flags;
+    uint8_t tareEpoch;                         // change a chaque tare terminee
+    IntervalStats stats;                       // depuis la derniere trame partie
+};
+Seqlock<MeasurementSnapshot> measurementSnapshot;
+
+// ===== Commandes vers taskHX711 =====
+// Tare, calibration et nouvelles mesures des autres taches passent par une
+// file: seule taskHX711 consomme les conversions HX711 et touche aux filtres
+// et a l'etat de mesure.
+enum HxCommandType {
+    HX_CMD_TARE = 0,
+    HX_CMD_CAL_BASE,          // serie 'c': base = poids stable actuel
+    HX_CMD_CAL_START,         // LoRa CAL_START: base + fenetre + ACK
+    HX_CMD_CAL_MASS,          // serie: masse connue posee (value)
+    HX_CMD_CAL_REMOTE,        // LoRa CAL:<masse> (value)
+    HX_CMD_ENV,               // DHT11: value = temp, value2 = hum
+    HX_CMD_BATTERY,           // arg = pourcentage, flag = charge probable
+    HX_CMD_RSSI,              // arg = RSSI dernier paquet recu
+    HX_CMD_SAVE_WARM,         // sauvegarde RTC avant deep sleep
+    HX_CMD_PRG_BUTTON,        // front descendant bouton PRG (ISR)
+    HX_CMD_STATS_RESET        // trame partie: nouvel intervalle de statistiques
+};
+struct HxCommand {
+    uint8_t type;
+    uint8_t flag;
+    int16_t arg;
+    float value;
+    float value2;
+};
+const UBaseType_t HX_COMMAND_QUEUE_LEN = 8;
+const TickType_t HX_COMMAND_POST_WAIT = pdMS_TO_TICKS(100);
+const TickType_t WARM_SAVE_WAIT = pdMS_TO_TICKS(1000);
+QueueHandle_t hxCommandQueue = NULL;
+SemaphoreHandle_t warmSavedSem = NULL;
+
+// ===== Evenements taskLoRa =====
+// taskLoRa dort sur sa notification; chaque bit signale une raison de se
+// reveiller, l'etat reel (loraDio1Flag, files TX, instantane, echeances) est
+// relu a chaque fois.
+const uint32_t LORA_EVT_RADIO = 0x01;          // DIO1 (ISR)
+const uint32_t LORA_EVT_MEASURE = 0x02;        // poids stable / drapeaux changes (taskHX711)
+const uint32_t LORA_EVT_DEADLINE = 0x04;       // echeance d'envoi (timer one-shot)
+const uint32_t LORA_EVT_TX = 0x08;             // trame deposee dans une file d'emission
+TimerHandle_t loraDeadlineTimer = NULL;
+
+// ===== Emission LoRa =====
+// taskLoRa est seule proprietaire de la radio. Les autres taches deposent
+// leurs trames et repartent: ACK et commandes dans une file FIFO servie en
+// premier, telemetrie dans une case unique ecrasee (une mesure perimee
+// n'est jamais envoyee). L'emission est lancee par startTransmit et
+// terminee sur DIO1.
+// Taille max: un lot RTC plein avec ses statistiques. Le lot ne depasse
+// jamais LOW_POWER_BATCH_CAPACITY (plus ancienne ecrasee): apres un
+// echec d'envoi, la trame suivante tient toujours dans le tampon.
+const size_t LORA_TX_MAX_BYTES = rucheBatchFrameBytes(LOW_POWER_BATCH_CAPACITY, true);
+static_assert(LORA_TX_MAX_BYTES >= RUCHE_TELEMETRY_MAX_BYTES, "LORA_TX_MAX_BYTES trop petit");
+static_assert(LORA_TX_MAX_BYTES <= 255, "LOW_POWER_BATCH_CAPACITY trop grand pour une trame LoRa");
+struct LoraTxFrame {
+    uint8_t len;
+    uint8_t binary;                            // 0 = texte (journal lisible)
+    uint8_t data[LORA_TX_MAX_BYTES];
+};
+const UBaseType_t LORA_TX_CONTROL_QUEUE_LEN = 6;
+const unsigned long LORA_TX_TIMEOUT_MARGIN_MS = 500;   // en plus du temps d'antenne
+QueueHandle_t loraTxControlQueue = NULL;
+QueueHandle_t loraTxTelemetrySlot = NULL;      // longueur 1, xQueueOverwrite
+bool radioTxBusy = false;                      // taskLoRa
+uint32_t loraDeferredEvents = 0;               // taskLoRa: recus pendant une attente de DIO1
+bool radioTxLastOk = false;
+unsigned long radioTxStartMs = 0;
+unsigned long radioTxTimeoutMs = 0;
+
 bool envoyerPaquet(const char* message);
+bool envoyerTrame(const uint8_t* data, size_t len);
+bool transmitFrameBlocking(const uint8_t* data, size_t len);
+void flushControlTxBlocking();
+void handleLoRaRx();
+void listenRxWindow();
+void waitLoraRadioEvent(unsigned long timeoutMs);
+void rearmDeferredLoraEvents();
 void readDhtSensor();
 void readBatteryStatus();
 int batteryPercentFromVoltage(float voltage);
@@ -155,7 +352,12 @@ void drawSignalBars(int16_t rssi, int x, int y);
 void beginLoRaReceive();
 void onLoraDio1();
 void handleLoRaCommand(const char* message);
-void enterDeepSleep();
+void enterDeepSleep(uint32_t sleepMs);
+void saveWarmBootState();
+void restoreWarmBootState();
+uint64_t rtcNowMs();
+void pushLowPowerSample(float weightG, float tempC, float humPct);
+bool flushLowPowerBatch(int battPct, uint8_t flags, const IntervalStats& stats);
 bool isUsbSerialActive();
 void pushStartupSample(float w);
 bool isStartupStable();
@@ -165,153 +367,79 @@ void taskHX711(void* parameter);
 void taskDht(void* parameter);
 void taskLoRa(void* parameter);
 bool applyCalibrationDelta(float knownMass, float measuredDelta);
+bool postHxCommand(uint8_t type, float value = 0.0f, float value2 = 0.0f, int16_t arg = 0, uint8_t flag = 0);
+void handleHxCommand(const HxCommand& cmd);
+void publishSnapshot();
 
 // ===== Filtrage HX711 =====
-const uint8_t FILTER_WINDOW_SIZE = 20;
-const float EMA_ALPHA_SLOW = 0.10f;
-const float EMA_ALPHA_MED = 0.30f;
-const float EMA_ALPHA_FAST = 0.60f;
-const float EMA_MEDIUM_DELTA_G = 100.0f;
-const float EMA_FAST_DELTA_G = 500.0f;
-const float OUTLIER_JUMP_G = 100.0f;
-const float IMPOSSIBLE_JUMP_G = 10000.0f;
-const float DISPLAY_DEADBAND_G = 12.0f;
-const uint8_t STEP_CONFIRM_SAMPLES = 2;
-const uint8_t MEDIAN_WINDOW_SIZE = 7;
-const uint8_t STABLE_CONFIRM_SAMPLES = 4;
-const float AUTO_ZERO_WINDOW_G = 120.0f;      // zone "balance vide" pour corriger la derive
-const float AUTO_ZERO_MAX_STEP_G = 1.5f;      // variation max entre 2 mesures pour corriger
-const float AUTO_ZERO_ALPHA = 0.015f;         // vitesse de correction derive
-const float ZERO_LOCK_G = 8.0f;               // affichage force a 0 sous ce seuil
-const float NEGATIVE_CLAMP_G = 200.0f;        // petites valeurs negatives forcees a 0
-const float TELEMETRY_EMA_ALPHA = 0.10f;      // lissage dedie aux trames envoyees
-const float TELEMETRY_MAX_STEP_G = 120.0f;    // limite de variation par echantillon pour la telemetrie
-const float FAST_CHANGE_TRIGGER_G = 60.0f;    // envoi immediat sur variation brusque
-float filterWindow[FILTER_WINDOW_SIZE];
-uint8_t filterIndex = 0;
-uint8_t filterCount = 0;
-float emaWeight = 0.0f;
-bool emaReady = false;
+// Chaine de filtres du poids (voir lib/RucheFilters/HiveWeightConfig.h):
+// auto-zero -> mediane -> rejet pics + EMA adaptative -> bande morte + verrou zero.
+// Les constantes sont validees par bench/replay (env native) avant modification.
+typedef StandardHiveParams WeightParams;
+typedef StandardHiveChain WeightChain;
+typedef StandardHiveTelemetryFilter TelemetryFilter;
+const float FAST_CHANGE_TRIGGER_G = WeightParams::fastChangeTriggerG;
+const unsigned long HX711_SAMPLE_PERIOD_MS = WeightParams::samplePeriodMs;
+WeightChain weightChain;
+TelemetryFilter telemetryFilter;
 float stableWeight = 0.0f;
-uint8_t jumpStreak = 0;
-float softwareZeroOffset = 0.0f;
-float prevCorrectedRaw = 0.0f;
-bool prevCorrectedRawReady = false;
-float medianWindow[MEDIAN_WINDOW_SIZE];
-uint8_t medianIndex = 0;
-uint8_t medianCount = 0;
-float pendingStableCandidate = 0.0f;
-uint8_t pendingStableCount = 0;
-double minuteWeightSum = 0.0;
-uint16_t minuteWeightCount = 0;
-float telemetryWeight = 0.0f;
-bool telemetryWeightReady = false;
 bool tareResidualPending = false;
 float tareResidualAcc = 0.0f;
 uint8_t tareResidualCount = 0;
 const uint8_t TARE_RESIDUAL_SAMPLES = 8;
-
-float filterTelemetryWeight(float inputWeight) {
-    if (!telemetryWeightReady) {
-        telemetryWeight = inputWeight;
-        telemetryWeightReady = true;
-        return telemetryWeight;
-    }
-    float delta = inputWeight - telemetryWeight;
-    if (delta > TELEMETRY_MAX_STEP_G) delta = TELEMETRY_MAX_STEP_G;
-    if (delta < -TELEMETRY_MAX_STEP_G) delta = -TELEMETRY_MAX_STEP_G;
-    telemetryWeight += TELEMETRY_EMA_ALPHA * delta;
-    return telemetryWeight;
+int64_t tareRawAcc = 0;
+uint16_t tareRawCount = 0;
+// Trace brute HX711 sur le port serie (commande r), rejouable par bench/replay.
+volatile bool rawTraceEnabled = false;
+
+// Etat conserve en RTC pour le reveil a chaud.
+struct WarmBootState {
+    uint32_t magic;
+    long tareOffset;
+    WeightChain chain;
+    TelemetryFilter telemetry;
+    float stableWeight;
+    float tempC;
+    float humPct;
+    int batteryPercent;
+    IntervalStats stats;
+};
+RTC_DATA_ATTR WarmBootState warmState;
+// Statistiques de l'intervalle d'envoi en cours (taskHX711), remises a
+// zero par HX_CMD_STATS_RESET une fois la trame partie.
+IntervalStats intervalStats;
+
+// Reinitialise les etages dependant de l'echelle (nouveau facteur de calibration).
+void resetFiltersAfterCalibration() {
+    weightChain.stage<HIVE_STAGE_EMA>().reset();
+    weightChain.stage<HIVE_STAGE_STABLE>().clearPending();
+    telemetryFilter.reset();
 }
 
-float medianFilter(float raw) {
-    medianWindow[medianIndex] = raw;
-    medianIndex = (medianIndex + 1) % MEDIAN_WINDOW_SIZE;
-    if (medianCount < MEDIAN_WINDOW_SIZE) {
-        medianCount++;
-    }
-
-    float tmp[MEDIAN_WINDOW_SIZE];
-    for (uint8_t i = 0; i < medianCount; i++) {
-        tmp[i] = medianWindow[i];
-    }
-    for (uint8_t i = 0; i < medianCount; i++) {
-        for (uint8_t j = i + 1; j < medianCount; j++) {
-            if (tmp[j] < tmp[i]) {
-                float t = tmp[i];
-                tmp[i] = tmp[j];
-                tmp[j] = t;
-            }
-        }
-    }
-    return tmp[medianCount / 2];
+float rawToGrams(int32_t raw) {
+    return (float)(raw - tareOffset) / currentCalFactor;
 }
 
-float filterWeight(float raw) {
-    // Rejette les sauts impossibles avant d'alimenter les buffers de lissage.
-    if (emaReady) {
-        float impossibleJump = fabs(raw - emaWeight);
-        if (impossibleJump > IMPOSSIBLE_JUMP_G) {
-            return emaWeight;
-        }
-    }
-
-    // Petite derive negative autour de zero: on force a zero pour eviter
-    // d'alimenter l'EMA avec un poids negatif non physique.
-    if (raw < 0.0f && raw >= -NEGATIVE_CLAMP_G) {
-        raw = 0.0f;
-    }
-
-    if (emaReady) {
-        float diff = fabs(raw - emaWeight);
-        if (diff > OUTLIER_JUMP_G) {
-            jumpStreak++;
-            if (jumpStreak >= STEP_CONFIRM_SAMPLES) {
-                // Changement reel de charge: recaler rapidement le filtre.
-                emaWeight = raw;
-                filterWindow[0] = raw;
-                filterIndex = 1;
-                filterCount = 1;
-                jumpStreak = 0;
-                return emaWeight;
-            }
-            // Pic isole: ignorer.
-            return emaWeight;
-        }
-        jumpStreak = 0;
-    }
-
-    filterWindow[filterIndex] = raw;
-    filterIndex = (filterIndex + 1) % FILTER_WINDOW_SIZE;
-    if (filterCount < FILTER_WINDOW_SIZE) {
-        filterCount++;
-    }
-
-    float sum = 0.0f;
-    for (uint8_t i = 0; i < filterCount; i++) {
-        sum += filterWindow[i];
-    }
-    float avg = sum / filterCount;
-
-    if (!emaReady) {
-        emaWeight = avg;
-        emaReady = true;
-    } else {
-        float delta = fabs(avg - emaWeight);
-        float alpha = EMA_ALPHA_SLOW;
-        if (delta > EMA_FAST_DELTA_G) {
-            alpha = EMA_ALPHA_FAST;
-        } else if (delta > EMA_MEDIUM_DELTA_G) {
-            alpha = EMA_ALPHA_MED;
+// Moyenne de n conversions recentes (contexte taskHX711, bloquant: les
+// conversions en attente sont jetees et le traitement du poids suspendu).
+bool averageFreshRaw(uint16_t n, long& out) {
+    hx711.flush();
+    int64_t acc = 0;
+    uint16_t count = 0;
+    unsigned long start = millis();
+    while (count < n) {
+        Hx711Sample smp;
+        if (hx711.pop(smp)) {
+            acc += smp.raw;
+            count++;
+        } else if (millis() - start > (unsigned long)n * 200 + HX711_FIRST_SAMPLE_TIMEOUT_MS) {
+            return false;
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(10));
         }
-        emaWeight = alpha * avg + (1.0f - alpha) * emaWeight;
     }
-
-    if (emaWeight < 0.0f && emaWeight >= -NEGATIVE_CLAMP_G) {
-        emaWeight = 0.0f;
-    }
-
-    return emaWeight;
+    out = (long)(acc / count);
+    return true;
 }
 
 uint8_t battToBars(int battPct) {
@@ -393,6 +521,9 @@ bool initOLED() {
     oled.setCursor(0, 0);
     oled.println("Balance LoRa");
     oled.display();
+    if (!oledRenderer.begin(OLED_TASK_PRIORITY, 1)) {
+        Serial.print("(envoi synchrone) ");
+    }
     
     Serial.println("OK");
     return true;
@@ -400,70 +531,59 @@ bool initOLED() {
 
 void updateDisplay() {
     if (!oled_working) return;
-    float displayWeightLocal = 0.0f;
-    float tempLocal = NAN;
-    float humLocal = NAN;
-    int batteryPercentLocal = -1;
-    int16_t lastRxRSSILocal = -120;
-    if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-        displayWeightLocal = fabs(lastWeight);
-        tempLocal = lastTempC;
-        humLocal = lastHumPct;
-        batteryPercentLocal = batteryPercent;
-        lastRxRSSILocal = lastRxRSSI;
-        xSemaphoreGive(gDataMutex);
+    MeasurementSnapshot snap;
+    measurementSnapshot.read(snap);
+    float displayWeightLocal = fabs(snap.weightG);
+
+    if (!dashboardShown) {
+        oledRenderer.clear();
+        oled.setTextColor(SSD1306_WHITE);
+        oled.setTextSize(1);
+        oled.setCursor(80, 44);
+        oled.print("BAT");
+        oled.setCursor(80, 56);
+        oled.print("SGN");
+        dashboardShown = true;
     }
-    
-    oled.clearDisplay();
-    oled.setTextColor(SSD1306_WHITE);
-    oled.setTextSize(2);
 
-    oled.setCursor(0, 0);
-    oled.print("P:");
+    char text[16];
     if (displayWeightLocal >= 1000.0f) {
-        oled.print(displayWeightLocal / 1000.0f, 3);
-        oled.print("kg");
+        snprintf(text, sizeof(text), "P:%.3fkg", displayWeightLocal / 1000.0f);
     } else {
-        oled.print(displayWeightLocal, 0);
-        oled.print("g");
+        snprintf(text, sizeof(text), "P:%.0fg", displayWeightLocal);
     }
+    oledRenderer.text(weightWidget, 2, text);
 
-    oled.setCursor(0, 22);
-    oled.print("T:");
-    if (!isnan(tempLocal)) {
-        oled.print(tempLocal, 0);
-        oled.print("C");
+    if (!isnan(snap.tempC)) {
+        snprintf(text, sizeof(text), "T:%.0fC", snap.tempC);
     } else {
-        oled.print("--C");
+        strcpy(text, "T:--C");
     }
+    oledRenderer.text(tempWidget, 2, text);
 
-    oled.setCursor(0, 44);
-    oled.print("H:");
-    if (!isnan(humLocal)) {
-        oled.print(humLocal, 0);
-        oled.print("%");
+    if (!isnan(snap.humPct)) {
+        snprintf(text, sizeof(text), "H:%.0f%%", snap.humPct);
     } else {
-        oled.print("--%");
+        strcpy(text, "H:--%");
     }
+    oledRenderer.text(humWidget, 2, text);
 
-    // BAT a droite
-    oled.setTextSize(1);
-    oled.setCursor(80, 44);
-    oled.print("BAT");
-    drawBatteryBars(batteryPercentLocal, 100, 42);
-
-    // SGN juste dessous BAT
-    oled.setCursor(80, 56);
-    oled.print("SGN");
-    drawSignalBars(lastRxRSSILocal, 100, 54);
-    
-    oled.display();
+    // BAT a droite, SGN juste dessous
+    if (oledRenderer.beginWidget(batteryWidget, battToBars(snap.batteryPercent))) {
+        drawBatteryBars(snap.batteryPercent, batteryWidget.x, batteryWidget.y);
+    }
+    if (oledRenderer.beginWidget(signalWidget, rssiToBars(snap.rssi))) {
+        drawSignalBars(snap.rssi, signalWidget.x, signalWidget.y);
+    }
+
+    oledRenderer.flush();
 }
 
 void readDhtSensor() {
     unsigned long now = millis();
-    if (now - lastDhtReadMs < DHT_READ_INTERVAL_MS) return;
+    if (dhtReadOnce && now - lastDhtReadMs < DHT_READ_INTERVAL_MS) return;
     lastDhtReadMs = now;
+    dhtReadOnce = true;
 
     float h = dht.readHumidity();
     float t = dht.readTemperature();
@@ -472,11 +592,7 @@ void readDhtSensor() {
         return;
     }
 
-    if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-        lastTempC = t;
-        lastHumPct = h;
-        xSemaphoreGive(gDataMutex);
-    }
+    postHxCommand(HX_CMD_ENV, t, h);
 }
 
 int batteryPercentFromVoltage(float voltage) {
@@ -524,8 +640,9 @@ int detectBatteryAdcPin() {
 
 void readBatteryStatus() {
     unsigned long now = millis();
-    if (now - lastBatteryReadMs < BAT_READ_INTERVAL_MS) return;
+    if (batteryReadOnce && now - lastBatteryReadMs < BAT_READ_INTERVAL_MS) return;
     lastBatteryReadMs = now;
+    batteryReadOnce = true;
 
     // Sur Heltec V3, la voie batterie est generalement active quand EN=LOW.
     digitalWrite(BAT_ADC_EN_PIN, LOW);
@@ -560,12 +677,8 @@ void readBatteryStatus() {
     }
     previousBatteryVoltage = batteryVoltageLocal;
 
-    if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-        batteryVoltage = batteryVoltageLocal;
-        batteryPercent = batteryPercentLocal;
-        batteryChargingLikely = batteryChargingLikelyLocal;
-        xSemaphoreGive(gDataMutex);
-    }
+    batteryVoltage = batteryVoltageLocal;
+    postHxCommand(HX_CMD_BATTERY, 0.0f, 0.0f, (int16_t)batteryPercentLocal, batteryChargingLikelyLocal ? 1 : 0);
 
     Serial.print("BAT raw=");
     Serial.print(adcMvAvg, 0);
@@ -578,23 +691,39 @@ void readBatteryStatus() {
     Serial.println("%");
 }
 
-void displayMessage(const char* line1, const char* line2, const char* line3) {
-    if (!oled_working) return;
-    
-    oled.clearDisplay();
+// Contexte loop() / setup() uniquement.
+void drawMessage(const OledMessage& msg) {
+    oledRenderer.clear();
+    dashboardShown = false;
     oled.setTextSize(1);
     oled.setTextColor(SSD1306_WHITE);
-    oled.setCursor(0, 15);
-    oled.println(line1);
-    if (line2 != NULL && line2[0] != '\0') {
-        oled.setCursor(0, 30);
-        oled.println(line2);
+    for (uint8_t i = 0; i < 3; i++) {
+        if (msg.lines[i][0] == '\0') continue;
+        oled.setCursor(0, 15 + 15 * i);
+        oled.println(msg.lines[i]);
     }
-    if (line3 != NULL && line3[0] != '\0') {
-        oled.setCursor(0, 45);
-        oled.println(line3);
+    oledRenderer.flush();
+}
+
+void fillOledMessage(OledMessage& msg, const char* line1, const char* line2, const char* line3) {
+    const char* lines[3] = {line1, line2, line3};
+    for (uint8_t i = 0; i < 3; i++) {
+        strlcpy(msg.lines[i], lines[i] != NULL ? lines[i] : "", OLED_MESSAGE_LINE_LEN);
+    }
+    msg.notifyShown = false;
+}
+
+// Toutes taches: dessin direct depuis loop(), sinon depot pour loop().
+void displayMessage(const char* line1, const char* line2, const char* line3) {
+    if (!oled_working) return;
+
+    OledMessage msg;
+    fillOledMessage(msg, line1, line2, line3);
+    if (xTaskGetCurrentTaskHandle() == displayTaskHandle) {
+        drawMessage(msg);
+    } else if (oledMessageSlot != NULL) {
+        xQueueOverwrite(oledMessageSlot, &msg);
     }
-    oled.display();
 }
 
 void saveCalFactor(float factor) {
@@ -635,16 +764,10 @@ bool applyCalibrationDelta(float knownMass, float measuredDelta) {
     }
 
     currentCalFactor = newCal;
-    LoadCell.setCalFactor(currentCalFactor);
     saveCalFactor(currentCalFactor);
 
     // Reinitialise les filtres pour appliquer la nouvelle echelle immediatement.
-    filterIndex = 0;
-    filterCount = 0;
-    emaWeight = 0.0f;
-    emaReady = false;
-    pendingStableCount = 0;
-    telemetryWeightReady = false;
+    resetFiltersAfterCalibration();
 
     Serial.print("Delta mesure: ");
     Serial.print(measuredDelta, 2);
@@ -686,8 +809,13 @@ bool performLegacyCalibrationWithMass(float knownMass) {
     }
 
     // Compatibilite dashboard ancien: calibrage direct en une commande.
-    LoadCell.refreshDataSet();
-    float newCal = LoadCell.getNewCalibration(knownMass);
+    long rawAvg = 0;
+    if (!averageFreshRaw(HX711_LEGACY_CAL_SAMPLES, rawAvg)) {
+        Serial.println("Calibration echouee (legacy): pas de mesure");
+        displayMessage("Calib KO", "Pas de mesure");
+        return false;
+    }
+    float newCal = (float)(rawAvg - tareOffset) / knownMass;
     if (isnan(newCal) || isinf(newCal) || newCal == 0.0f) {
         Serial.println("Calibration echouee (legacy)");
         displayMessage("Calib KO", "Legacy invalide");
@@ -700,14 +828,8 @@ bool performLegacyCalibrationWithMass(float knownMass) {
     }
 
     currentCalFactor = newCal;
-    LoadCell.setCalFactor(currentCalFactor);
     saveCalFactor(currentCalFactor);
-    filterIndex = 0;
-    filterCount = 0;
-    emaWeight = 0.0f;
-    emaReady = false;
-    pendingStableCount = 0;
-    telemetryWeightReady = false;
+    resetFiltersAfterCalibration();
 
     Serial.print("Legacy calFactor: ");
     Serial.println(currentCalFactor, 2);
@@ -738,14 +860,70 @@ bool isStartupStable() {
     return (mx - mn) <= STARTUP_STABLE_SPAN_G;
 }
 
-void enterDeepSleep() {
-    if (oled_working && !isUsbSerialActive()) {
-        oled.clearDisplay();
-        oled.setTextSize(1);
-        oled.setTextColor(SSD1306_WHITE);
-        oled.setCursor(0, 18);
-        oled.println("Sleep...");
-        oled.display();
+// Contexte taskHX711 (commande HX_CMD_SAVE_WARM).
+void saveWarmBootState() {
+    if (tareInProgress || tareResidualPending || !weightChain.stage<HIVE_STAGE_EMA>().ready()) {
+        // Etat transitoire: le prochain reveil repartira a froid.
+        warmState.magic = 0;
+        return;
+    }
+    warmState.tareOffset = tareOffset;
+    warmState.chain = weightChain;
+    warmState.telemetry = telemetryFilter;
+    warmState.stableWeight = stableWeight;
+    warmState.tempC = lastTempC;
+    warmState.humPct = lastHumPct;
+    warmState.batteryPercent = batteryPercent;
+    warmState.stats = intervalStats;
+    warmState.magic = WARM_BOOT_MAGIC;
+}
+
+// Demande la sauvegarde a taskHX711 et attend qu'elle soit faite. Sans
+// reponse (calibration bloquante en cours), l'etat reste invalide et le
+// prochain reveil repart a froid.
+void requestWarmBootSave() {
+    warmState.magic = 0;
+    if (hxCommandQueue == NULL || warmSavedSem == NULL) return;
+    xSemaphoreTake(warmSavedSem, 0);
+    if (!postHxCommand(HX_CMD_SAVE_WARM)) return;
+    if (xSemaphoreTake(warmSavedSem, WARM_SAVE_WAIT) != pdTRUE) {
+        Serial.println("Warm boot: sauvegarde sans reponse");
+    }
+}
+
+// Contexte taskHX711: la charge a change pendant le sommeil. L'historique
+// restaure (mediane, EMA, bande morte, telemetrie) retarderait la nouvelle
+// valeur de plusieurs reveils; seul le zero est garde.
+void dropWarmWeightHistory() {
+    weightChain.stage<HIVE_STAGE_MEDIAN>().reset();
+    weightChain.stage<HIVE_STAGE_EMA>().reset();
+    weightChain.stage<HIVE_STAGE_STABLE>().reset();
+    telemetryFilter.reset();
+    startupBufCount = 0;
+    startupBufIndex = 0;
+    warmHistoryDropped = true;
+}
+
+void restoreWarmBootState() {
+    weightChain = warmState.chain;
+    telemetryFilter = warmState.telemetry;
+    stableWeight = warmState.stableWeight;
+    lastWeight = telemetryFilter.value();
+    lastTempC = warmState.tempC;
+    lastHumPct = warmState.humPct;
+    batteryPercent = warmState.batteryPercent;
+    intervalStats = warmState.stats;
+}
+
+void enterDeepSleep(uint32_t sleepMs) {
+    requestWarmBootSave();
+    if (oled_working && !isUsbSerialActive() && oledMessageSlot != NULL) {
+        // Contexte taskLoRa: loop() dessine et attend l'envoi I2C.
+        OledMessage msg;
+        fillOledMessage(msg, "Sleep...", "", "");
+        msg.notifyShown = true;
+        xQueueOverwrite(oledMessageSlot, &msg);
+        xSemaphoreTake(oledShownSem, pdMS_TO_TICKS(OLED_SLEEP_WAIT_MS));
         vTaskDelay(pdMS_TO_TICKS(80));
         // Coupe l'alim OLED via VEXT.
         digitalWrite(VEXT_PIN, HIGH);
@@ -754,12 +932,170 @@ void enterDeepSleep() {
     digitalWrite(BAT_ADC_EN_PIN, HIGH);
     radio.sleep();
     SPI.end();
-    esp_sleep_enable_timer_wakeup((uint64_t)LOW_POWER_SLEEP_S * 1000000ULL);
+    lastSleepS = sleepMs / 1000UL;
+    rtcClockBaseMs += (uint64_t)millis() + (uint64_t)sleepMs;
+    esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000ULL);
     esp_deep_sleep_start();
 }
 
+uint64_t rtcNowMs() {
+    return rtcClockBaseMs + (uint64_t)millis();
+}
+
+void pushLowPowerSample(float weightG, float tempC, float humPct) {
+    LowPowerSample& s = lpSamples[lpSampleHead];
+    s.tsMs = rtcNowMs();
+    s.weightG = weightG;
+    s.tempC = tempC;
+    s.humPct = humPct;
+    lpSampleHead = (lpSampleHead + 1) % LOW_POWER_BATCH_CAPACITY;
+    if (lpSampleCount < LOW_POWER_BATCH_CAPACITY) lpSampleCount++;
+}
+
+static uint32_t reportNowMs() {
+    return (uint32_t)rtcNowMs();
+}
+
+// taskLoRa uniquement (ou initLoRa avant les taches).
+static void applyRadioProfile(const RucheAdrSetting& profile) {
+    radio.standby();
+    radio.setSpreadingFactor(profile.sf);
+    radio.setOutputPower(profile.powerDbm);
+    radioProfile = profile;
+    radioReceiveMode = false;
+}
+
+// Attend le debut du creneau TDMA avant une trame montante (reveil cale
+// TDMA_WAKE_LEAD_MS plus tot). Creneau manque ou inconnu: pas d'attente.
+static void waitTdmaSlot() {
+    uint32_t waitMs = tdmaClock.msUntilSlot(rtcNowMs());
+    if (waitMs == 0) return;
+    if (waitMs > TDMA_MAX_SLOT_WAIT_MS) {
+        Serial.println("TDMA: creneau manque, emission immediate");
+        return;
+    }
+    vTaskDelay(pdMS_TO_TICKS(waitMs));
+}
+
+static bool isDefaultRadioProfile() {
+    return !rucheAdrValid(radioProfile) || rucheAdrEqual(radioProfile, rucheAdrDefault());
+}
+
+// Avant chaque nouvelle trame de telemetrie: la precedente a-t-elle ete
+// acquittee? Au bout de ADR_FALLBACK_MISSED_ACKS echecs, retour au profil
+// par defaut (le recepteur y revient aussi quand il n'entend plus rien).
+static void noteMissedReportAck() {
+    if (!reportPolicy.awaitingAck()) return;
+    if (missedReportAcks < 255) missedReportAcks++;
+    if (missedReportAcks >= ADR_FALLBACK_MISSED_ACKS && !isDefaultRadioProfile()) {
+        Serial.println("ADR: ACK perdus, retour au profil radio par defaut");
+        applyRadioProfile(rucheAdrDefault());
+        beginLoRaReceive();
+    }
+}
+
+static ReportValues makeReportValues(float weightG, float tempC, float humPct, int battPct) {
+    ReportValues v;
+    v.weightG = weightG;
+    v.tempC = tempC;
+    v.humPct = humPct;
+    v.battPct = battPct;
+    return v;
+}
+
+static void fillStatField(const RunningStats& in, RucheStatField& out) {
+    out.count = (uint16_t)(in.count > 0xFFFF ? 0xFFFF : in.count);
+    out.mean = in.mean;
+    out.min = in.min;
+    out.max = in.max;
+    out.stddev = in.stddev();
+}
+
+// Statistiques de l'intervalle pour la trame; RUCHE_FLAG_STATS a ajouter
+// aux drapeaux, 0 si aucune mesure.
+static uint8_t fillFrameStats(const IntervalStats& in, RucheIntervalStats& out) {
+    if (in.empty()) return 0;
+    out.spanS = in.spanS(rtcNowMs());
+    fillStatField(in.weight, out.weight);
+    fillStatField(in.temp, out.temp);
+    fillStatField(in.hum, out.hum);
+    return RUCHE_FLAG_STATS;
+}
+
+// Anciennete de la plus vieille mesure du lot (0 si lot vide).
+static uint64_t lowPowerOldestAgeMs() {
+    if (lpSampleCount == 0) return 0;
+    uint8_t first = (lpSampleHead + LOW_POWER_BATCH_CAPACITY - lpSampleCount) % LOW_POWER_BATCH_CAPACITY;
+    return rtcNowMs() - lpSamples[first].tsMs;
+}
+
+bool flushLowPowerBatch(int battPct, uint8_t flags, const IntervalStats& stats) {
+    if (lpSampleCount == 0) return true;
+    uint64_t nowMs = rtcNowMs();
+    uint8_t first = (lpSampleHead + LOW_POWER_BATCH_CAPACITY - lpSampleCount) % LOW_POWER_BATCH_CAPACITY;
+    const LowPowerSample& newest = lpSamples[(lpSampleHead + LOW_POWER_BATCH_CAPACITY - 1) % LOW_POWER_BATCH_CAPACITY];
+
+    noteMissedReportAck();
+    if (isDefaultRadioProfile()) flags |= RUCHE_FLAG_ADR_DEFAULT;
+    if (!frameSeqAcked) flags |= RUCHE_FLAG_SEQ_RESET;
+    RucheIntervalStats frameStats;
+    flags |= fillFrameStats(stats, frameStats);
+    uint8_t frame[RUCHE_BATCH_MAX_BYTES];
+    size_t frameLen = 0;
+    uint16_t seq = frameSeq++;
+    if (lpSampleCount == 1) {
+        // Une seule mesure: trame simple, plus courte.
+        RucheTelemetry tm;
+        tm.nodeId = loraNodeNum;
+        tm.seq = seq;
+        tm.weightG = newest.weightG;
+        tm.tempC = newest.tempC;
+        tm.humPct = newest.humPct;
+        tm.battPct = battPct;
+        tm.flags = flags;
+        tm.stats = frameStats;
+        frameLen = rucheEncodeTelemetry(tm, frame, sizeof(frame));
+    } else {
+        RucheBatch batch;
+        batch.nodeId = loraNodeNum;
+        batch.seq = seq;
+        batch.battPct = battPct;
+        batch.flags = flags;
+        batch.count = lpSampleCount;
+        batch.stats = frameStats;
+        for (uint8_t i = 0; i < lpSampleCount; i++) {
+            const LowPowerSample& s = lpSamples[(first + i) % LOW_POWER_BATCH_CAPACITY];
+            RucheBatchEntry& e = batch.entries[i];
+            e.ageS = (uint32_t)((nowMs - s.tsMs) / 1000ULL);
+            e.weightG = s.weightG;
+            e.tempC = s.tempC;
+            e.humPct = s.humPct;
+        }
+        frameLen = rucheEncodeBatch(batch, frame, sizeof(frame));
+    }
+
+    waitTdmaSlot();
+    if (frameLen == 0 || !transmitFrameBlocking(frame, frameLen)) {
+        // Echec radio: on garde les mesures pour le prochain reveil.
+        return false;
+    }
+    lpLastSentWeight = newest.weightG;
+    lpLastSentWeightReady = true;
+    lpSampleCount = 0;
+    postHxCommand(HX_CMD_STATS_RESET);
+    reportPolicy.onSent(seq, makeReportValues(newest.weightG, newest.tempC, newest.humPct, battPct));
+    listenRxWindow();
+    return true;
+}
+
+// taskLoRa / setup (coeur 1, comme le service d'interruptions GPIO).
+static void armLoraDio1() {
+    gpio_intr_enable((gpio_num_t)LORA_DIO1);
+}
+
 void beginLoRaReceive() {
     int state = radio.startReceive();
+    armLoraDio1();
     if (state == RADIOLIB_ERR_NONE) {
         radioReceiveMode = true;
     } else {
@@ -769,8 +1105,156 @@ void beginLoRaReceive() {
     }
 }
 
-void onLoraDio1() {
-    loraRxFlag = true;
+// Avec le light sleep automatique, DIO1 est une interruption de niveau
+// haut (gpio_wakeup_enable): masquee ici, reactivee par armLoraDio1 une
+// fois l'IRQ de la radio effacee.
+void IRAM_ATTR onLoraDio1() {
+    gpio_ll_intr_disable(&GPIO, (gpio_num_t)LORA_DIO1);
+    loraDio1Flag = true;
+    if (loraTaskHandle != NULL) {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(loraTaskHandle, LORA_EVT_RADIO, eSetBits, &woken);
+        if (woken == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    }
+}
+
+// taskLoRa uniquement: paquet recu (ACK binaire de telemetrie ou commande texte).
+void handleLoRaRx() {
+    uint8_t incoming[128];
+    size_t len = radio.getPacketLength();
+    if (len > sizeof(incoming) - 1) len = sizeof(incoming) - 1;
+    int state = radio.readData(incoming, len);
+    if (state == RADIOLIB_ERR_NONE) {
+        postHxCommand(HX_CMD_RSSI, 0.0f, 0.0f, (int16_t)radio.getRSSI());
+        RucheAck ack;
+        if (rucheDecodeAck(incoming, len, &ack)) {
+            if (ack.nodeId == loraNodeNum) {
+                downlinkExpected = (ack.flags & RUCHE_ACK_FLAG_DOWNLINK) != 0;
+                frameSeqAcked = true;
+                // Horodatage du recepteur pris au debut de l'ACK.
+                uint64_t ackStartMs = rtcNowMs() - radio.getTimeOnAir(len) / 1000UL;
+                tdmaClock.onSync(ackStartMs, ack.cyclePosMs, ack.tdmaSlot);
+                if (reportPolicy.onAck(ack.seq, reportNowMs())) {
+                    missedReportAcks = 0;
+                    Serial.print("ACK trame seq=");
+                    Serial.println(ack.seq);
+                }
+                RucheAdrSetting rec;
+                rec.sf = ack.adrSf;
+                rec.powerDbm = ack.adrPowerDbm;
+                if (rucheAdrValid(rec) && !rucheAdrEqual(rec, radioProfile)) {
+                    applyRadioProfile(rec);
+                    char line[48];
+                    snprintf(line, sizeof(line), "ADR: SF%u %d dBm", (unsigned)rec.sf, (int)rec.powerDbm);
+                    Serial.println(line);
+                }
+            }
+        } else if (rucheIsBinaryFrame(incoming, len)) {
+            // Jamais une commande texte: ACK d'une autre version ou corrompu.
+            uint8_t version = rucheFrameVersion(incoming, len);
+            if (version != RUCHE_FRAME_VERSION) {
+                char line[80];
+                snprintf(line, sizeof(line), "ACK version %u ignore (noeud en version %u): mettre a jour",
+                         (unsigned)version, (unsigned)RUCHE_FRAME_VERSION);
+                Serial.println(line);
+            }
+        } else {
+            incoming[len] = '\0';
+            downlinkExpected = false;
+            Serial.print("LoRa RX: ");
+            Serial.println((const char*)incoming);
+            handleLoRaCommand((const char*)incoming);
+        }
+    }
+    radioReceiveMode = false;
+    beginLoRaReceive();
+}
+
+// Low power: la radio reste en reception apres la trame. L'ACK arrive
+// dans LORA_RX_WINDOW_MS; s'il annonce une commande, le recepteur l'emet
+// une seule fois juste apres et on ecoute LORA_DOWNLINK_WINDOW_MS de plus.
+void listenRxWindow() {
+    downlinkExpected = false;
+    bool extended = false;
+    unsigned long start = millis();
+    unsigned long windowMs = LORA_RX_WINDOW_MS;
+    while ((millis() - start) < windowMs) {
+        if (!loraDio1Flag) {
+            waitLoraRadioEvent(windowMs - (millis() - start));
+            continue;
+        }
+        loraDio1Flag = false;
+        handleLoRaRx();
+        if (downlinkExpected) {
+            if (!extended) {
+                windowMs = (millis() - start) + LORA_DOWNLINK_WINDOW_MS;
+                extended = true;
+            }
+        } else if (!reportPolicy.awaitingAck()) {
+            break;
+        }
+    }
+    downlinkExpected = false;
+    rearmDeferredLoraEvents();
+}
+
+void onLoraDeadline(TimerHandle_t timer) {
+    (void)timer;
+    xTaskNotify(loraTaskHandle, LORA_EVT_DEADLINE, eSetBits);
+}
+
+// Garde l'echeance future la plus proche.
+static void keepEarliestDeadline(unsigned long now, unsigned long candidate,
+                                 unsigned long& best, bool& hasBest) {
+    if ((long)(candidate - now) <= 0) return;
+    if (!hasBest || (long)(candidate - best) < 0) {
+        best = candidate;
+        hasBest = true;
+    }
+}
+
+void armLoRaDeadline(unsigned long now, unsigned long deadline, bool hasDeadline) {
+    if (!hasDeadline) {
+        xTimerStop(loraDeadlineTimer, 0);
+        return;
+    }
+    unsigned long delayMs = deadline - now;
+    TickType_t ticks = pdMS_TO_TICKS(delayMs);
+    if (ticks == 0) ticks = 1;
+    // Change la periode et (re)demarre le timer.
+    xTimerChangePeriod(loraDeadlineTimer, ticks, 0);
+}
+
+void configureAutoLightSleep() {
+    if (!AUTO_LIGHT_SLEEP_WHEN_AWAKE) return;
+    // DIO1 (paquet recu, fin d'emission), DOUT du HX711 (conversion
+    // prete), le bouton PRG et l'UART console reveillent le CPU; le premier
+    // caractere recu pendant le sommeil peut etre perdu. Le reveil GPIO
+    // n'existe qu'en niveau: les ISR de ces broches se masquent elles-memes
+    // et leur tache les reactive (sinon un niveau tenu les relancerait sans fin).
+    gpio_wakeup_enable((gpio_num_t)LORA_DIO1, GPIO_INTR_HIGH_LEVEL);
+    gpio_wakeup_enable((gpio_num_t)HX711_dout, GPIO_INTR_LOW_LEVEL);
+    gpio_wakeup_enable((gpio_num_t)PRG_BUTTON_PIN, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    uart_set_wakeup_threshold(UART_NUM_0, 3);
+    esp_sleep_enable_uart_wakeup(UART_NUM_0);
+
+    esp_pm_config_esp32s3_t pm;
+    pm.max_freq_mhz = 240;
+    pm.min_freq_mhz = 40;
+    pm.light_sleep_enable = true;
+    esp_err_t err = esp_pm_configure(&pm);
+    if (err == ESP_OK) {
+        Serial.println("Light sleep auto: actif");
+        return;
+    }
+    // Sans tickless idle dans le sdkconfig: frequence dynamique seule.
+    pm.light_sleep_enable = false;
+    err = esp_pm_configure(&pm);
+    Serial.print("Light sleep auto indisponible, DFS ");
+    Serial.println(err == ESP_OK ? "actif" : "indisponible");
 }
 
 static char* trimInPlace(char* s) {
@@ -809,79 +1293,49 @@ void handleLoRaCommand(const char* message) {
     target = trimInPlace(target);
     commandPart = trimInPlace(commandPart);
 
-    if (target[0] != '\0' && strcmp(target, "*") != 0 && strcmp(target, LORA_NODE_ID) != 0) {
+    if (target[0] != '\0' && strcmp(target, "*") != 0 && strcmp(target, loraNodeId) != 0) {
         return;
     }
 
     if (strcasecmp(commandPart, "TARE") == 0) {
-        if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-            LoadCell.tareNoDelay();
-            tareInProgress = true;
-            xSemaphoreGive(gDataMutex);
+        char ack[64];
+        if (!postHxCommand(HX_CMD_TARE)) {
+            snprintf(ack, sizeof(ack), "ACK:%s:ERR:BUSY", loraNodeId);
+            envoyerPaquet(ack);
+            return;
         }
         Serial.println("Commande LoRa: TARE");
         displayMessage("Tare distante");
-        char ack[64];
-        snprintf(ack, sizeof(ack), "ACK:%s:TARE:STARTED", LORA_NODE_ID);
+        snprintf(ack, sizeof(ack), "ACK:%s:TARE:STARTED", loraNodeId);
         envoyerPaquet(ack);
         return;
     }
 
+    // Les ACK de calibration sont envoyes par taskHX711 une fois la
+    // commande traitee (base mesuree, masse stabilisee...).
     if (strcasecmp(commandPart, "CAL_START") == 0) {
-        if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-            calibrationBaseWeight = stableWeight;
-            calibrationBaseReady = true;
-            calibrationCommandWindowUntilMs = millis() + CALIBRATION_COMMAND_WINDOW_MS;
-            xSemaphoreGive(gDataMutex);
+        if (!postHxCommand(HX_CMD_CAL_START)) {
+            char ack[64];
+            snprintf(ack, sizeof(ack), "ACK:%s:ERR:BUSY", loraNodeId);
+            envoyerPaquet(ack);
         }
-        Serial.print("Commande LoRa: CAL_START base=");
-        Serial.println(calibrationBaseWeight, 2);
-        char ack[80];
-        snprintf(ack, sizeof(ack), "ACK:%s:CAL_START:OK:%.2f", LORA_NODE_ID, calibrationBaseWeight);
-        envoyerPaquet(ack);
         return;
     }
 
     if (strncasecmp(commandPart, "CAL:", 4) == 0) {
         char* massToken = trimInPlace(commandPart + 4);
         float knownMass = strtof(massToken, NULL);
-        bool ok = false;
-        if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-            if (calibrationBaseReady) {
-                calibrationPending = true;
-                calibrationKnownMass = knownMass;
-                calibrationPendingSinceMs = millis();
-                calibrationLastDelta = 0.0f;
-                calibrationMaxDelta = 0.0f;
-                calibrationStableCount = 0;
-                ok = true;
-            } else {
-                // Fallback pour compatibilite dashboard existant (commande unique).
-                ok = performLegacyCalibrationWithMass(knownMass);
-            }
-            if (!calibrationPending) {
-                calibrationCommandWindowUntilMs = 0;
-            }
-            xSemaphoreGive(gDataMutex);
+        if (!postHxCommand(HX_CMD_CAL_REMOTE, knownMass)) {
+            char ack[64];
+            snprintf(ack, sizeof(ack), "ACK:%s:ERR:BUSY", loraNodeId);
+            envoyerPaquet(ack);
         }
-        if (calibrationPending) {
-            Serial.print("Commande LoRa: CAL attente stabilisation masse=");
-            Serial.println(knownMass, 2);
-            return;
-        }
-        char ack[80];
-        if (ok) {
-            snprintf(ack, sizeof(ack), "ACK:%s:CAL:OK:%.2f", LORA_NODE_ID, knownMass);
-        } else {
-            snprintf(ack, sizeof(ack), "ACK:%s:CAL:ERR", LORA_NODE_ID);
-        }
-        envoyerPaquet(ack);
         return;
     }
 
     {
         char ack[72];
-        snprintf(ack, sizeof(ack), "ACK:%s:ERR:UNKNOWN_CMD", LORA_NODE_ID);
+        snprintf(ack, sizeof(ack), "ACK:%s:ERR:UNKNOWN_CMD", loraNodeId);
         envoyerPaquet(ack);
     }
 }
@@ -897,12 +1351,7 @@ void processSerialLine(char* line) {
             return;
         }
 
-        bool calOk = false;
-        calOk = performCalibrationWithMass(knownMass);
-        if (!calOk) {
-            waitingKnownMass = false;
-            return;
-        }
+        postHxCommand(HX_CMD_CAL_MASS, knownMass);
         waitingKnownMass = false;
         return;
     }
@@ -910,35 +1359,20 @@ void processSerialLine(char* line) {
     char cmd = (char)tolower((unsigned char)pLine[0]);
     switch(cmd) {
         case 't':
-            if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-                LoadCell.tareNoDelay();
-                tareInProgress = true;
-                xSemaphoreGive(gDataMutex);
+            if (postHxCommand(HX_CMD_TARE)) {
+                Serial.println("Tare lancee...");
+                displayMessage("Tare...");
             }
-            Serial.println("Tare lancee...");
-            displayMessage("Tare...");
             break;
         case 'c':
             {
                 char* massToken = trimInPlace(pLine + 1);
                 if (massToken[0] != '\0') {
-                    float knownMass = strtof(massToken, NULL);
-                    bool calOk = performCalibrationWithMass(knownMass);
-                    if (!calOk) {
-                        Serial.println("Usage: c500  (ou c puis 500)");
-                    }
-                } else {
-                    if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-                        calibrationBaseWeight = stableWeight;
-                        calibrationBaseReady = true;
-                        xSemaphoreGive(gDataMutex);
-                    }
+                    postHxCommand(HX_CMD_CAL_MASS, strtof(massToken, NULL));
+                } else if (postHxCommand(HX_CMD_CAL_BASE)) {
                     waitingKnownMass = true;
                     Serial.println("Poser masse connue puis saisir la masse en g (ex: 500.0)");
                     Serial.println("Astuce rapide: c500");
-                    Serial.print("Base calib: ");
-                    Serial.print(calibrationBaseWeight, 2);
-                    Serial.println(" g");
                     displayMessage("Calibration", "Entrez masse g");
                 }
             }
@@ -946,8 +1380,12 @@ void processSerialLine(char* line) {
         case 'x':
             envoyerPaquet("TEST");
             break;
+        case 'r':
+            rawTraceEnabled = !rawTraceEnabled;
+            Serial.println(rawTraceEnabled ? "Trace brute HX711: ON (RAW,ms,g)" : "Trace brute HX711: OFF");
+            break;
         case 'h':
-            Serial.println("Commandes: t=tare, c=calibrage, c500=calib rapide, x=test envoi, h=aide");
+            Serial.println("Commandes: t=tare, c=calibrage, c500=calib rapide, x=test envoi, r=trace brute, h=aide");
             break;
         default:
             Serial.println("Commande inconnue. h pour aide.");
@@ -956,16 +1394,26 @@ void processSerialLine(char* line) {
 }
 
 // ===== Initialisation HX711 =====
-bool initHX711() {
+bool initHX711(bool warm) {
     Serial.print("Init HX711... ");
     
-    LoadCell.begin();
-    LoadCell.start(2500, false);
-    
-    if (LoadCell.getTareTimeoutFlag()) {
-        Serial.println("ECHEC TIMEOUT");
+    if (!hx711.begin(HX711_SAMPLER_PRIORITY, 1)) {
+        Serial.println("ECHEC tache");
         return false;
     }
+    // A chaud la cellule n'a pas bouge: courte stabilisation apres mise sous tension.
+    vTaskDelay(pdMS_TO_TICKS(warm ? WARM_BOOT_HX711_SETTLE_MS : 2500));
+    
+    unsigned long waitStart = millis();
+    while (hx711.pending() == 0) {
+        if (millis() - waitStart > HX711_FIRST_SAMPLE_TIMEOUT_MS) {
+            Serial.println("ECHEC TIMEOUT");
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    // Conversions de la phase de stabilisation ignorees.
+    hx711.flush();
     
     EEPROM.begin(EEPROM_TOTAL_SIZE);
     float calVal;
@@ -980,11 +1428,13 @@ bool initHX711() {
     }
     
     currentCalFactor = calVal;
-    LoadCell.setCalFactor(currentCalFactor);
-    Serial.print(" tareOfs=ignored");
-    // Plus de lissage natif HX711 pour fiabiliser le debut de mesure.
-    LoadCell.setSamplesInUse(32);
-    LoadCell.refreshDataSet();
+    if (warm) {
+        tareOffset = warmState.tareOffset;
+        Serial.print(" tareOfs=rtc");
+    } else {
+        tareOffset = 0;
+        Serial.print(" tareOfs=ignored");
+    }
     Serial.print("OK, cal=");
     Serial.println(currentCalFactor, 2);
     
@@ -1011,19 +1461,22 @@ bool initLoRa() {
     if (state == RADIOLIB_ERR_NONE) {
         Serial.println("OK");
         
-        // Configuration EXACTE pour compatibilite
-        radio.setOutputPower(14);      // 14 dBm
-        radio.setSpreadingFactor(7);    // SF7
+        // Configuration EXACTE pour compatibilite (SF/puissance: profil ADR
+        // garde en RTC, profil par defaut SF7 / 14 dBm au demarrage a froid)
+        RucheAdrSetting profile = rucheAdrValid(radioProfile) ? radioProfile : rucheAdrDefault();
         radio.setBandwidth(125.0);      // 125 kHz
         radio.setCodingRate(5);         // 4/5
         radio.setPreambleLength(8);     // 8 symboles
         radio.setSyncWord(0x12);        // Sync word standard
         radio.setCRC(true);              // CRC active
         radio.setDio1Action(onLoraDio1);
+        applyRadioProfile(profile);
         beginLoRaReceive();
         
         Serial.println("   Frequence: 868.000 MHz");
-        Serial.println("   SF: 7, BW: 125 kHz, CR: 4/5");
+        char line[48];
+        snprintf(line, sizeof(line), "   SF: %u, BW: 125 kHz, CR: 4/5, %d dBm", (unsigned)profile.sf, (int)profile.powerDbm);
+        Serial.println(line);
         return true;
     } else {
         Serial.print("ECHEC Code: ");
@@ -1033,90 +1486,435 @@ bool initLoRa() {
 }
 
 // ===== Fonction d'envoi avec RadioLib =====
-bool envoyerPaquet(const char* message) {
-    Serial.print("Envoi: ");
-    Serial.print(message);
+static void logTxFrame(const LoraTxFrame& f) {
+    if (f.binary) {
+        Serial.print("Envoi bin ");
+        Serial.print((unsigned)f.len);
+        Serial.print("o:");
+        for (size_t i = 0; i < f.len; i++) {
+            char hex[4];
+            snprintf(hex, sizeof(hex), " %02X", f.data[i]);
+            Serial.print(hex);
+        }
+    } else {
+        Serial.print("Envoi: ");
+        Serial.write(f.data, f.len);
+    }
     Serial.print(" ... ");
-    
+}
+
+// taskLoRa uniquement: lance l'emission, la fin arrive sur DIO1.
+static bool startFrameTransmit(const LoraTxFrame& f) {
+    logTxFrame(f);
     digitalWrite(LED_BUILTIN, HIGH);
-    
     radioReceiveMode = false;
-    // Envoi synchrone
-    int state = radio.transmit(message); // 5 secondes timeout
-    
+    loraDio1Flag = false;
+    int state = radio.startTransmit(f.data, f.len);
+    if (state != RADIOLIB_ERR_NONE) {
+        digitalWrite(LED_BUILTIN, LOW);
+        Serial.print("ECHEC Code: ");
+        Serial.println(state);
+        packetsFailed++;
+        radioTxLastOk = false;
+        beginLoRaReceive();
+        return false;
+    }
+    armLoraDio1();
+    radioTxBusy = true;
+    radioTxStartMs = millis();
+    radioTxTimeoutMs = radio.getTimeOnAir(f.len) / 1000UL + LORA_TX_TIMEOUT_MARGIN_MS;
+    return true;
+}
+
+// taskLoRa uniquement: DIO1 recu (ok) ou delai depasse.
+static void completeFrameTransmit(bool ok) {
+    radio.finishTransmit();
+    radioTxBusy = false;
+    radioTxLastOk = ok;
     digitalWrite(LED_BUILTIN, LOW);
-    
-    if (state == RADIOLIB_ERR_NONE) {
+    if (ok) {
         Serial.println("OK");
         packetsSent++;
-        beginLoRaReceive();
-        return true;
     } else {
-        Serial.print("ECHEC Code: ");
-        Serial.println(state);
+        Serial.println("ECHEC timeout TX");
         packetsFailed++;
-        beginLoRaReceive();
+    }
+    beginLoRaReceive();
+}
+
+static bool radioTxTimedOut(unsigned long now) {
+    return radioTxBusy && (now - radioTxStartMs) >= radioTxTimeoutMs;
+}
+
+// Trame suivante: file de controle d'abord, puis derniere telemetrie.
+static void startNextTransmit() {
+    LoraTxFrame f;
+    while (!radioTxBusy) {
+        if (xQueueReceive(loraTxControlQueue, &f, 0) != pdTRUE &&
+            xQueueReceive(loraTxTelemetrySlot, &f, 0) != pdTRUE) {
+            return;
+        }
+        startFrameTransmit(f);
+    }
+}
+
+// taskLoRa uniquement: dort jusqu'a DIO1 (LORA_EVT_RADIO) ou timeoutMs.
+// Seul ce bit est consomme; les autres evenements sont notes pour
+// rearmDeferredLoraEvents.
+void waitLoraRadioEvent(unsigned long timeoutMs) {
+    if (loraDio1Flag) return;
+    uint32_t bits = 0;
+    if (xTaskNotifyWait(0, LORA_EVT_RADIO, &bits, pdMS_TO_TICKS(timeoutMs) + 1) == pdTRUE) {
+        loraDeferredEvents |= bits & ~LORA_EVT_RADIO;
+    }
+}
+
+// Fin d'une attente de DIO1: la boucle de taskLoRa doit encore voir les
+// evenements arrives entre-temps (leurs bits sont restes dans la valeur
+// de notification, il manque seulement le reveil).
+void rearmDeferredLoraEvents() {
+    if (loraDeferredEvents == 0) return;
+    loraDeferredEvents = 0;
+    xTaskNotify(xTaskGetCurrentTaskHandle(), 0, eNoAction);
+}
+
+// taskLoRa uniquement, avant deep sleep: attend la fin de l'emission en cours.
+static void waitTransmitIdle() {
+    while (radioTxBusy) {
+        unsigned long elapsed = millis() - radioTxStartMs;
+        if (loraDio1Flag) {
+            loraDio1Flag = false;
+            completeFrameTransmit(true);
+        } else if (elapsed >= radioTxTimeoutMs) {
+            completeFrameTransmit(false);
+        } else {
+            waitLoraRadioEvent(radioTxTimeoutMs - elapsed);
+        }
+    }
+    rearmDeferredLoraEvents();
+}
+
+bool transmitFrameBlocking(const uint8_t* data, size_t len) {
+    waitTransmitIdle();
+    LoraTxFrame f;
+    if (len > sizeof(f.data)) {
+        packetsFailed++;
+        return false;
+    }
+    f.len = (uint8_t)len;
+    f.binary = 1;
+    memcpy(f.data, data, len);
+    if (!startFrameTransmit(f)) return false;
+    waitTransmitIdle();
+    return radioTxLastOk;
+}
+
+// ACK encore en file avant deep sleep: envoyes sans attendre taskLoRa.
+void flushControlTxBlocking() {
+    waitTransmitIdle();
+    LoraTxFrame f;
+    while (xQueueReceive(loraTxControlQueue, &f, 0) == pdTRUE) {
+        if (startFrameTransmit(f)) waitTransmitIdle();
+    }
+}
+
+static bool queueTxFrame(const uint8_t* data, size_t len, bool binary, bool telemetry) {
+    if (loraTxControlQueue == NULL || len == 0 || len > LORA_TX_MAX_BYTES) {
+        packetsFailed++;
+        return false;
+    }
+    LoraTxFrame f;
+    f.len = (uint8_t)len;
+    f.binary = binary ? 1 : 0;
+    memcpy(f.data, data, len);
+    if (telemetry) {
+        xQueueOverwrite(loraTxTelemetrySlot, &f);
+    } else if (xQueueSend(loraTxControlQueue, &f, 0) != pdTRUE) {
+        Serial.println("File TX pleine: trame abandonnee");
+        packetsFailed++;
+        return false;
+    }
+    if (loraTaskHandle != NULL) {
+        xTaskNotify(loraTaskHandle, LORA_EVT_TX, eSetBits);
+    }
+    return true;
+}
+
+// Depot non bloquant (toute tache): ACK, reponses et messages texte.
+bool envoyerPaquet(const char* message) {
+    return queueTxFrame((const uint8_t*)message, strlen(message), false, false);
+}
+
+// Depot non bloquant de la telemetrie: remplace une trame pas encore partie.
+bool envoyerTrame(const uint8_t* data, size_t len) {
+    return queueTxFrame(data, len, true, true);
+}
+
+// ===== Commandes taskHX711 =====
+bool postHxCommand(uint8_t type, float value, float value2, int16_t arg, uint8_t flag) {
+    if (hxCommandQueue == NULL) return false;
+    HxCommand cmd;
+    cmd.type = type;
+    cmd.flag = flag;
+    cmd.arg = arg;
+    cmd.value = value;
+    cmd.value2 = value2;
+    if (xQueueSend(hxCommandQueue, &cmd, HX_COMMAND_POST_WAIT) != pdTRUE) {
+        Serial.println("File HX711 pleine: commande ignoree");
         return false;
     }
+    return true;
+}
+
+// Les fonctions suivantes s'executent dans taskHX711.
+void publishSnapshot() {
+    MeasurementSnapshot snap;
+    snap.weightG = lastWeight;
+    snap.stableWeightG = stableWeight;
+    snap.tempC = lastTempC;
+    snap.humPct = lastHumPct;
+    snap.batteryPercent = batteryPercent;
+    snap.rssi = lastRxRSSI;
+    snap.flags = 0;
+    if (startupReady) snap.flags |= SNAP_STARTUP_READY;
+    if (batteryChargingLikely) snap.flags |= SNAP_CHARGING;
+    if (calibrationCommandWindowUntilMs != 0) snap.flags |= SNAP_CAL_WINDOW;
+    snap.tareEpoch = tareEpoch;
+    snap.stats = intervalStats;
+    measurementSnapshot.publish(snap);
+
+    // Reveille taskLoRa seulement si sa decision d'envoi peut changer (le
+    // poids stable ne bouge qu'apres la bande morte: rare).
+    static float notifiedStable = 0.0f;
+    static uint8_t notifiedFlags = 0;
+    static uint8_t notifiedEpoch = 0;
+    if (snap.stableWeightG != notifiedStable || snap.flags != notifiedFlags || snap.tareEpoch != notifiedEpoch) {
+        notifiedStable = snap.stableWeightG;
+        notifiedFlags = snap.flags;
+        notifiedEpoch = snap.tareEpoch;
+        if (loraTaskHandle != NULL) {
+            xTaskNotify(loraTaskHandle, LORA_EVT_MEASURE, eSetBits);
+        }
+    }
+}
+
+// La tare moyenne les HX711_TARE_SAMPLES conversions suivantes (taskHX711).
+void startTare() {
+    tareRawAcc = 0;
+    tareRawCount = 0;
+    tareInProgress = true;
+}
+
+// Interruption sur niveau bas (reveil du light sleep): masquee ici,
+// reactivee par taskHX711 une fois le bouton relache.
+void IRAM_ATTR onPrgButton() {
+    gpio_ll_intr_disable(&GPIO, (gpio_num_t)PRG_BUTTON_PIN);
+    prgIrqMasked = true;
+    if (hxCommandQueue == NULL) return;
+    HxCommand cmd;
+    cmd.type = HX_CMD_PRG_BUTTON;
+    cmd.flag = 0;
+    cmd.arg = 0;
+    cmd.value = 0.0f;
+    cmd.value2 = 0.0f;
+    BaseType_t woken = pdFALSE;
+    xQueueSendFromISR(hxCommandQueue, &cmd, &woken);
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void startRemoteCalibration(float knownMass) {
+    bool ok = false;
+    if (calibrationBaseReady) {
+        calibrationPending = true;
+        calibrationKnownMass = knownMass;
+        calibrationPendingSinceMs = millis();
+        calibrationLastDelta = 0.0f;
+        calibrationMaxDelta = 0.0f;
+        calibrationStableCount = 0;
+        ok = true;
+    } else {
+        // Fallback pour compatibilite dashboard existant (commande unique).
+        ok = performLegacyCalibrationWithMass(knownMass);
+    }
+    if (calibrationPending) {
+        Serial.print("Commande LoRa: CAL attente stabilisation masse=");
+        Serial.println(knownMass, 2);
+        return;
+    }
+    calibrationCommandWindowUntilMs = 0;
+    char ack[80];
+    if (ok) {
+        snprintf(ack, sizeof(ack), "ACK:%s:CAL:OK:%.2f", loraNodeId, knownMass);
+    } else {
+        snprintf(ack, sizeof(ack), "ACK:%s:CAL:ERR", loraNodeId);
+    }
+    envoyerPaquet(ack);
+}
+
+void handleHxCommand(const HxCommand& cmd) {
+    switch (cmd.type) {
+        case HX_CMD_TARE:
+            startTare();
+            break;
+        case HX_CMD_CAL_BASE:
+            calibrationBaseWeight = stableWeight;
+            calibrationBaseReady = true;
+            Serial.print("Base calib: ");
+            Serial.print(calibrationBaseWeight, 2);
+            Serial.println(" g");
+            break;
+        case HX_CMD_CAL_START:
+            {
+                calibrationBaseWeight = stableWeight;
+                calibrationBaseReady = true;
+                calibrationCommandWindowUntilMs = millis() + CALIBRATION_COMMAND_WINDOW_MS;
+                Serial.print("Commande LoRa: CAL_START base=");
+                Serial.println(calibrationBaseWeight, 2);
+                char ack[80];
+                snprintf(ack, sizeof(ack), "ACK:%s:CAL_START:OK:%.2f", loraNodeId, calibrationBaseWeight);
+                envoyerPaquet(ack);
+            }
+            break;
+        case HX_CMD_CAL_MASS:
+            performCalibrationWithMass(cmd.value);
+            break;
+        case HX_CMD_CAL_REMOTE:
+            startRemoteCalibration(cmd.value);
+            break;
+        case HX_CMD_ENV:
+            lastTempC = cmd.value;
+            lastHumPct = cmd.value2;
+            intervalStats.addEnv(cmd.value, cmd.value2, rtcNowMs());
+            break;
+        case HX_CMD_STATS_RESET:
+            intervalStats.reset();
+            break;
+        case HX_CMD_BATTERY:
+            batteryPercent = cmd.arg;
+            batteryChargingLikely = (cmd.flag != 0);
+            break;
+        case HX_CMD_RSSI:
+            lastRxRSSI = cmd.arg;
+            break;
+        case HX_CMD_SAVE_WARM:
+            saveWarmBootState();
+            xSemaphoreGive(warmSavedSem);
+            break;
+        case HX_CMD_PRG_BUTTON:
+            {
+                unsigned long now = millis();
+                if (now - prgLastPressMs < PRG_LOCKOUT_MS || digitalRead(PRG_BUTTON_PIN) != LOW) break;
+                prgLastPressMs = now;
+                if (!tareInProgress && !waitingKnownMass) {
+                    startTare();
+                    Serial.println("Tare lancee (bouton PRG)...");
+                    displayMessage("Tare...");
+                }
+            }
+            break;
+        default:
+            break;
+    }
 }
 
 // ===== Setup =====
 void taskHX711(void* parameter) {
     (void)parameter;
-    unsigned long lastRead = 0;
+    TrimmedBatchMean batch;
+    batch.reset();
+    unsigned long nextBatchMs = millis() + HX711_SAMPLE_PERIOD_MS;
     while (true) {
-        unsigned long now = millis();
+        // Attente bloquante: une commande ou l'echeance du prochain lot.
+        HxCommand cmd;
+        TickType_t waitTicks = 0;
+        long untilBatch = (long)(nextBatchMs - millis());
+        if (untilBatch > 0) waitTicks = pdMS_TO_TICKS(untilBatch);
+        bool publish = false;
+        if (xQueueReceive(hxCommandQueue, &cmd, waitTicks) == pdTRUE) {
+            handleHxCommand(cmd);
+            publish = true;
+            while (xQueueReceive(hxCommandQueue, &cmd, 0) == pdTRUE) {
+                handleHxCommand(cmd);
+            }
+        }
 
-        bool prgRaw = digitalRead(PRG_BUTTON_PIN);
-        if (prgRaw != prgLastRawState) {
-            prgLastRawState = prgRaw;
-            prgLastChangeMs = now;
+        if (prgIrqMasked && digitalRead(PRG_BUTTON_PIN) == HIGH) {
+            prgIrqMasked = false;
+            gpio_intr_enable((gpio_num_t)PRG_BUTTON_PIN);
         }
-        if ((now - prgLastChangeMs) > PRG_DEBOUNCE_MS && prgStableState != prgRaw) {
-            prgStableState = prgRaw;
-            if (prgStableState == LOW && !prgPressedLatched && !tareInProgress && !waitingKnownMass) {
-                if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-                    prgPressedLatched = true;
-                    LoadCell.tareNoDelay();
-                    tareInProgress = true;
-                    xSemaphoreGive(gDataMutex);
-                }
-                Serial.println("Tare lancee (bouton PRG)...");
-                displayMessage("Tare...");
-            } else if (prgStableState == HIGH) {
-                prgPressedLatched = false;
-            }
+
+        unsigned long now = millis();
+        if (calibrationCommandWindowUntilMs != 0 && (long)(now - calibrationCommandWindowUntilMs) >= 0) {
+            calibrationCommandWindowUntilMs = 0;
+            calibrationBaseReady = false;
+            publish = true;
         }
 
-        if (LoadCell.update() && (now - lastRead > 200)) {
-            bool freezeAutoZero = false;
-            if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-                freezeAutoZero = calibrationBaseReady || calibrationPending ||
-                                 (calibrationCommandWindowUntilMs != 0);
-                xSemaphoreGive(gDataMutex);
+        // Vidage du ring: toutes les conversions (10/80 SPS) alimentent le lot.
+        Hx711Sample smp;
+        while (hx711.pop(smp)) {
+            if (rawTraceEnabled) {
+                char traceLine[40];
+                snprintf(traceLine, sizeof(traceLine), "RAW,%lu,%.2f", (unsigned long)smp.tMs, rawToGrams(smp.raw));
+                Serial.println(traceLine);
             }
-
-            float rawWeight = LoadCell.getData();
-            float correctedRaw = rawWeight - softwareZeroOffset;
-            if (!freezeAutoZero && prevCorrectedRawReady) {
-                float d = fabs(correctedRaw - prevCorrectedRaw);
-                if (fabs(correctedRaw) <= AUTO_ZERO_WINDOW_G && d <= AUTO_ZERO_MAX_STEP_G) {
-                    softwareZeroOffset += AUTO_ZERO_ALPHA * correctedRaw;
-                    correctedRaw = rawWeight - softwareZeroOffset;
-                }
+            if (tareInProgress) {
+                tareRawAcc += smp.raw;
+                tareRawCount++;
+            } else {
+                batch.add(rawToGrams(smp.raw));
             }
-            prevCorrectedRaw = correctedRaw;
-            prevCorrectedRawReady = true;
+        }
+
+        if (tareInProgress && tareRawCount >= HX711_TARE_SAMPLES) {
+            tareInProgress = false;
+            tareOffset = (long)(tareRawAcc / tareRawCount);
+            saveTareOffset(tareOffset);
+            weightChain.reset();
+            telemetryFilter.reset();
+            batch.reset();
+            stableWeight = 0.0f;
+            lastWeight = 0.0f;
+            tareResidualPending = true;
+            tareResidualAcc = 0.0f;
+            tareResidualCount = 0;
+            tareEpoch++;
+            intervalStats.weight.reset();      // ancien zero: serie sans objet
+            publish = true;
+            Serial.println("Tare terminee");
+            displayMessage("Tare OK");
+        }
+
+        if ((long)(now - nextBatchMs) < 0) {
+            if (publish) publishSnapshot();
+            continue;
+        }
+        nextBatchMs += HX711_SAMPLE_PERIOD_MS;
+        if ((long)(now - nextBatchMs) >= 0) {
+            // Retard (calibration bloquante...): on se recale sans rattrapage.
+            nextBatchMs = now + HX711_SAMPLE_PERIOD_MS;
+        }
+
+        if (batch.count() > 0 && !tareInProgress) {
+            float rawWeight = batch.mean();
+            batch.reset();
+            bool freezeAutoZero = calibrationBaseReady || calibrationPending ||
+                                  (calibrationCommandWindowUntilMs != 0);
 
-            float medWeight = medianFilter(correctedRaw);
-            float filteredWeight = filterWeight(medWeight);
+            weightChain.stage<HIVE_STAGE_AUTO_ZERO>().setFrozen(freezeAutoZero);
+            stableWeight = weightChain.process(rawWeight);
+            float filteredWeight = weightChain.stage<HIVE_STAGE_EMA>().value();
+            // Moyenne du lot HX711 corrigee du zero, avant mediane et lissage.
+            float zeroedWeight = rawWeight - weightChain.stage<HIVE_STAGE_AUTO_ZERO>().offset();
 
             if (tareResidualPending) {
                 tareResidualAcc += filteredWeight;
                 tareResidualCount++;
                 if (tareResidualCount >= TARE_RESIDUAL_SAMPLES) {
                     float residual = tareResidualAcc / tareResidualCount;
-                    softwareZeroOffset += residual;
+                    weightChain.stage<HIVE_STAGE_AUTO_ZERO>().adjustOffset(residual);
                     tareResidualPending = false;
                     tareResidualAcc = 0.0f;
                     tareResidualCount = 0;
@@ -1126,137 +1924,97 @@ void taskHX711(void* parameter) {
                 }
             }
 
-            if (fabs(filteredWeight - stableWeight) >= DISPLAY_DEADBAND_G) {
-                if (pendingStableCount == 0 || fabs(filteredWeight - pendingStableCandidate) >= DISPLAY_DEADBAND_G) {
-                    pendingStableCandidate = filteredWeight;
-                    pendingStableCount = 1;
+            lastWeight = telemetryFilter.process(stableWeight);
+            // Statistiques sur la mesure non lissee, signee: la telemetrie
+            // (EMA, pente limitee) ecraserait min/max/ecart-type.
+            if (startupReady) intervalStats.addWeight(zeroedWeight, rtcNowMs());
+            pushStartupSample(stableWeight);
+            if (!startupReady && warmBoot && !warmHistoryDropped) {
+                // Reveil a chaud: quelques mesures coherentes avec l'etat restaure
+                // suffisent. Comparaison sur la moyenne brute: mediane et EMA
+                // restaurees contiennent encore les valeurs d'avant le sommeil.
+                if (fabs(zeroedWeight - warmState.stableWeight) <= WARM_BOOT_AGREE_BAND_G) {
+                    warmDisagreeCount = 0;
+                    warmAgreeCount++;
+                    if (warmAgreeCount >= WARM_BOOT_AGREE_SAMPLES) {
+                        startupReady = true;
+                        telemetryFilter.prime(stableWeight);
+                        Serial.println("Warm boot: mesures coherentes");
+                    }
                 } else {
-                    pendingStableCount++;
-                    if (pendingStableCount >= STABLE_CONFIRM_SAMPLES) {
-                        stableWeight = pendingStableCandidate;
-                        pendingStableCount = 0;
+                    warmAgreeCount = 0;
+                    warmDisagreeCount++;
+                    if (warmDisagreeCount >= WARM_BOOT_AGREE_SAMPLES) {
+                        dropWarmWeightHistory();
+                        Serial.println("Warm boot: poids change, filtres repartis a froid");
                     }
                 }
-            } else {
-                pendingStableCount = 0;
-            }
-            if (fabs(stableWeight) < ZERO_LOCK_G) {
-                stableWeight = 0.0f;
-            }
-
-            float txWeightFiltered = filterTelemetryWeight(stableWeight);
-            if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-                lastWeight = txWeightFiltered;
-                if (lastSentWeightReady && fabs(stableWeight - lastSentWeight) >= FAST_CHANGE_TRIGGER_G) {
-                    forceFastSend = true;
-                }
-                pushStartupSample(stableWeight);
-                if (!startupReady && (now - bootMs) > STARTUP_SETTLE_IGNORE_MS && isStartupStable()) {
-                    startupReady = true;
-                    telemetryWeight = stableWeight;
-                    telemetryWeightReady = true;
-                    Serial.println("Startup HX711 stable");
-                }
-                minuteWeightSum += (double)txWeightFiltered;
-                minuteWeightCount++;
-                xSemaphoreGive(gDataMutex);
+            } else if (!startupReady && (now - bootMs) > STARTUP_SETTLE_IGNORE_MS && isStartupStable()) {
+                startupReady = true;
+                telemetryFilter.prime(stableWeight);
+                Serial.println("Startup HX711 stable");
             }
 
             bool finishCalibration = false;
             bool calibrationOk = false;
             float calibrationMassLocal = 0.0f;
             float calibrationDeltaLocal = 0.0f;
-            if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-                if (calibrationPending && calibrationBaseReady) {
-                    float delta = fabs(stableWeight - calibrationBaseWeight);
-                    if (delta > calibrationMaxDelta) calibrationMaxDelta = delta;
-                    if (delta >= CALIBRATION_MIN_DELTA_G) {
-                        if (fabs(delta - calibrationLastDelta) <= CALIBRATION_STABLE_BAND_G) {
-                            calibrationStableCount++;
-                        } else {
-                            calibrationStableCount = 0;
-                        }
+            if (calibrationPending && calibrationBaseReady) {
+                float delta = fabs(stableWeight - calibrationBaseWeight);
+                if (delta > calibrationMaxDelta) calibrationMaxDelta = delta;
+                if (delta >= CALIBRATION_MIN_DELTA_G) {
+                    if (fabs(delta - calibrationLastDelta) <= CALIBRATION_STABLE_BAND_G) {
+                        calibrationStableCount++;
                     } else {
                         calibrationStableCount = 0;
                     }
-                    calibrationLastDelta = delta;
-
-                    if (calibrationStableCount >= CALIBRATION_STABLE_POLLS) {
-                        calibrationMassLocal = calibrationKnownMass;
-                        calibrationDeltaLocal = delta;
-                        calibrationPending = false;
-                        calibrationBaseReady = false;
-                        calibrationCommandWindowUntilMs = 0;
-                        finishCalibration = true;
-                        calibrationOk = true;
-                    } else if ((millis() - calibrationPendingSinceMs) >= CALIBRATION_WAIT_TIMEOUT_MS) {
-                        calibrationMassLocal = calibrationKnownMass;
-                        calibrationDeltaLocal = calibrationMaxDelta;
-                        calibrationPending = false;
-                        calibrationBaseReady = false;
-                        calibrationCommandWindowUntilMs = 0;
-                        finishCalibration = true;
-                        calibrationOk = false;
-                    }
+                } else {
+                    calibrationStableCount = 0;
+                }
+                calibrationLastDelta = delta;
+
+                if (calibrationStableCount >= CALIBRATION_STABLE_POLLS) {
+                    calibrationMassLocal = calibrationKnownMass;
+                    calibrationDeltaLocal = delta;
+                    calibrationPending = false;
+                    calibrationBaseReady = false;
+                    calibrationCommandWindowUntilMs = 0;
+                    finishCalibration = true;
+                    calibrationOk = true;
+                } else if ((millis() - calibrationPendingSinceMs) >= CALIBRATION_WAIT_TIMEOUT_MS) {
+                    calibrationMassLocal = calibrationKnownMass;
+                    calibrationDeltaLocal = calibrationMaxDelta;
+                    calibrationPending = false;
+                    calibrationBaseReady = false;
+                    calibrationCommandWindowUntilMs = 0;
+                    finishCalibration = true;
+                    calibrationOk = false;
                 }
-                xSemaphoreGive(gDataMutex);
             }
             if (finishCalibration) {
                 char ack[80];
                 if (calibrationOk && calibrationDeltaLocal >= CALIBRATION_MIN_DELTA_G &&
                     applyCalibrationDelta(calibrationMassLocal, calibrationDeltaLocal)) {
-                    snprintf(ack, sizeof(ack), "ACK:%s:CAL:OK:%.2f", LORA_NODE_ID, calibrationMassLocal);
+                    snprintf(ack, sizeof(ack), "ACK:%s:CAL:OK:%.2f", loraNodeId, calibrationMassLocal);
                 } else {
                     if (calibrationDeltaLocal < CALIBRATION_MIN_DELTA_G) {
                         Serial.println("Calib KO: delta trop faible");
                         displayMessage("Calib KO", "Delta trop faible");
-                        snprintf(ack, sizeof(ack), "ACK:%s:CAL:ERR:TIMEOUT", LORA_NODE_ID);
+                        snprintf(ack, sizeof(ack), "ACK:%s:CAL:ERR:TIMEOUT", loraNodeId);
                     } else {
                         Serial.println("Calib KO: facteur invalide");
                         displayMessage("Calib KO", "Facteur invalide");
-                        snprintf(ack, sizeof(ack), "ACK:%s:CAL:ERR", LORA_NODE_ID);
+                        snprintf(ack, sizeof(ack), "ACK:%s:CAL:ERR", loraNodeId);
                     }
                 }
                 envoyerPaquet(ack);
             }
-            lastRead = now;
+            publish = true;
         }
 
-        if (tareInProgress && LoadCell.getTareStatus()) {
-            if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-                tareInProgress = false;
-                saveTareOffset(LoadCell.getTareOffset());
-                filterIndex = 0;
-                filterCount = 0;
-                emaWeight = 0.0f;
-                emaReady = false;
-                stableWeight = 0.0f;
-                jumpStreak = 0;
-                lastWeight = 0.0f;
-                softwareZeroOffset = 0.0f;
-                prevCorrectedRaw = 0.0f;
-                prevCorrectedRawReady = false;
-                medianIndex = 0;
-                medianCount = 0;
-                pendingStableCandidate = 0.0f;
-                pendingStableCount = 0;
-                minuteWeightSum = 0.0;
-                minuteWeightCount = 0;
-                telemetryWeight = 0.0f;
-                telemetryWeightReady = false;
-                tareResidualPending = true;
-                tareResidualAcc = 0.0f;
-                tareResidualCount = 0;
-                lastSentWeight = 0.0f;
-                lastSentWeightReady = false;
-                forceFastSend = false;
-                xSemaphoreGive(gDataMutex);
-            }
-            Serial.println("Tare terminee");
-            displayMessage("Tare OK");
+        if (publish) {
+            publishSnapshot();
         }
-
-        vTaskDelay(pdMS_TO_TICKS(1));
     }
 }
 
@@ -1271,104 +2029,176 @@ void taskDht(void* parameter) {
 
 void taskLoRa(void* parameter) {
     (void)parameter;
+    uint8_t seenTareEpoch = 0;
     while (true) {
+        // Aucune attente active: DIO1, taskHX711 ou le timer d'echeance reveillent la tache.
+        xTaskNotifyWait(0, UINT32_MAX, NULL, portMAX_DELAY);
         unsigned long now = millis();
 
-        if (loraRxFlag) {
-            loraRxFlag = false;
-            char incoming[128];
-            memset(incoming, 0, sizeof(incoming));
-            int state = radio.readData((uint8_t*)incoming, sizeof(incoming) - 1);
-            if (state == RADIOLIB_ERR_NONE) {
-                int16_t rssi = radio.getRSSI();
-                if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-                    lastRxRSSI = rssi;
-                    xSemaphoreGive(gDataMutex);
-                }
-                Serial.print("LoRa RX: ");
-                Serial.println(incoming);
-                handleLoRaCommand(incoming);
-            }
-            radioReceiveMode = false;
-            beginLoRaReceive();
+        if (loraDio1Flag && radioTxBusy) {
+            loraDio1Flag = false;
+            completeFrameTransmit(true);
+        } else if (radioTxTimedOut(now)) {
+            completeFrameTransmit(false);
+        }
+        if (loraDio1Flag) {
+            loraDio1Flag = false;
+            handleLoRaRx();
         }
 
-        bool doSend = false;
-        bool calibrationWindowActive = false;
-        bool startupReadyLocal = false;
-        bool forceFastSendLocal = false;
-        float sendWeight = 0.0f;
-        float tempLocal = NAN;
-        float humLocal = NAN;
-        int batteryPercentLocal = -1;
-
-        if (gDataMutex != NULL && xSemaphoreTake(gDataMutex, portMAX_DELAY) == pdTRUE) {
-            if (calibrationCommandWindowUntilMs != 0 && (long)(now - calibrationCommandWindowUntilMs) >= 0) {
-                calibrationCommandWindowUntilMs = 0;
-                calibrationBaseReady = false;
-            }
-            calibrationWindowActive = (calibrationCommandWindowUntilMs != 0);
-            forceFastSendLocal = forceFastSend;
-            startupReadyLocal = startupReady;
-            if (!calibrationWindowActive && (forceFastSend || (now - previousMillis >= interval))) {
-                doSend = true;
-                sendWeight = lastWeight;
-                tempLocal = lastTempC;
-                humLocal = lastHumPct;
-                batteryPercentLocal = batteryPercent;
-                minuteWeightSum = 0.0;
-                minuteWeightCount = 0;
-                forceFastSend = false;
-                lastSentWeight = sendWeight;
-                lastSentWeightReady = true;
-                previousMillis = now;
-            }
-            xSemaphoreGive(gDataMutex);
+        MeasurementSnapshot snap;
+        measurementSnapshot.read(snap);
+        if (snap.tareEpoch != seenTareEpoch) {
+            // Tare terminee: l'ancienne reference d'envoi n'a plus de sens.
+            seenTareEpoch = snap.tareEpoch;
+            lastSentWeightReady = false;
+            reportPolicy.invalidate();
+        }
+        bool calibrationWindowActive = (snap.flags & SNAP_CAL_WINDOW) != 0;
+        bool startupReadyLocal = (snap.flags & SNAP_STARTUP_READY) != 0;
+        bool forceFastSendLocal = lastSentWeightReady &&
+                                  fabs(snap.stableWeightG - lastSentWeight) >= FAST_CHANGE_TRIGGER_G;
+        bool lowPowerPending = LOW_POWER_MODE && !lowPowerFrameSent && !isUsbSerialActive();
+        // Low power: envoi des la fin de la fenetre de mesure (ou des que le
+        // reveil a chaud a confirme la mesure), puis deep sleep.
+        bool lowPowerDue = lowPowerPending &&
+                           ((now - bootMs) >= LOW_POWER_ACTIVE_WINDOW_MS || (warmBoot && startupReadyLocal));
+        float sendWeight = snap.weightG;
+        float tempLocal = snap.tempC;
+        float humLocal = snap.humPct;
+        int batteryPercentLocal = snap.batteryPercent;
+        bool chargingLocal = (snap.flags & SNAP_CHARGING) != 0;
+        // Envoi periodique seulement si une valeur a quitte sa bande autour
+        // du dernier ACK, ou pour le battement de garde.
+        ReportValues reportValues = makeReportValues(fabs(sendWeight), tempLocal, humLocal, batteryPercentLocal);
+        ReportDecision decision = reportPolicy.decide(reportValues, reportNowMs());
+        bool periodicDue = (now - previousMillis >= interval);
+        bool doSend = !calibrationWindowActive &&
+                      (forceFastSendLocal || lowPowerDue || (periodicDue && decision != REPORT_SKIP));
+        if (!doSend && periodicDue && !calibrationWindowActive && !lowPowerPending) {
+            Serial.println("Envoi saute: valeurs inchangees depuis le dernier ACK");
+            previousMillis = now;
+        }
+        if (doSend) {
+            // Reference du declenchement rapide: la valeur stable, pas la
+            // telemetrie lissee (en retard apres une marche, elle redeclenchait
+            // un envoi a chaque echantillon).
+            lastSentWeight = snap.stableWeightG;
+            lastSentWeightReady = true;
+            previousMillis = now;
+        }
+
+        if (doSend && !startupReadyLocal && (now - bootMs) < STARTUP_FORCE_SEND_MS) {
+            // Mesure pas encore stable: envoi saute, reveil sur startupReady ou echeance.
+            doSend = false;
         }
 
         if (doSend) {
-            if (!startupReadyLocal && (now - bootMs) < STARTUP_FORCE_SEND_MS) {
-                vTaskDelay(pdMS_TO_TICKS(5));
-                continue;
-            }
-            char poidsMsg[96];
-            if (!isnan(tempLocal) && !isnan(humLocal) && batteryPercentLocal >= 0) {
-                snprintf(poidsMsg, sizeof(poidsMsg), "POIDS_G:%.2f,T_C:%.1f,H_P:%.0f,B_P:%d",
-                         fabs(sendWeight), tempLocal, humLocal, batteryPercentLocal);
-            } else if (!isnan(tempLocal) && !isnan(humLocal)) {
-                snprintf(poidsMsg, sizeof(poidsMsg), "POIDS_G:%.2f,T_C:%.1f,H_P:%.0f",
-                         fabs(sendWeight), tempLocal, humLocal);
-            } else if (batteryPercentLocal >= 0) {
-                snprintf(poidsMsg, sizeof(poidsMsg), "POIDS_G:%.2f,B_P:%d",
-                         fabs(sendWeight), batteryPercentLocal);
-            } else {
-                snprintf(poidsMsg, sizeof(poidsMsg), "POIDS_G:%.2f", fabs(sendWeight));
-            }
-            envoyerPaquet(poidsMsg);
+            uint8_t flags = 0;
+            if (!startupReadyLocal) flags |= RUCHE_FLAG_NOT_STABLE;
+            if (chargingLocal) flags |= RUCHE_FLAG_CHARGING;
 
             if (LOW_POWER_MODE && !lowPowerFrameSent && !isUsbSerialActive()) {
+                // Low power: la mesure rejoint le lot RTC, envoye tous les
+                // LOW_POWER_BATCH_WAKES reveils ou tout de suite si le poids a bouge.
                 lowPowerFrameSent = true;
-                Serial.println("Low power: trame envoyee, passage en deep sleep");
+                float weightAbs = fabs(sendWeight);
+                bool fastChange = forceFastSendLocal ||
+                                  (lpLastSentWeightReady && fabs(weightAbs - lpLastSentWeight) >= FAST_CHANGE_TRIGGER_G);
+                bool heartbeat = !fastChange && decision == REPORT_HEARTBEAT;
+                if (fastChange) flags |= RUCHE_FLAG_FAST_CHANGE;
+                if (heartbeat) flags |= RUCHE_FLAG_HEARTBEAT;
+                if (!fastChange && decision == REPORT_SKIP) {
+                    // Rien de neuf depuis le dernier ACK: mesure non gardee.
+                    Serial.println("Low power: valeurs inchangees, pas d'envoi");
+                } else {
+                    pushLowPowerSample(weightAbs, tempLocal, humLocal);
+                    // Reveils espaces la nuit: le lot ne doit pas attendre plus
+                    // qu'un battement de garde.
+                    bool batchTooOld = lowPowerOldestAgeMs() >= StandardReportParams::heartbeatMs;
+                    if (fastChange || heartbeat || batchTooOld || lpSampleCount >= LOW_POWER_BATCH_WAKES) {
+                        flushLowPowerBatch(batteryPercentLocal, flags, snap.stats);
+                    } else {
+                        Serial.print("Low power: mesure en attente ");
+                        Serial.print(lpSampleCount);
+                        Serial.print("/");
+                        Serial.println(LOW_POWER_BATCH_WAKES);
+                    }
+                }
+                // ACK de commandes (y compris recues pendant l'ecoute de l'ACK).
+                flushControlTxBlocking();
+                sleepScheduler.observe(weightAbs, tempLocal, lastSleepS + (uint32_t)(millis() / 1000UL));
+                uint32_t sleepS = sleepScheduler.nextSleepS(batteryPercentLocal);
+                // Reveil cale sur le creneau TDMA (quelques secondes d'ecart).
+                uint32_t sleepMs = tdmaClock.alignedSleepMs(rtcNowMs() + 50, sleepS * 1000UL, TDMA_WAKE_LEAD_MS);
+                char sleepLine[112];
+                snprintf(sleepLine, sizeof(sleepLine), "Low power: deep sleep %lu ms (activite %.1f g, butinage %s, creneau %u)",
+                         (unsigned long)sleepMs, sleepScheduler.activityG(), sleepScheduler.foraging() ? "oui" : "non",
+                         (unsigned)tdmaClock.slot);
+                Serial.println(sleepLine);
                 vTaskDelay(pdMS_TO_TICKS(50));
-                enterDeepSleep();
+                enterDeepSleep(sleepMs);
             }
-        }
 
-        if (LOW_POWER_MODE && !lowPowerFrameSent && !isUsbSerialActive() && (now - bootMs) >= LOW_POWER_ACTIVE_WINDOW_MS) {
-            previousMillis = now - interval;
+            if (forceFastSendLocal) {
+                flags |= RUCHE_FLAG_FAST_CHANGE;
+            } else if (decision == REPORT_HEARTBEAT) {
+                flags |= RUCHE_FLAG_HEARTBEAT;
+            }
+            noteMissedReportAck();
+            if (isDefaultRadioProfile()) flags |= RUCHE_FLAG_ADR_DEFAULT;
+            if (!frameSeqAcked) flags |= RUCHE_FLAG_SEQ_RESET;
+            // Pas de deep sleep: le recepteur peut envoyer ses commandes sans attendre.
+            flags |= RUCHE_FLAG_RX_ALWAYS;
+            RucheTelemetry tm;
+            tm.nodeId = loraNodeNum;
+            tm.seq = frameSeq++;
+            tm.weightG = fabs(sendWeight);
+            tm.tempC = tempLocal;
+            tm.humPct = humLocal;
+            tm.battPct = batteryPercentLocal;
+            tm.flags = flags | fillFrameStats(snap.stats, tm.stats);
+            uint8_t frame[RUCHE_TELEMETRY_MAX_BYTES];
+            size_t frameLen = rucheEncodeTelemetry(tm, frame, sizeof(frame));
+            if (envoyerTrame(frame, frameLen)) {
+                postHxCommand(HX_CMD_STATS_RESET);
+                reportPolicy.onSent(tm.seq, reportValues);
+            }
         }
 
-        if (forceFastSendLocal) {
-            vTaskDelay(pdMS_TO_TICKS(1));
-        } else {
-            vTaskDelay(pdMS_TO_TICKS(5));
+        startNextTransmit();
+
+        // Prochaine echeance: envoi periodique, fin de fenetre low power,
+        // envoi force au demarrage, garde-fou d'emission.
+        unsigned long deadline = 0;
+        bool hasDeadline = false;
+        keepEarliestDeadline(now, previousMillis + interval, deadline, hasDeadline);
+        if (radioTxBusy) {
+            keepEarliestDeadline(now, radioTxStartMs + radioTxTimeoutMs, deadline, hasDeadline);
         }
+        if (lowPowerPending) {
+            keepEarliestDeadline(now, bootMs + LOW_POWER_ACTIVE_WINDOW_MS, deadline, hasDeadline);
+            keepEarliestDeadline(now, bootMs + STARTUP_FORCE_SEND_MS, deadline, hasDeadline);
+        }
+        armLoRaDeadline(now, deadline, hasDeadline);
     }
 }
 
+void initNodeIdentity() {
+    loraNodeNum = (RUCHE_NODE_NUM != 0) ? (uint16_t)RUCHE_NODE_NUM : rucheNodeIdFromMac(ESP.getEfuseMac());
+    rucheFormatNodeName(loraNodeNum, loraNodeId, sizeof(loraNodeId));
+}
+
 void setup() {
     Serial.begin(115200);
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    displayTaskHandle = xTaskGetCurrentTaskHandle();
+    initNodeIdentity();
+    warmBoot = LOW_POWER_MODE &&
+               esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER &&
+               warmState.magic == WARM_BOOT_MAGIC;
+    if (!warmBoot) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
     dht.begin();
     pinMode(BAT_ADC_EN_PIN, OUTPUT);
     digitalWrite(BAT_ADC_EN_PIN, HIGH);
@@ -1380,17 +2210,24 @@ void setup() {
     Serial.println("\n================================");
     Serial.println("BALANCE LORA - RADIOLIB V2");
     Serial.println("================================\n");
+    Serial.print("Noeud: ");
+    Serial.print(loraNodeId);
+    Serial.println((RUCHE_NODE_NUM != 0) ? " (config)" : " (adresse MAC)");
     if (LOW_POWER_MODE) {
-        Serial.println("Mode: LOW POWER");
+        Serial.println(warmBoot ? "Mode: LOW POWER (reveil a chaud)" : "Mode: LOW POWER");
         if (isUsbSerialActive()) {
             Serial.println("USB detecte: deep sleep suspendu");
         }
     }
 
-    oled_working = initOLED();
-    vTaskDelay(pdMS_TO_TICKS(500));
+    // Reveil a chaud sur batterie: pas d'ecran (VEXT coupe) ni de temporisations.
+    bool fastPath = warmBoot && !isUsbSerialActive();
+    if (!fastPath) {
+        oled_working = initOLED();
+        vTaskDelay(pdMS_TO_TICKS(500));
+    }
 
-    if (!initHX711()) {
+    if (!initHX711(warmBoot)) {
         Serial.println("ERREUR HX711");
         displayMessage("ERREUR HX711", "Verifiez cablage");
         while(1) {
@@ -1400,7 +2237,12 @@ void setup() {
             vTaskDelay(pdMS_TO_TICKS(200));
         }
     }
-    vTaskDelay(pdMS_TO_TICKS(500));
+    if (warmBoot) {
+        restoreWarmBootState();
+    }
+    if (!fastPath) {
+        vTaskDelay(pdMS_TO_TICKS(500));
+    }
 
     if (!initLoRa()) {
         Serial.println("ERREUR LORA");
@@ -1412,27 +2254,51 @@ void setup() {
             vTaskDelay(pdMS_TO_TICKS(100));
         }
     }
-    vTaskDelay(pdMS_TO_TICKS(500));
+    if (!fastPath) {
+        vTaskDelay(pdMS_TO_TICKS(500));
+    }
 
     Serial.println("\n=== PRET ===");
     Serial.println("t=tare, c=calibrage, x=test envoi, h=aide");
     Serial.println("============================\n");
     displayMessage("PRET", "Attente...");
 
+    publishSnapshot();
+    hxCommandQueue = xQueueCreate(HX_COMMAND_QUEUE_LEN, sizeof(HxCommand));
+    warmSavedSem = xSemaphoreCreateBinary();
+    loraTxControlQueue = xQueueCreate(LORA_TX_CONTROL_QUEUE_LEN, sizeof(LoraTxFrame));
+    loraTxTelemetrySlot = xQueueCreate(1, sizeof(LoraTxFrame));
+    oledMessageSlot = xQueueCreate(1, sizeof(OledMessage));
+    oledShownSem = xSemaphoreCreateBinary();
+    if (hxCommandQueue == NULL || warmSavedSem == NULL ||
+        loraTxControlQueue == NULL || loraTxTelemetrySlot == NULL ||
+        oledMessageSlot == NULL || oledShownSem == NULL) {
+        Serial.println("ERREUR file commandes");
+        while (true) {
+            vTaskDelay(pdMS_TO_TICKS(1000));
+        }
+    }
+    attachInterrupt(digitalPinToInterrupt(PRG_BUTTON_PIN), onPrgButton, ONLOW);
+
     if (!LOW_POWER_MODE) {
         vTaskDelay(pdMS_TO_TICKS(2000));
-        envoyerPaquet("DEMARRAGE");
+        envoyerPaquet("DEMARRAGE");   // part au premier passage de taskLoRa
     }
 
-    gDataMutex = xSemaphoreCreateMutex();
-    if (gDataMutex == NULL) {
-        Serial.println("ERREUR mutex");
+    loraDeadlineTimer = xTimerCreate("lora_deadline", pdMS_TO_TICKS(interval), pdFALSE, NULL, onLoraDeadline);
+    if (loraDeadlineTimer == NULL) {
+        Serial.println("ERREUR timer LoRa");
         while (true) {
             vTaskDelay(pdMS_TO_TICKS(1000));
         }
     }
+    if (!LOW_POWER_MODE || isUsbSerialActive()) {
+        configureAutoLightSleep();
+    }
 
     xTaskCreatePinnedToCore(taskLoRa, "task_lora", 8192, NULL, 4, &loraTaskHandle, 1);
+    // Premier passage immediat (etat initial, echeances).
+    xTaskNotify(loraTaskHandle, LORA_EVT_DEADLINE, eSetBits);
     xTaskCreatePinnedToCore(taskHX711, "task_hx711", 6144, NULL, 3, &hxTaskHandle, 1);
     xTaskCreatePinnedToCore(taskDht, "task_dht11", 4096, NULL, 2, &dhtTaskHandle, 1);
 }
@@ -1454,9 +2320,21 @@ void loop() {
     }
 
     unsigned long now = millis();
-    if (now - lastDisplay > 500) {
+    OledMessage msg;
+    if (xQueueReceive(oledMessageSlot, &msg, 0) == pdTRUE) {
+        // Message garde un rafraichissement complet avant le tableau de bord.
+        drawMessage(msg);
+        if (msg.notifyShown) {
+            oledRenderer.flushAndWait(OLED_SLEEP_FLUSH_TIMEOUT_MS);
+            xSemaphoreGive(oledShownSem);
+        }
+        lastDisplay = now;
+    } else if (now - lastDisplay > DISPLAY_REFRESH_MS) {
         lastDisplay = now;
         updateDisplay();
+    } else if (oled_working) {
+        // Zones laissees marquees par un flush() refuse (envoi en cours).
+        oledRenderer.flush();
     }
 
     vTaskDelay(pdMS_TO_TICKS(10));
@@ -14,8 +14,14 @@ const TLS_PFX_PATH = process.env.TLS_PFX_PATH || path.join(__dirname, "cert", "r
 const TLS_PFX_PASSPHRASE = process.env.TLS_PFX_PASSPHRASE || "ruche-dashboard";
 const MQTT_URL = process.env.MQTT_URL || "mqtt://broker.hivemq.com:1883";
 const MQTT_TOPIC = process.env.MQTT_TOPIC || "ruches/telemetry";
+// Le recepteur publie une sous-rubrique par ruche (ruches/telemetry/RUCHE12).
+// DASH_NODE limite le tableau de bord (et les commandes) a une ruche.
+const DASH_NODE = process.env.DASH_NODE || "";
+const MQTT_TOPIC_NODES = `${MQTT_TOPIC}/${DASH_NODE || "+"}`;
 const MQTT_TOPIC_COMMAND = process.env.MQTT_TOPIC_COMMAND || "ruches/command";
 const MQTT_TOPIC_ACK = process.env.MQTT_TOPIC_ACK || "ruches/ack";
+// Lots MessagePack de plusieurs ruches (recepteur compile avec MQTT_UPLINK_MSGPACK).
+const MQTT_TOPIC_BATCH = process.env.MQTT_TOPIC_BATCH || "ruches/batch";
 const HISTORY_LIMIT = Number(process.env.HISTORY_LIMIT || 2000);
 const DB_PATH = process.env.SQLITE_PATH || path.join(__dirname, "data", "history.sqlite3");
 const DATABASE_URL = process.env.DATABASE_URL || "";
@@ -64,7 +70,8 @@ app.use(express.static("public"));
 app.get("/api/status", (_req, res) => {
   res.json({
     mqtt_url: MQTT_URL,
-    topic: MQTT_TOPIC,
+    topic: MQTT_TOPIC_NODES,
+    node: DASH_NODE || null,
     topic_command: MQTT_TOPIC_COMMAND,
     topic_ack: MQTT_TOPIC_ACK,
     db_backend: usePostgres ? "postgres" : "sqlite",
@@ -95,12 +102,15 @@ app.post("/api/command", (req, res) => {
   if (!mqttClient.connected) {
     return res.status(503).json({ ok: false, error: "mqtt deconnecte" });
   }
+  // Sans cible, le recepteur envoie au dernier noeud entendu.
+  const node = DASH_NODE || (state.last && state.last.node) || "";
+  if (node) payload = `${node}:${payload}`;
 
   mqttClient.publish(MQTT_TOPIC_COMMAND, payload, { qos: 0, retain: false }, (err) => {
     if (err) {
       return res.status(500).json({ ok: false, error: err.message });
     }
-    return res.json({ ok: true, topic: MQTT_TOPIC_COMMAND, payload });
+    return res.json({ ok: true, topic: MQTT_TOPIC_COMMAND, payload, node: node || null });
   });
 });
 
@@ -144,12 +154,15 @@ function sanitizeTelemetry(payload) {
   const packet = Number(payload.packet);
   const alertSignalLost = Number(payload.alert_signal_lost);
   const alertBattLow = Number(payload.alert_batt_low);
+  const ageS = Number(payload.age_s);
 
   if (!Number.isFinite(weight)) return null;
 
   return {
-    ts: nowIso(),
+    // Les mesures groupees arrivent en retard: age_s les remet a leur date reelle.
+    ts: Number.isFinite(ageS) && ageS > 0 ? new Date(Date.now() - ageS * 1000).toISOString() : nowIso(),
     packet: Number.isFinite(packet) ? packet : null,
+    node: typeof payload.node === "string" ? payload.node : null,
     weight_g: weight,
     temp_c: Number.isFinite(temp) ? temp : null,
     hum_pct: Number.isFinite(hum) ? hum : null,
@@ -161,6 +174,83 @@ function sanitizeTelemetry(payload) {
   };
 }
 
+// Decodeur MessagePack minimal: types emis par le recepteur (nil, bool,
+// entiers, float32/64, chaines, tableaux, maps).
+function decodeMsgPack(buf) {
+  let pos = 0;
+  const need = (n) => {
+    if (pos + n > buf.length) throw new Error("msgpack tronque");
+  };
+  const str = (n) => {
+    need(n);
+    const s = buf.toString("utf8", pos, pos + n);
+    pos += n;
+    return s;
+  };
+  const arr = (n) => {
+    const out = new Array(n);
+    for (let i = 0; i < n; i++) out[i] = read();
+    return out;
+  };
+  const map = (n) => {
+    const out = {};
+    for (let i = 0; i < n; i++) {
+      const k = read();
+      out[k] = read();
+    }
+    return out;
+  };
+  function read() {
+    need(1);
+    const b = buf[pos++];
+    if (b <= 0x7f) return b;
+    if (b >= 0xe0) return b - 0x100;
+    if ((b & 0xf0) === 0x80) return map(b & 0x0f);
+    if ((b & 0xf0) === 0x90) return arr(b & 0x0f);
+    if ((b & 0xe0) === 0xa0) return str(b & 0x1f);
+    let v;
+    switch (b) {
+      case 0xc0: return null;
+      case 0xc2: return false;
+      case 0xc3: return true;
+      case 0xca: need(4); v = buf.readFloatBE(pos); pos += 4; return v;
+      case 0xcb: need(8); v = buf.readDoubleBE(pos); pos += 8; return v;
+      case 0xcc: need(1); return buf[pos++];
+      case 0xcd: need(2); v = buf.readUInt16BE(pos); pos += 2; return v;
+      case 0xce: need(4); v = buf.readUInt32BE(pos); pos += 4; return v;
+      case 0xd0: need(1); v = buf.readInt8(pos); pos += 1; return v;
+      case 0xd1: need(2); v = buf.readInt16BE(pos); pos += 2; return v;
+      case 0xd2: need(4); v = buf.readInt32BE(pos); pos += 4; return v;
+      case 0xd9: need(1); return str(buf[pos++]);
+      case 0xda: need(2); v = buf.readUInt16BE(pos); pos += 2; return str(v);
+      case 0xdc: need(2); v = buf.readUInt16BE(pos); pos += 2; return arr(v);
+      case 0xdd: need(4); v = buf.readUInt32BE(pos); pos += 4; return arr(v);
+      case 0xde: need(2); v = buf.readUInt16BE(pos); pos += 2; return map(v);
+      case 0xdf: need(4); v = buf.readUInt32BE(pos); pos += 4; return map(v);
+      default: throw new Error(`msgpack type 0x${b.toString(16)} non gere`);
+    }
+  }
+  return read();
+}
+
+// {"v":1,"replay":b,"k":[colonnes],"r":[[valeurs],...]} -> objets au format
+// JSON par mesure (nil = champ absent).
+function unpackTelemetryBatch(buffer) {
+  const batch = decodeMsgPack(buffer);
+  if (!batch || batch.v !== 1 || !Array.isArray(batch.k) || !Array.isArray(batch.r)) return [];
+  return batch.r.map((values) => {
+    const payload = { replay: batch.replay ? 1 : 0 };
+    batch.k.forEach((key, i) => {
+      const v = Array.isArray(values) ? values[i] : undefined;
+      if (v === null || v === undefined) return;
+      // float32: arrondi au centieme, comme le JSON.
+      payload[key] = typeof v === "number" && !Number.isInteger(v) ? Math.round(v * 100) / 100 : v;
+    });
+    if (Number.isFinite(payload.node_id)) payload.node = `RUCHE${payload.node_id}`;
+    return payload;
+  });
+}
+
 function normalizeRows(rows) {
   return rows.map((r) => ({
     ts: r.ts,
@@ -294,11 +384,18 @@ const mqttClient = mqtt.connect(MQTT_URL, {
 
 mqttClient.on("connect", () => {
   console.log(`[MQTT] Connecte: ${MQTT_URL}`);
-  mqttClient.subscribe(MQTT_TOPIC, (err) => {
+  mqttClient.subscribe(MQTT_TOPIC_NODES, (err) => {
     if (err) {
       console.error("[MQTT] Erreur subscribe:", err.message);
     } else {
-      console.log(`[MQTT] Abonne: ${MQTT_TOPIC}`);
+      console.log(`[MQTT] Abonne: ${MQTT_TOPIC_NODES}`);
+    }
+  });
+  mqttClient.subscribe(MQTT_TOPIC_BATCH, (err) => {
+    if (err) {
+      console.error("[MQTT] Erreur subscribe lots:", err.message);
+    } else {
+      console.log(`[MQTT] Abonne: ${MQTT_TOPIC_BATCH}`);
     }
   });
   mqttClient.subscribe(MQTT_TOPIC_ACK, (err) => {
@@ -314,6 +411,25 @@ mqttClient.on("error", (err) => {
   console.error("[MQTT] Erreur:", err.message);
 });
 
+function ingestTelemetry(payload) {
+  const row = sanitizeTelemetry(payload);
+  if (!row) return;
+
+  // Rejeu du stockage differe de la passerelle: ne masque pas une mesure plus recente.
+  if (!payload.replay || !state.last || row.ts >= state.last.ts) {
+    state.last = row;
+  }
+  state.history.push(row);
+  if (state.history.length > HISTORY_LIMIT) {
+    state.history.splice(0, state.history.length - HISTORY_LIMIT);
+  }
+  saveTelemetry(row).catch((err) => {
+    console.error("[DB] Erreur sauvegarde:", err.message);
+  });
+
+  io.emit("telemetry", row);
+}
+
 mqttClient.on("message", (topic, buffer) => {
   if (topic === MQTT_TOPIC_ACK) {
     state.lastAck = {
@@ -324,25 +440,27 @@ mqttClient.on("message", (topic, buffer) => {
     return;
   }
 
+  if (topic === MQTT_TOPIC_BATCH) {
+    let payloads;
+    try {
+      payloads = unpackTelemetryBatch(buffer);
+    } catch (err) {
+      console.error("[MQTT] Lot invalide:", err.message);
+      return;
+    }
+    payloads
+      .filter((p) => !DASH_NODE || p.node === DASH_NODE)
+      .forEach(ingestTelemetry);
+    return;
+  }
+
   let payload;
   try {
     payload = JSON.parse(buffer.toString("utf8"));
   } catch (_e) {
     return;
   }
-  const row = sanitizeTelemetry(payload);
-  if (!row) return;
-
-  state.last = row;
-  state.history.push(row);
-  if (state.history.length > HISTORY_LIMIT) {
-    state.history.splice(0, state.history.length - HISTORY_LIMIT);
-  }
-  saveTelemetry(row).catch((err) => {
-    console.error("[DB] Erreur sauvegarde:", err.message);
-  });
-
-  io.emit("telemetry", row);
+  ingestTelemetry(payload);
 });
 
 io.on("connection", (socket) => {
@@ -13,6 +13,22 @@
 #include <Arduino_ConnectionHandler.h>
 #include <PubSubClient.h>
 #include <esp_task_wdt.h>
+#include <esp_timer.h>
+#include <LittleFS.h>
+#include <time.h>
+#include <RucheFrame.h>
+#include <RucheAdr.h>
+#include <RucheNodeTable.h>
+#include <RucheTdma.h>
+#include <RucheSeqTracker.h>
+#include <RucheText.h>
+#include <RucheLiveness.h>
+#include <RucheTimerWheel.h>
+#include <SpscRing.h>
+#include <RecordRing.h>
+#include <TokenBucket.h>
+#include <MsgPackWriter.h>
+#include <OledRenderer.h>
 
 #ifndef WIFI_SSID_VALUE
 #define WIFI_SSID_VALUE ""
@@ -30,6 +46,12 @@
 #define DEVICE_KEY_VALUE ""
 #endif
 
+// 1: telemetrie en lots MessagePack de plusieurs ruches (MQTT_TOPIC_BATCH)
+// au lieu d'un JSON retenu par mesure.
+#ifndef MQTT_UPLINK_MSGPACK
+#define MQTT_UPLINK_MSGPACK 0
+#endif
+
 // ===== Configuration OLED =====
 #define OLED_SDA   17
 #define OLED_SCL   18
@@ -39,6 +61,20 @@
 #define SCREEN_HEIGHT 64
 #define OLED_ADDR     0x3C
 Adafruit_SSD1306 oled(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RST);
+// Envoi I2C par task_oled: seules les zones modifiees partent, sans
+// bloquer loop() pendant le transfert.
+OledRenderer oledRenderer(oled, OLED_ADDR);
+const UBaseType_t OLED_TASK_PRIORITY = 1;
+enum OledScreen { OLED_SCREEN_NONE, OLED_SCREEN_WAITING, OLED_SCREEN_NODE };
+OledScreen oledScreen = OLED_SCREEN_NONE;
+// Page d'un noeud: chaque zone n'est redessinee que si son contenu change.
+OledWidget headerWidget(0, 0, 100, 8);
+OledWidget alertWidget(104, 0, 24, 8);
+OledWidget weightWidget(0, 10, 128, 16);
+OledWidget tempWidget(0, 28, 80, 16);
+OledWidget humWidget(0, 46, 80, 16);
+OledWidget batteryWidget(100, 28, 24, 10);
+OledWidget signalWidget(100, 52, 24, 10);
 
 // ===== Configuration LoRa =====
 #define LORA_CS    8
@@ -62,7 +98,8 @@ const char* MQTT_TOPIC_TELEMETRY = "ruches/telemetry";
 const char* MQTT_TOPIC_ALERT = "ruches/alert";
 const char* MQTT_TOPIC_COMMAND = "ruches/command";
 const char* MQTT_TOPIC_ACK = "ruches/ack";
-const char* LORA_TARGET_NODE_ID = "RUCHE1";
+const char* MQTT_TOPIC_BATCH = "ruches/batch";
+const uint16_t LORA_LEGACY_NODE_NUM = 1;        // ancien firmware texte: toujours RUCHE1
 
 float weight_g = 0.0f;
 float temp_c = 0.0f;
@@ -71,16 +108,17 @@ float batt_pct = 0.0f;
 int rssi_dbm = 0;
 
 // ===== Variables =====
-uint32_t packetCount = 0;
-float lastWeight = 0.0;
-int16_t lastRSSI = 0;
-float lastTempC = NAN;
-float lastHumPct = NAN;
-float lastBattPct = -1.0f;
+uint32_t packetCount = 0;                       // tous noeuds confondus
+int16_t lastRSSI = 0;                           // radio, dernier paquet recu
+float lastSNR = 0.0f;
+uint8_t rxSpreadingFactor = RUCHE_ADR_DEFAULT_SF;
+const unsigned long ADR_RX_FALLBACK_MS = 3600000;   // rien recu: retour au SF par defaut
+// Le SX1262 n'ecoute qu'un SF: avec plusieurs ruches, un SF propre a un
+// noeud rendrait les autres (et les nouveaux) inaudibles. L'ADR n'ajuste
+// alors que la puissance; true seulement pour une passerelle mono-ruche.
+const bool ADR_ADAPT_SF = false;
 bool oled_working = false;
-volatile bool receivedFlag = false;
-bool radio_receiveMode = false;
-unsigned long lastReceiveCheck = 0;
+bool radio_receiveMode = false;                // taskRadio
 int receiveErrorCount = 0;
 unsigned long lastLoraPacketMs = 0;
 bool wifiInfoPrinted = false;
@@ -92,39 +130,305 @@ bool mqttInfoPrinted = false;
 unsigned long lastWifiTryMs = 0;
 unsigned long lastHealthyNetworkMs = 0;
 const unsigned long WIFI_RETRY_INTERVAL_MS = 10000;
-const unsigned long LORA_SIGNAL_LOSS_MS = 45000;
 const int BATT_LOW_THRESHOLD_PCT = 20;
 const unsigned long NETWORK_STALL_RESTART_MS = 300000;
-bool alertSignalLost = false;
-bool alertBatteryLow = false;
-bool prevAlertSignalLost = false;
-bool prevAlertBatteryLow = false;
-String serialLine;
+char serialLine[65];                            // ligne console en cours
+size_t serialLineLen = 0;
 const unsigned long DISPLAY_REFRESH_MS = 1000;
 const unsigned long OLED_IDLE_SLEEP_MS = 90000;
 bool oledSleeping = false;
 const bool KEEP_OLED_ON_WHEN_USB_SERIAL = true;
-String pendingCmdFrame;
-bool pendingCmdActive = false;
-uint8_t pendingCmdAttempts = 0;
-unsigned long pendingCmdLastTxMs = 0;
-const unsigned long COMMAND_RETRY_MS = 2000;
-const uint8_t COMMAND_MAX_ATTEMPTS = 45;
+
+// ===== Commandes descendantes =====
+// Une commande attend la prochaine trame de son noeud et part une seule
+// fois, juste apres l'ACK, dans la fenetre de reception de l'emetteur.
+// Un noeud qui ecoute en continu (RUCHE_FLAG_RX_ALWAYS, ancien firmware
+// texte) la recoit tout de suite.
+struct DownlinkSlot {
+    char frame[64];                // "CMD:<cible>:<commande>"
+    uint8_t attempts;
+    bool active;
+
+    void reset() {
+        frame[0] = '\0';
+        attempts = 0;
+        active = false;
+    }
+};
+const uint8_t COMMAND_MAX_ATTEMPTS = 5;            // fenetres sans ACK avant abandon
+const unsigned long LORA_DOWNLINK_DELAY_MS = 60;   // l'emetteur repasse en reception apres l'ACK
+DownlinkSlot broadcastDownlink;                    // cible "*": premier noeud qui se manifeste
+
+// ===== Etat par noeud =====
+struct NodeState {
+    uint16_t nodeId;
+    char name[16];
+    RucheSeqTracker frames;        // trames uniques, pertes, doublons, hors ordre
+    int32_t lastSeq;
+    uint8_t lastFlags;
+    float weightG;
+    float tempC;                   // NAN si inconnue
+    float humPct;                  // NAN si inconnue
+    float battPct;                 // -1 si inconnue
+    int16_t rssi;
+    float snr;
+    unsigned long lastPacketMs;
+    uint32_t lastSampleS;          // date (sampleClockS) de la derniere mesure publiee
+    bool sampleSeen;
+    RucheCadence cadence;          // intervalle appris, echeance de la prochaine trame
+    uint8_t missed;                // trames manquees depuis la derniere recue
+    bool alertSignalLost;
+    bool alertBatteryLow;
+    bool prevAlertSignalLost;
+    bool prevAlertBatteryLow;
+    bool listening;                // reception continue: commande livree sans attendre
+    uint8_t tdmaSlot;              // creneau d'emission attribue (RucheTdma.h)
+    // ADR: historique SNR du noeud et reglage qu'on lui suppose.
+    RucheLinkStats adrLink;
+    RucheAdrSetting adrSetting;
+    DownlinkSlot downlink;
+
+    void reset() {
+        nodeId = 0;
+        name[0] = '\0';
+        frames.reset();
+        lastSeq = -1;
+        lastFlags = 0;
+        weightG = 0.0f;
+        tempC = NAN;
+        humPct = NAN;
+        battPct = -1.0f;
+        rssi = 0;
+        snr = 0.0f;
+        lastPacketMs = 0;
+        lastSampleS = 0;
+        sampleSeen = false;
+        cadence.reset();
+        missed = 0;
+        alertSignalLost = false;
+        alertBatteryLow = false;
+        prevAlertSignalLost = false;
+        prevAlertBatteryLow = false;
+        listening = false;
+        tdmaSlot = RUCHE_TDMA_NO_SLOT;
+        adrLink.reset();
+        adrSetting = rucheAdrDefault();
+        downlink.reset();
+    }
+};
+const uint16_t NODE_TABLE_CAPACITY = 64;           // 30+ ruches, table a moitie vide
+// Ecart max entre deux dates d'une meme mesure renvoyee: anciennete
+// arrondie a la seconde, temps d'antenne, derive RTC de l'emetteur.
+const uint32_t SAMPLE_DEDUP_TOLERANCE_S = 10;
+RucheNodeTable<NodeState, NODE_TABLE_CAPACITY> nodes;
+NodeState* lastNode = NULL;                        // dernier noeud entendu (Cloud, commandes sans cible)
+int displaySlot = -1;                              // case du noeud affiche sur l'OLED
+unsigned long lastDisplayPageMs = 0;
+const unsigned long DISPLAY_PAGE_MS = 4000;        // rotation des pages, un noeud par page
+
+// ===== Presence des noeuds =====
+// Chaque noeud a une echeance "prochaine trame attendue" (cadence apprise,
+// RucheLiveness.h) dans une roue de temporisation: un tick ne coute
+// qu'une case, quel que soit le nombre de ruches. Chaque echeance
+// depassee publie "frame_missed" (missed = 1, 2...), le signal est
+// declare perdu a LIVENESS_LOST_MISSES.
+const uint32_t LIVENESS_TICK_MS = 1000;
+const uint16_t LIVENESS_WHEEL_SLOTS = 256;
+const uint8_t LIVENESS_LOST_MISSES = 3;
+RucheTimerWheel<LIVENESS_WHEEL_SLOTS, NODE_TABLE_CAPACITY> livenessWheel;
+
+// ===== Tache radio =====
+// taskRadio possede le SX1262. Reveillee par DIO1, elle copie la trame
+// dans une case de rxFrames (pas de tas), relance aussitot la reception
+// et laisse decodage, ACK et publication a loop(). Les emissions (ACK,
+// commandes, changement de SF) lui arrivent par radioTxQueue.
+const size_t RX_FRAME_MAX = 256;
+struct RxFrameSlot {
+    uint8_t data[RX_FRAME_MAX];
+    uint16_t len;
+    int16_t rssi;
+    float snr;
+    unsigned long rxMs;
+};
+const uint16_t RX_FRAME_SLOTS = 8;                 // rafale de plusieurs ruches
+SpscRing<RxFrameSlot, RX_FRAME_SLOTS> rxFrames;
+
+struct RadioTxRequest {
+    uint8_t data[64];
+    uint8_t len;                   // 0: reglage seul
+    uint8_t setSf;                 // != 0: SF de reception applique apres l'emission
+    uint16_t delayMs;              // attente avant emission
+    bool stampAck;                 // ACK: horodatage TDMA au moment d'emettre
+    bool afterPrevious;            // sautee si l'emission precedente a echoue
+};
+const uint8_t RADIO_TX_QUEUE_LEN = 8;
+QueueHandle_t radioTxQueue = NULL;
+TaskHandle_t radioTaskHandle = NULL;
+TaskHandle_t loopTaskHandle = NULL;
+const uint32_t RADIO_EVT_DIO1 = 0x01;
+const uint32_t RADIO_EVT_TX = 0x02;
+const unsigned long RADIO_RX_CHECK_MS = 2000;      // garde-fou: IRQ manquee, reception perdue
+const unsigned long LOOP_IDLE_MS = 20;             // loop() reveillee plus tot par une trame
+
+// ===== Tache reseau =====
+// taskNetwork (coeur 0) possede WiFi, MQTT et Arduino Cloud: un connect()
+// bloquant ou un broker absent ne retarde plus ni la radio ni loop().
+// loop() lui passe des publications toutes pretes; les commandes MQTT
+// reviennent par netCommandQueue, traitees par loop() qui possede la
+// table des noeuds.
+struct NetPublish {
+    char topic[48];
+    char payload[512];
+    bool retain;
+};
+struct NetCommand {
+    char text[96];
+};
+// Valeurs du dernier noeud entendu pour les proprietes Arduino Cloud.
+struct CloudSnapshot {
+    float weightG;
+    float tempC;
+    float humPct;
+    float battPct;
+    int rssi;
+};
+// Telemetrie d'un noeud, figee a la reception: publiee en direct par
+// taskNetwork ou conservee par le stockage differe (taille fixe, ecrite
+// telle quelle en flash).
+const uint8_t TLM_FLAG_SIGNAL_LOST = 0x01;
+const uint8_t TLM_FLAG_BATT_LOW = 0x02;
+const uint8_t TLM_FLAG_UNCHANGED = 0x04;
+const uint8_t TLM_FLAG_STATS = 0x08;               // stats valide
+struct TelemetryRecord {
+    uint32_t epochS;               // heure UTC a la reception, 0 si inconnue
+    uint32_t uptimeMs;             // millis() a la reception
+    uint16_t bootId;               // demarrage de la passerelle (uptimeMs)
+    uint16_t nodeId;
+    int32_t seq;
+    uint32_t packet;
+    uint32_t lost;
+    uint32_t duplicates;
+    uint32_t outOfOrder;
+    uint32_t resyncs;
+    uint32_t lastLoraS;
+    uint32_t ageS;                 // anciennete deja connue (lots)
+    float weightG;
+    float tempC;
+    float humPct;
+    float battPct;
+    float snr;
+    float perPct;
+    int16_t rssi;
+    int8_t txDbm;
+    uint8_t sf;
+    uint8_t flags;                 // TLM_FLAG_*
+    RucheStatsBlock stats;         // statistiques d'intervalle, telles que recues
+    char raw[64];
+};
+const uint8_t NET_OUT_QUEUE_LEN = 8;
+const uint8_t NET_TELEMETRY_QUEUE_LEN = 8;
+const uint8_t NET_COMMAND_QUEUE_LEN = 4;
+const unsigned long NET_IDLE_MS = 10;
+const time_t NTP_VALID_EPOCH = 1700000000;        // horloge pas encore reglee en dessous
+QueueHandle_t netOutQueue = NULL;
+QueueHandle_t netTelemetryQueue = NULL;
+QueueHandle_t netCommandQueue = NULL;
+QueueHandle_t netCloudSlot = NULL;                 // longueur 1, xQueueOverwrite
+TaskHandle_t networkTaskHandle = NULL;
+volatile bool netMqttUp = false;                   // ecrit par taskNetwork
+uint32_t netDropped = 0;                           // file pleine (loop)
+bool ntpStarted = false;
+
+// ===== Stockage differe de la telemetrie (taskNetwork) =====
+// Broker injoignable: les enregistrements attendent dans une file en
+// PSRAM, deversee par segments dans un journal LittleFS (usure repartie
+// par le systeme de fichiers, segment efface une fois rejoue). Le
+// journal contient toujours les plus anciens. Rejeu non retenu, du plus
+// ancien au plus recent, limite en debit; au moins une fois (un segment
+// entame avant un redemarrage est rejoue en entier).
+const uint32_t STORE_RAM_RECORDS_PSRAM = 1024;      // x 164 o (TelemetryRecord): ~164 ko
+const uint32_t STORE_RAM_RECORDS_HEAP = 64;         // sans PSRAM
+const uint16_t STORE_SEGMENT_RECORDS = 32;          // 5.1 ko: 2 blocs LittleFS
+const uint32_t STORE_MAX_SEGMENTS = 96;             // ~770 ko de flash en blocs
+// Partition "spiffs" de default_8MB.csv (carte heltec_wifi_lora_32_v3).
+// LittleFS copie avant d'ecrire: le journal en laisse un quart libre.
+const size_t STORE_FS_BLOCK_BYTES = 4096;
+const size_t STORE_FS_PARTITION_BYTES = 0x180000;
+const size_t STORE_SEGMENT_FLASH_BYTES =
+    (STORE_SEGMENT_RECORDS * sizeof(TelemetryRecord) + STORE_FS_BLOCK_BYTES - 1) / STORE_FS_BLOCK_BYTES *
+    STORE_FS_BLOCK_BYTES;
+static_assert(STORE_MAX_SEGMENTS * STORE_SEGMENT_FLASH_BYTES <= STORE_FS_PARTITION_BYTES / 4 * 3,
+              "STORE_MAX_SEGMENTS trop grand pour la partition LittleFS");
+const unsigned long STORE_SPILL_AGE_MS = 300000;    // perte max sur coupure secteur
+const uint16_t REPLAY_RATE_PER_S = 5;
+const uint16_t REPLAY_BURST = 10;
+const uint32_t STORE_META_MAGIC = 0x52534631;       // "RSF1"
+const char* STORE_META_PATH = "/tlm_meta";
+
+struct StoreMeta {
+    uint32_t magic;
+    uint16_t recordSize;           // format change: journal abandonne
+    uint16_t bootId;
+    uint32_t firstSegment;         // plus ancien segment present
+    uint32_t nextSegment;          // prochain segment a creer
+};
+
+RecordRing<TelemetryRecord> storeRam;
+StoreMeta storeMeta;
+bool storeFlashOk = false;
+uint16_t storeBootId = 0;          // fixe dans setup(), avant les taches
+File replayFile;
+bool replayOpen = false;
+uint32_t replayOffset = 0;         // octets deja rejoues du segment ouvert
+TokenBucket replayBucket;
+uint32_t storeReplayed = 0;
+uint32_t storeSpilled = 0;
+uint32_t storeFlashDropped = 0;    // segments les plus anciens effaces, journal plein
+
+// ===== Lots MessagePack (taskNetwork) =====
+// Un lot part a MQTT_BATCH_MAX_RECORDS mesures ou MQTT_BATCH_MAX_MS apres
+// la premiere. En JSON, lots d'une mesure: publication immediate.
+const uint8_t MQTT_BATCH_MAX_RECORDS = 16;
+const unsigned long MQTT_BATCH_MAX_MS = 10000;
+const size_t MQTT_BATCH_BUF = 4096;               // 16 mesures ~1.7 ko, ~3 ko avec statistiques
+const uint8_t MQTT_BATCH_RECORDS = MQTT_UPLINK_MSGPACK ? MQTT_BATCH_MAX_RECORDS : 1;
+TelemetryRecord liveBatch[MQTT_BATCH_MAX_RECORDS];
+uint8_t liveBatchCount = 0;
+unsigned long liveBatchStartMs = 0;
+TelemetryRecord replayBatch[MQTT_BATCH_MAX_RECORDS];
+// Colonnes d'un lot, envoyees une fois par publication.
+const char* const PACK_KEYS[] = {
+    "node_id", "seq", "age_s", "weight_g", "temp_c", "hum_pct", "batt_pct",
+    "rssi_dbm", "snr_db", "sf", "tx_dbm", "alert_signal_lost", "alert_batt_low",
+    "unchanged", "packet", "lost", "dup", "ooo", "resync", "per_pct",
+    "stat_span_s", "w_n", "w_mean", "w_min", "w_max", "w_sd",
+    "t_n", "t_mean", "t_min", "t_max", "t_sd",
+    "h_n", "h_mean", "h_min", "h_max", "h_sd"
+};
+const uint8_t PACK_KEY_COUNT = sizeof(PACK_KEYS) / sizeof(PACK_KEYS[0]);
 
 WiFiClient wifiClient;
 PubSubClient mqttClient(wifiClient);
 
 WiFiConnectionHandler ArduinoIoTPreferredConnection(WIFI_SSID, WIFI_PASSWORD);
 
-void handleReceivedFrame(const String& received, unsigned long now);
-bool sendLoRaFrame(const String& frame);
-String normalizeCommandFrame(const String& payloadText);
-void processLocalCommand(String line);
+void handleReceivedFrame(const char* text, size_t len, unsigned long now);
+void handleReceivedPacket(const uint8_t* data, size_t len, unsigned long now);
+bool sendLoRaFrame(const char* frame, uint16_t delayMs = 0, bool afterPrevious = false);
+void sendTelemetryAck(NodeState& node, uint16_t seq, uint8_t flags);
+void setReceiveSpreadingFactor(uint8_t sf, bool afterPrevious = false);
+NodeState* nodeFor(uint16_t nodeId);
+DownlinkSlot* pendingDownlinkFor(NodeState& node);
+void transmitDownlink(DownlinkSlot& d, bool afterAck = false);
+void processLocalCommand(const char* line, size_t len);
 void mqttCallback(char* topic, byte* payload, unsigned int length);
-void publishTelemetryMqtt(const String& rawPayload);
+bool queueNetPublish(const char* topic, const char* payload, bool retain);
+void publishTelemetryMqtt(const NodeState& node, const char* raw, uint32_t ageS = 0,
+                          const RucheIntervalStats* stats = NULL);
+void applyBinaryTelemetry(NodeState& node, const RucheTelemetry& tm, uint32_t ageS, const char* raw, unsigned long now);
 void setOledSleep(bool sleepOn);
 bool isUsbSerialActive();
-void queueCommandFrame(const String& frame);
+void queueCommandFrame(const char* frame);
 
 void initProperties() {
     ArduinoCloud.setBoardId(DEVICE_LOGIN_NAME);
@@ -136,45 +440,188 @@ void initProperties() {
     ArduinoCloud.addProperty(rssi_dbm, READ, CLOUD_UPDATE_INTERVAL_S, NULL);
 }
 
-void setFlag() {
-    receivedFlag = true;
+void IRAM_ATTR onRadioDio1() {
+    if (radioTaskHandle == NULL) return;
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(radioTaskHandle, RADIO_EVT_DIO1, eSetBits, &woken);
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
 }
 
-void publishAlertEvent(const char* type, bool active) {
-    if (!mqttClient.connected()) return;
+void publishAlertEvent(const NodeState& node, const char* type, bool active) {
+    if (!netMqttUp) return;
     char json[160];
     int n = snprintf(
         json,
         sizeof(json),
-        "{\"type\":\"%s\",\"active\":%d,\"packet\":%lu,\"ts_ms\":%lu}",
+        "{\"node\":\"%s\",\"type\":\"%s\",\"active\":%d,\"packet\":%lu,\"ts_ms\":%lu}",
+        node.name,
         type,
         active ? 1 : 0,
-        (unsigned long)packetCount,
+        (unsigned long)node.frames.received,
         (unsigned long)millis()
     );
     if (n > 0 && n < (int)sizeof(json)) {
-        mqttClient.publish(MQTT_TOPIC_ALERT, json, true);
+        queueNetPublish(MQTT_TOPIC_ALERT, json, true);
+    }
+}
+
+// Transitions des alertes du noeud: signal (fixe par la roue de
+// presence) et batterie (a chaque trame).
+void updateNodeAlerts(NodeState& node) {
+    node.alertBatteryLow = (node.battPct >= 0.0f) && (node.battPct <= (float)BATT_LOW_THRESHOLD_PCT);
+
+    if (node.alertSignalLost != node.prevAlertSignalLost) {
+        Serial.print("ALERTE ");
+        Serial.print(node.name);
+        Serial.print(" Signal ");
+        Serial.println(node.alertSignalLost ? "PERDU" : "RETABLI");
+        publishAlertEvent(node, "signal_lost", node.alertSignalLost);
+        node.prevAlertSignalLost = node.alertSignalLost;
+    }
+    if (node.alertBatteryLow != node.prevAlertBatteryLow) {
+        Serial.print("ALERTE ");
+        Serial.print(node.name);
+        Serial.print(" Batterie ");
+        Serial.println(node.alertBatteryLow ? "BASSE" : "OK");
+        publishAlertEvent(node, "battery_low", node.alertBatteryLow);
+        node.prevAlertBatteryLow = node.alertBatteryLow;
+    }
+}
+
+// Non retenu: evenement ponctuel. active=0 a la trame qui suit des
+// manques, avec le nombre atteint.
+void publishMissedEvent(const NodeState& node, bool active, unsigned long now) {
+    if (!netMqttUp) return;
+    char json[224];
+    int n = snprintf(
+        json,
+        sizeof(json),
+        "{\"node\":\"%s\",\"type\":\"frame_missed\",\"active\":%d,\"missed\":%u,"
+        "\"expected_s\":%lu,\"silent_s\":%lu,\"packet\":%lu,\"ts_ms\":%lu}",
+        node.name,
+        active ? 1 : 0,
+        (unsigned)node.missed,
+        (unsigned long)(node.cadence.expectedMs() / 1000UL),
+        (unsigned long)((now - node.lastPacketMs) / 1000UL),
+        (unsigned long)node.frames.received,
+        (unsigned long)now
+    );
+    if (n > 0 && n < (int)sizeof(json)) {
+        queueNetPublish(MQTT_TOPIC_ALERT, json, false);
     }
 }
 
-void updateAlertStates(unsigned long now) {
-    alertSignalLost = (lastLoraPacketMs > 0) && ((now - lastLoraPacketMs) > LORA_SIGNAL_LOSS_MS);
-    alertBatteryLow = (lastBattPct >= 0.0f) && (lastBattPct <= (float)BATT_LOW_THRESHOLD_PCT);
+// Ticks d'une seconde sur l'horloge esp_timer (64 bits): pas de
+// rebouclage de millis() dans les comparaisons de la roue.
+uint32_t livenessTickNow() {
+    return (uint32_t)(esp_timer_get_time() / ((int64_t)LIVENESS_TICK_MS * 1000LL));
+}
+
+void armLiveness(NodeState& node, unsigned long now) {
+    uint16_t slot = (uint16_t)(&node - nodes.values);
+    int32_t inMs = (int32_t)(node.cadence.deadlineMs((uint16_t)(node.missed + 1)) - (uint32_t)now);
+    if (inMs < 0) inMs = 0;
+    livenessWheel.schedule(slot, livenessTickNow() + ((uint32_t)inMs + LIVENESS_TICK_MS - 1) / LIVENESS_TICK_MS);
+}
 
-    if (alertSignalLost != prevAlertSignalLost) {
-        Serial.print("ALERTE Signal ");
-        Serial.println(alertSignalLost ? "PERDU" : "RETABLI");
-        publishAlertEvent("signal_lost", alertSignalLost);
-        prevAlertSignalLost = alertSignalLost;
+// loop(): trame recue (une fois par trame, lot compris), avant mise a
+// jour de lastSeq. seq < 0: trame texte sans sequence.
+void noteNodeFrame(NodeState& node, int32_t seq, uint8_t flags, unsigned long now) {
+    uint16_t gap = 0;
+    if (seq >= 0 && node.lastSeq >= 0 && (flags & RUCHE_FLAG_SEQ_RESET) == 0) {
+        gap = (uint16_t)((uint16_t)seq - (uint16_t)node.lastSeq);
+        if (gap > RUCHE_LIVENESS_MAX_SEQ_GAP) gap = 0;     // hors ordre ou redemarrage
     }
-    if (alertBatteryLow != prevAlertBatteryLow) {
-        Serial.print("ALERTE Batterie ");
-        Serial.println(alertBatteryLow ? "BASSE" : "OK");
-        publishAlertEvent("battery_low", alertBatteryLow);
-        prevAlertBatteryLow = alertBatteryLow;
+    node.cadence.onFrame((uint32_t)now, gap);
+    if (node.missed > 0) {
+        Serial.printf("%s de retour apres %u trame(s) manquee(s)\n", node.name, (unsigned)node.missed);
+        publishMissedEvent(node, false, now);
+        node.missed = 0;
+    }
+    node.alertSignalLost = false;
+    armLiveness(node, now);
+}
+
+// Echeance depassee: une trame de plus manque.
+struct LivenessExpiry {
+    unsigned long now;
+
+    void operator()(uint16_t slot) {
+        NodeState& node = nodes.values[slot];
+        if (node.missed < 0xFF) node.missed++;
+        Serial.printf("%s: %u trame(s) manquee(s), attendue toutes les %lus\n",
+                      node.name, (unsigned)node.missed,
+                      (unsigned long)(node.cadence.expectedMs() / 1000UL));
+        publishMissedEvent(node, true, now);
+        if (node.missed >= LIVENESS_LOST_MISSES) {
+            node.alertSignalLost = true;
+            updateNodeAlerts(node);
+            return;                // plus d'echeance jusqu'a la prochaine trame
+        }
+        armLiveness(node, now);
     }
+};
+
+void advanceLiveness(unsigned long now) {
+    LivenessExpiry expiry;
+    expiry.now = now;
+    livenessWheel.advance(livenessTickNow(), expiry);
 }
 
+bool anySignalLost() {
+    for (uint16_t i = 0; i < NODE_TABLE_CAPACITY; i++) {
+        if (nodes.used[i] && nodes.values[i].alertSignalLost) return true;
+    }
+    return false;
+}
+
+// Premier creneau TDMA libre; RUCHE_TDMA_NO_SLOT au-dela de
+// RUCHE_TDMA_SLOTS noeuds (acces libre pour les suivants).
+uint8_t allocateTdmaSlot() {
+    for (uint8_t slot = 0; slot < RUCHE_TDMA_SLOTS; slot++) {
+        bool taken = false;
+        for (uint16_t i = 0; i < NODE_TABLE_CAPACITY && !taken; i++) {
+            taken = nodes.used[i] && nodes.values[i].tdmaSlot == slot;
+        }
+        if (!taken) return slot;
+    }
+    return RUCHE_TDMA_NO_SLOT;
+}
+
+// Horloge TDMA du recepteur: position dans le cycle, sur le compteur
+// 64 bits (millis() reboucle en 49 jours et decalerait tous les creneaux).
+uint16_t tdmaCyclePosMs() {
+    return (uint16_t)((uint64_t)(esp_timer_get_time() / 1000) % RUCHE_TDMA_CYCLE_MS);
+}
+
+// Etat du noeud, cree a sa premiere trame; NULL si la table est pleine.
+NodeState* nodeFor(uint16_t nodeId) {
+    bool inserted = false;
+    NodeState* node = nodes.findOrInsert(nodeId, &inserted);
+    if (node == NULL) {
+        Serial.print("Table des noeuds pleine, ignore RUCHE");
+        Serial.println(nodeId);
+        return NULL;
+    }
+    if (inserted) {
+        node->nodeId = nodeId;
+        rucheFormatNodeName(nodeId, node->name, sizeof(node->name));
+        node->tdmaSlot = allocateTdmaSlot();
+        Serial.print("Nouveau noeud: ");
+        Serial.print(node->name);
+        Serial.print(" creneau ");
+        Serial.print(node->tdmaSlot);
+        Serial.print(" (");
+        Serial.print(nodes.count);
+        Serial.println(" connus)");
+        if (displaySlot < 0) displaySlot = nodes.slotOf(nodeId);
+    }
+    return node;
+}
+
+// taskNetwork
 void ensureWiFiConnection() {
     if (strlen(WIFI_SSID) == 0) return;
     if (WiFi.status() == WL_CONNECTED) return;
@@ -242,7 +689,7 @@ void drawBatteryBars(float battPct, int x, int y) {
     }
 }
 
-// Fonction pour verifier et remettre en reception si necessaire
+// taskRadio (ou initLoRa): remet en reception si necessaire
 void ensureReceiveMode() {
     if (!radio_receiveMode) {
         Serial.println("Remise en reception...");
@@ -286,85 +733,101 @@ bool initOLED() {
     oled.setCursor(0, 0);
     oled.println("Recepteur LoRa");
     oled.display();
+    if (!oledRenderer.begin(OLED_TASK_PRIORITY, 1)) {
+        Serial.print("(envoi synchrone) ");
+    }
     
     Serial.println("OK");
     return true;
 }
 
+// Rang 1..n de la case dans la table, pour l'indicateur de page.
+uint16_t nodeRank(int slot) {
+    uint16_t rank = 0;
+    for (int i = 0; i <= slot && i < (int)NODE_TABLE_CAPACITY; i++) {
+        if (nodes.used[i]) rank++;
+    }
+    return rank;
+}
+
 void updateDisplay() {
     if (!oled_working || oledSleeping) return;
     
-    oled.clearDisplay();
-    oled.setTextColor(SSD1306_WHITE);
-    oled.setTextSize(2);
+    if (displaySlot < 0) {
+        if (oledScreen != OLED_SCREEN_WAITING) {
+            oledRenderer.clear();
+            oled.setTextColor(SSD1306_WHITE);
+            oled.setTextSize(1);
+            oled.setCursor(0, 0);
+            oled.println("Recepteur LoRa");
+            oled.println("En attente...");
+            oledScreen = OLED_SCREEN_WAITING;
+        }
+        oledRenderer.flush();
+        return;
+    }
+    const NodeState& node = nodes.values[displaySlot];
+
+    if (oledScreen != OLED_SCREEN_NODE) {
+        oledRenderer.clear();
+        oled.setTextColor(SSD1306_WHITE);
+        oled.setTextSize(1);
+        oled.setCursor(82, 29);
+        oled.print("BAT");
+        oled.setCursor(82, 54);
+        oled.print("SGN");
+        oledScreen = OLED_SCREEN_NODE;
+    }
+
+    // Une page par noeud: nom et rang en en-tete
+    char text[24];
+    snprintf(text, sizeof(text), "%s %u/%u", node.name,
+             (unsigned)nodeRank(displaySlot), (unsigned)nodes.count);
+    oledRenderer.text(headerWidget, 1, text);
+
+    oledRenderer.text(alertWidget, 1,
+                      node.alertSignalLost ? "!SIG" : (node.alertBatteryLow ? "!BAT" : ""));
 
     // P = Poids (grammes)
-    oled.setCursor(0, 0);
-    oled.print("P:");
-    float displayWeight = lastWeight;
+    float displayWeight = node.weightG;
     if (displayWeight < 0) displayWeight = -displayWeight;
     if (displayWeight >= 1000.0f) {
-        oled.print(displayWeight / 1000.0f, 3);
-        oled.print("kg");
+        snprintf(text, sizeof(text), "P:%.3fkg", displayWeight / 1000.0f);
     } else {
-        oled.print(displayWeight, 0);
-        oled.print("g");
+        snprintf(text, sizeof(text), "P:%.0fg", displayWeight);
     }
+    oledRenderer.text(weightWidget, 2, text);
 
-    oled.setCursor(0, 22);
-    oled.print("T:");
-    if (!isnan(lastTempC)) {
-        oled.print(lastTempC, 0);
-        oled.print("C");
+    if (!isnan(node.tempC)) {
+        snprintf(text, sizeof(text), "T:%.0fC", node.tempC);
     } else {
-        oled.print("--C");
+        strcpy(text, "T:--C");
     }
+    oledRenderer.text(tempWidget, 2, text);
 
-    oled.setCursor(0, 44);
-    oled.print("H:");
-    if (!isnan(lastHumPct)) {
-        oled.print(lastHumPct, 0);
-        oled.print("%");
+    if (!isnan(node.humPct)) {
+        snprintf(text, sizeof(text), "H:%.0f%%", node.humPct);
     } else {
-        oled.print("--%");
+        strcpy(text, "H:--%");
     }
+    oledRenderer.text(humWidget, 2, text);
 
-    // Batterie en face de la temperature, label petit + barres
-    oled.setTextSize(1);
-    oled.setCursor(82, 23);
-    oled.print("BAT");
-    drawBatteryBars(lastBattPct, 100, 22);
-
-    // Signal en bas a droite avec label SGN
-    oled.setCursor(82, 54);
-    oled.print("SGN");
-    drawSignalBars(lastRSSI, 100, 52);
-
-    if (alertSignalLost || alertBatteryLow) {
-        oled.setTextSize(1);
-        oled.setCursor(80, 0);
-        oled.print("ALR:");
-        if (alertSignalLost) oled.print("SIG ");
-        if (alertBatteryLow) oled.print("BAT");
+    // Batterie en face de la temperature, signal en bas a droite
+    if (oledRenderer.beginWidget(batteryWidget, battToBars(node.battPct))) {
+        drawBatteryBars(node.battPct, batteryWidget.x, batteryWidget.y);
+    }
+    if (oledRenderer.beginWidget(signalWidget, rssiToBars(node.rssi))) {
+        drawSignalBars(node.rssi, signalWidget.x, signalWidget.y);
     }
     
-    oled.display();
-}
-
-float parseFieldValue(const String& payload, const String& key, float fallback) {
-    int idx = payload.indexOf(key);
-    if (idx < 0) return fallback;
-    int start = idx + key.length();
-    int end = payload.indexOf(',', start);
-    String token = (end >= 0) ? payload.substring(start, end) : payload.substring(start);
-    return token.toFloat();
+    oledRenderer.flush();
 }
 
 void setOledSleep(bool sleepOn) {
     if (!oled_working) return;
     if (sleepOn && isUsbSerialActive() && KEEP_OLED_ON_WHEN_USB_SERIAL) return;
     if (sleepOn == oledSleeping) return;
-    oled.ssd1306_command(sleepOn ? SSD1306_DISPLAYOFF : SSD1306_DISPLAYON);
+    oledRenderer.setPower(!sleepOn);   // RAM de l'ecran conservee
     oledSleeping = sleepOn;
 }
 
@@ -372,148 +835,589 @@ bool isUsbSerialActive() {
     return (bool)Serial;
 }
 
-bool sendLoRaFrame(const String& frame) {
-    String out = frame;
-    out.trim();
-    if (out.length() == 0) return false;
+// Demande d'emission a taskRadio; false si la file est pleine.
+bool queueRadioTx(const uint8_t* data, size_t len, uint16_t delayMs, uint8_t setSf,
+                  bool stampAck, bool afterPrevious) {
+    RadioTxRequest req;
+    if (len > sizeof(req.data)) return false;
+    if (len > 0) memcpy(req.data, data, len);
+    req.len = (uint8_t)len;
+    req.setSf = setSf;
+    req.delayMs = delayMs;
+    req.stampAck = stampAck;
+    req.afterPrevious = afterPrevious;
+    if (radioTxQueue == NULL || xQueueSend(radioTxQueue, &req, 0) != pdTRUE) {
+        Serial.println("File d'emission LoRa pleine");
+        return false;
+    }
+    xTaskNotify(radioTaskHandle, RADIO_EVT_TX, eSetBits);
+    return true;
+}
+
+bool sendLoRaFrame(const char* frame, uint16_t delayMs, bool afterPrevious) {
+    size_t len = strlen(frame);
+    rucheTrimView(&frame, &len);
+    if (len == 0) return false;
 
     Serial.print("Commande LoRa TX: ");
-    Serial.println(out);
+    Serial.write((const uint8_t*)frame, len);
+    Serial.println();
+    return queueRadioTx((const uint8_t*)frame, len, delayMs, 0, false, afterPrevious);
+}
 
-    int state = radio.transmit(out.c_str());
-    radio_receiveMode = false;
-    ensureReceiveMode();
+// Le SF change apres les emissions deja en file (ACK qui l'annonce).
+void setReceiveSpreadingFactor(uint8_t sf, bool afterPrevious) {
+    if (sf == rxSpreadingFactor) return;
+    if (queueRadioTx(NULL, 0, 0, sf, false, afterPrevious)) {
+        rxSpreadingFactor = sf;
+    }
+}
 
-    if (state == RADIOLIB_ERR_NONE) {
-        Serial.println("Commande LoRa envoyee");
-        return true;
+// Acquitte une trame de telemetrie: l'emetteur en fait sa reference
+// d'envoi sur variation. Envoye avant MQTT pour tenir dans sa fenetre
+// d'ecoute. L'ACK porte aussi le reglage radio recommande (ADR).
+void sendTelemetryAck(NodeState& node, uint16_t seq, uint8_t flags) {
+    if (flags & RUCHE_FLAG_ADR_DEFAULT) {
+        // Le noeud est revenu au profil par defaut (ACK perdus, redemarrage).
+        if (!rucheAdrEqual(node.adrSetting, rucheAdrDefault())) node.adrLink.reset();
+        node.adrSetting = rucheAdrDefault();
+    }
+    node.listening = (flags & RUCHE_FLAG_RX_ALWAYS) != 0;
+    DownlinkSlot* downlink = pendingDownlinkFor(node);
+
+    node.adrLink.push(lastSNR);
+    RucheAdrSetting rec = rucheAdrRecommend(node.adrLink, node.adrSetting);
+    if (!ADR_ADAPT_SF) rec.sf = rxSpreadingFactor;
+    if (downlink != NULL) {
+        // La commande part avec le reglage actuel: ADR reporte a la trame suivante.
+        rec = node.adrSetting;
     }
 
-    Serial.print("Erreur envoi commande LoRa: ");
-    Serial.println(state);
-    return false;
+    RucheAck ack;
+    ack.nodeId = node.nodeId;
+    ack.seq = seq;
+    ack.adrSf = rec.sf;
+    ack.adrPowerDbm = rec.powerDbm;
+    ack.flags = (downlink != NULL) ? RUCHE_ACK_FLAG_DOWNLINK : 0;
+    ack.tdmaSlot = node.tdmaSlot;
+    ack.cyclePosMs = 0;            // horodate par taskRadio au moment d'emettre
+    uint8_t buf[sizeof(RucheAckFrame)];
+    size_t len = rucheEncodeAck(ack, buf, sizeof(buf));
+    if (len == 0 || !queueRadioTx(buf, len, 0, 0, true, false)) return;
+    if (downlink != NULL) {
+        // Une seule emission, dans la fenetre annoncee par l'ACK.
+        transmitDownlink(*downlink, true);
+    }
+    if (!rucheAdrEqual(rec, node.adrSetting)) {
+        // Nouvelles mesures au nouveau reglage; le SF change des deux cotes.
+        Serial.print("ADR ");
+        Serial.print(node.name);
+        Serial.print(": recommande SF");
+        Serial.print(rec.sf);
+        Serial.print(" ");
+        Serial.print(rec.powerDbm);
+        Serial.println(" dBm");
+        node.adrSetting = rec;
+        node.adrLink.reset();
+        setReceiveSpreadingFactor(rec.sf, true);
+    }
 }
 
-void queueCommandFrame(const String& frame) {
-    pendingCmdFrame = frame;
-    pendingCmdActive = true;
-    pendingCmdAttempts = 0;
-    pendingCmdLastTxMs = 0;
+// Commande en attente pour ce noeud (la sienne, sinon une commande "*").
+DownlinkSlot* pendingDownlinkFor(NodeState& node) {
+    if (node.downlink.active) return &node.downlink;
+    return broadcastDownlink.active ? &broadcastDownlink : NULL;
 }
 
-String normalizeCommandFrame(const String& payloadText) {
-    String cmd = payloadText;
-    cmd.trim();
-    if (cmd.length() == 0) return "";
+void transmitDownlink(DownlinkSlot& d, bool afterAck) {
+    bool ok = afterAck ? sendLoRaFrame(d.frame, LORA_DOWNLINK_DELAY_MS, true)
+                       : sendLoRaFrame(d.frame);
+    d.attempts++;
+    if (ok) {
+        Serial.print("Commande en attente ACK, fenetre ");
+        Serial.print(d.attempts);
+        Serial.print("/");
+        Serial.println(COMMAND_MAX_ATTEMPTS);
+    }
+    if (d.attempts >= COMMAND_MAX_ATTEMPTS) {
+        Serial.println("Commande abandonnee: aucun ACK");
+        d.reset();
+    }
+}
 
-    if (cmd.startsWith("CMD:")) {
-        return cmd;
+// Cible des commandes sans noeud ("tare", "cal:500"): le dernier noeud
+// entendu, comme du temps de la ruche unique; "*" si aucun.
+const char* defaultCommandTarget() {
+    return (lastNode != NULL) ? lastNode->name : "*";
+}
+
+// "CMD:<cible>:<commande>", deja construite par rucheBuildCommandFrame.
+void queueCommandFrame(const char* frame) {
+    size_t len = strlen(frame);
+    if (len >= sizeof(broadcastDownlink.frame)) {
+        Serial.println("Commande refusee: trop longue");
+        return;
     }
-    if (cmd.equalsIgnoreCase("TARE") || cmd.startsWith("CAL:")) {
-        return "CMD:" + String(LORA_TARGET_NODE_ID) + ":" + cmd;
+    char target[16] = "*";
+    const char* start = frame + 4;
+    const char* sep = (len > 4) ? strchr(start, ':') : NULL;
+    if (sep != NULL && sep > start) {
+        const char* t = start;
+        size_t tLen = (size_t)(sep - start);
+        rucheTrimView(&t, &tLen);
+        if (tLen >= sizeof(target)) {
+            Serial.println("Commande refusee: noeud invalide");
+            return;
+        }
+        memcpy(target, t, tLen);
+        target[tLen] = '\0';
     }
-    if (cmd.startsWith("cal") || cmd.startsWith("CAL")) {
-        String mass = cmd.substring(3);
-        mass.trim();
-        if (mass.length() > 0) {
-            return "CMD:" + String(LORA_TARGET_NODE_ID) + ":CAL:" + mass;
+    DownlinkSlot* d = &broadcastDownlink;
+    NodeState* node = NULL;
+    if (target[0] != '\0' && strcmp(target, "*") != 0) {
+        uint16_t nodeId = 0;
+        if (!rucheParseNodeName(target, &nodeId)) {
+            Serial.print("Commande refusee: noeud invalide ");
+            Serial.println(target);
+            return;
         }
+        // Noeud pas encore entendu: la commande attend sa premiere trame.
+        node = nodeFor(nodeId);
+        if (node == NULL) return;
+        d = &node->downlink;
+    }
+    memcpy(d->frame, frame, len + 1);
+    d->attempts = 0;
+    d->active = true;
+    if (node != NULL && node->listening) {
+        transmitDownlink(*d);
+    } else {
+        Serial.print("Commande en attente de la prochaine trame de ");
+        Serial.println(target);
     }
+}
 
-    int sep = cmd.indexOf(':');
-    if (sep > 0) {
-        String rhs = cmd.substring(sep + 1);
-        if (rhs.equalsIgnoreCase("TARE") || rhs.startsWith("CAL:")) {
-            return "CMD:" + cmd;
-        }
+void printNodeTable() {
+    Serial.print("Noeuds connus: ");
+    Serial.print(nodes.count);
+    Serial.print("/");
+    Serial.println(NODE_TABLE_CAPACITY);
+    Serial.print("Trames perdues file radio: ");
+    Serial.println((unsigned long)rxFrames.dropped());
+    Serial.print("Publications MQTT perdues (file pleine): ");
+    Serial.println((unsigned long)netDropped);
+    // Compteurs de taskNetwork, lus sans verrou: indicatifs.
+    Serial.printf("Stockage differe: ram=%lu/%lu flash=%lu segment(s) rejoues=%lu deverses=%lu ecrases=%lu perdus_flash=%lu\n",
+                  (unsigned long)storeRam.count,
+                  (unsigned long)storeRam.capacity,
+                  (unsigned long)(storeMeta.nextSegment - storeMeta.firstSegment),
+                  (unsigned long)storeReplayed,
+                  (unsigned long)storeSpilled,
+                  (unsigned long)storeRam.overwritten,
+                  (unsigned long)storeFlashDropped);
+    Serial.printf("OLED: %lu envois, %lu octets I2C\n",
+                  (unsigned long)oledRenderer.flushes(),
+                  (unsigned long)oledRenderer.bytesSent());
+    unsigned long now = millis();
+    for (uint16_t i = 0; i < NODE_TABLE_CAPACITY; i++) {
+        if (!nodes.used[i]) continue;
+        const NodeState& n = nodes.values[i];
+        Serial.printf("  %-11s creneau=%u trames=%lu perdues=%lu (%.1f%%) doublons=%lu seq=%ld poids=%.0fg bat=%.0f%% rssi=%d vu=%lus attendu=%lus manquees=%u%s%s%s\n",
+                      n.name,
+                      (unsigned)n.tdmaSlot,
+                      (unsigned long)n.frames.received,
+                      (unsigned long)n.frames.lost,
+                      n.frames.perPct(),
+                      (unsigned long)n.frames.duplicates,
+                      (long)n.lastSeq,
+                      n.weightG,
+                      n.battPct,
+                      (int)n.rssi,
+                      n.lastPacketMs ? (now - n.lastPacketMs) / 1000UL : 0UL,
+                      (unsigned long)(n.cadence.expectedMs() / 1000UL),
+                      (unsigned)n.missed,
+                      n.alertSignalLost ? " SIG" : "",
+                      n.alertBatteryLow ? " BAT" : "",
+                      n.downlink.active ? " CMD" : "");
     }
+}
 
-    return "";
+bool lineIs(const char* line, size_t len, const char* word) {
+    return len == strlen(word) && strncasecmp(line, word, len) == 0;
 }
 
-void processLocalCommand(String line) {
-    line.trim();
-    if (line.length() == 0) return;
+void processLocalCommand(const char* line, size_t len) {
+    rucheTrimView(&line, &len);
+    if (len == 0) return;
 
-    if (line.equalsIgnoreCase("help") || line.equalsIgnoreCase("h")) {
-        Serial.println("Commandes RX: tare | cal:500 | RUCHE1:TARE | CMD:RUCHE1:CAL:500");
+    if (lineIs(line, len, "help") || lineIs(line, len, "h")) {
+        Serial.println("Commandes RX: tare | cal:500 | RUCHE1:TARE | CMD:RUCHE1:CAL:500 | noeuds");
+        return;
+    }
+    if (lineIs(line, len, "noeuds") || lineIs(line, len, "nodes")) {
+        printNodeTable();
         return;
     }
 
-    String frame = normalizeCommandFrame(line);
-    if (frame.length() == 0) {
+    char frame[sizeof(broadcastDownlink.frame)];
+    if (rucheBuildCommandFrame(line, len, defaultCommandTarget(), frame, sizeof(frame)) == 0) {
         Serial.println("Commande invalide. Exemple: tare ou cal:500");
         return;
     }
     queueCommandFrame(frame);
 }
 
+// taskNetwork: la commande est recopiee pour loop(), seule a toucher
+// aux noeuds et aux emissions.
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
     if (topic == nullptr || payload == nullptr || length == 0) return;
-    String topicStr(topic);
-    if (topicStr != MQTT_TOPIC_COMMAND) return;
+    if (strcmp(topic, MQTT_TOPIC_COMMAND) != 0) return;
 
-    String body;
-    body.reserve(length + 1);
-    for (unsigned int i = 0; i < length; i++) {
-        body += (char)payload[i];
+    NetCommand cmd;
+    if (length >= sizeof(cmd.text)) {
+        Serial.println("MQTT commande refusee: trop longue");
+        return;
     }
-    body.trim();
+    memcpy(cmd.text, payload, length);
+    cmd.text[length] = '\0';
+    if (xQueueSend(netCommandQueue, &cmd, 0) != pdTRUE) {
+        Serial.println("MQTT commande perdue: file pleine");
+    }
+}
 
-    String frame = normalizeCommandFrame(body);
-    if (frame.length() == 0) {
+void handleMqttCommand(const char* text) {
+    char frame[sizeof(broadcastDownlink.frame)];
+    if (rucheBuildCommandFrame(text, strlen(text), defaultCommandTarget(), frame, sizeof(frame)) == 0) {
         Serial.print("MQTT commande invalide: ");
-        Serial.println(body);
+        Serial.println(text);
         return;
     }
     queueCommandFrame(frame);
 }
 
-void handleReceivedFrame(const String& received, unsigned long now) {
+// Valeurs du dernier noeud entendu vers les proprietes Arduino Cloud,
+// recopiees par taskNetwork (seule la plus recente compte).
+void mirrorCloudProperties(const NodeState& node) {
+    if (!cloudEnabled) return;
+    CloudSnapshot snap;
+    snap.weightG = node.weightG;
+    snap.tempC = node.tempC;
+    snap.humPct = node.humPct;
+    snap.battPct = node.battPct;
+    snap.rssi = (int)node.rssi;
+    xQueueOverwrite(netCloudSlot, &snap);
+}
+
+// taskNetwork
+void applyCloudSnapshot(const CloudSnapshot& snap) {
+    weight_g = snap.weightG;
+    temp_c = isnan(snap.tempC) ? temp_c : snap.tempC;
+    hum_pct = isnan(snap.humPct) ? hum_pct : snap.humPct;
+    batt_pct = (snap.battPct < 0.0f) ? batt_pct : snap.battPct;
+    rssi_dbm = snap.rssi;
+}
+
+// Trame texte (ancien firmware, ACK de commande); text termine par '\0'.
+void handleReceivedFrame(const char* text, size_t len, unsigned long now) {
     setOledSleep(false);
-    if (received.startsWith("ACK:")) {
+    if (len >= 4 && memcmp(text, "ACK:", 4) == 0) {
         Serial.print("ACK recu: ");
-        Serial.println(received);
-        pendingCmdActive = false;
-        pendingCmdFrame = "";
-        pendingCmdAttempts = 0;
-        if (mqttClient.connected()) {
-            mqttClient.publish(MQTT_TOPIC_ACK, received.c_str(), false);
+        Serial.println(text);
+        // "ACK:<noeud>:...": commande livree (la sienne ou une commande "*").
+        char name[16];
+        const char* start = text + 4;
+        const char* sep = (const char*)memchr(start, ':', len - 4);
+        size_t nameLen = (sep != NULL) ? (size_t)(sep - start) : len - 4;
+        NodeState* node = NULL;
+        if (nameLen < sizeof(name)) {
+            memcpy(name, start, nameLen);
+            name[nameLen] = '\0';
+            uint16_t nodeId = 0;
+            if (rucheParseNodeName(name, &nodeId)) node = nodes.find(nodeId);
+        }
+        DownlinkSlot* d = (node != NULL) ? pendingDownlinkFor(*node)
+                                         : (broadcastDownlink.active ? &broadcastDownlink : NULL);
+        if (d != NULL) d->reset();
+        if (netMqttUp) {
+            queueNetPublish(MQTT_TOPIC_ACK, text, false);
         }
         return;
     }
 
-    int idx = received.indexOf("POIDS_G:");
-    int offset = 8;
-    if (idx < 0) {
-        idx = received.indexOf("POIDS:");
-        offset = 6;
-    }
-    if (idx >= 0) {
-        lastWeight = received.substring(idx + offset).toFloat();
+    NodeState* node = nodeFor(LORA_LEGACY_NODE_NUM);
+    if (node == NULL) return;
+    // Champ absent ou illisible ("nan"): valeur precedente conservee.
+    RucheTextTelemetry tm;
+    rucheParseTextTelemetry(text, len, &tm);
+    if (tm.hasWeight) {
+        node->weightG = tm.weightG;
         Serial.print("Poids recu: ");
-        Serial.print(lastWeight, 2);
+        Serial.print(node->weightG, 2);
         Serial.println(" g");
     }
-    lastTempC = parseFieldValue(received, "T_C:", lastTempC);
-    lastHumPct = parseFieldValue(received, "H_P:", lastHumPct);
-    lastBattPct = parseFieldValue(received, "B_P:", lastBattPct);
-    weight_g = lastWeight;
-    temp_c = isnan(lastTempC) ? temp_c : lastTempC;
-    hum_pct = isnan(lastHumPct) ? hum_pct : lastHumPct;
-    batt_pct = (lastBattPct < 0.0f) ? batt_pct : lastBattPct;
-    rssi_dbm = (int)lastRSSI;
+    // Ancien firmware texte: toujours en reception.
+    node->listening = true;
+    {
+        DownlinkSlot* d = pendingDownlinkFor(*node);
+        if (d != NULL) transmitDownlink(*d);
+    }
+    if (tm.hasTemp) node->tempC = tm.tempC;
+    if (tm.hasHum) node->humPct = tm.humPct;
+    if (tm.hasBatt) node->battPct = tm.battPct;
+    noteNodeFrame(*node, -1, 0, now);
+    node->lastSeq = -1;
+    node->lastFlags = 0;
+    node->rssi = lastRSSI;
+    node->snr = lastSNR;
+    node->frames.received++;      // texte: pas de sequence
+    node->lastPacketMs = now;
+    lastNode = node;
     lastLoraPacketMs = now;
-    publishTelemetryMqtt(received);
+    updateNodeAlerts(*node);
+    mirrorCloudProperties(*node);
+    publishTelemetryMqtt(*node, text);
 
     Serial.print("Paquet #");
     Serial.print(packetCount);
     Serial.print(": ");
-    Serial.println(received);
+    Serial.println(text);
 
     updateDisplay();
 }
 
+// Filtre des doublons par sequence; false: trame deja traitee (ni ACK
+// ni publication).
+// Horloge des mesures en secondes, sans retour a zero de millis().
+uint32_t sampleClockS() {
+    return (uint32_t)(esp_timer_get_time() / 1000000LL);
+}
+
+// Une mesure du lot deja publiee? Apres un echec d'envoi (delai TX depasse
+// alors que la trame est partie...), l'emetteur renvoie ses mesures RTC
+// sous une nouvelle seq: seule leur date les reconnait. Les mesures d'un
+// noeud sont espacees d'un reveil au moins, bien plus que la tolerance.
+bool sampleAlreadyPublished(NodeState& node, uint32_t sampleS) {
+    if (node.sampleSeen && (int32_t)(sampleS - node.lastSampleS) <= (int32_t)SAMPLE_DEDUP_TOLERANCE_S) {
+        return true;
+    }
+    node.lastSampleS = sampleS;
+    node.sampleSeen = true;
+    return false;
+}
+
+bool acceptFrameSeq(NodeState& node, uint16_t seq, uint8_t flags) {
+    RucheSeqVerdict v = node.frames.accept(seq, (flags & RUCHE_FLAG_SEQ_RESET) != 0);
+    if (v == RUCHE_SEQ_DUPLICATE) {
+        Serial.print("Doublon ignore ");
+        Serial.print(node.name);
+        Serial.print(" seq=");
+        Serial.println(seq);
+        return false;
+    }
+    if (v == RUCHE_SEQ_LATE) {
+        Serial.print("Trame hors ordre ");
+        Serial.print(node.name);
+        Serial.print(" seq=");
+        Serial.println(seq);
+    }
+    return true;
+}
+
+void handleReceivedPacket(const uint8_t* data, size_t len, unsigned long now) {
+    if (!rucheIsBinaryFrame(data, len)) {
+        // Ancien format texte (noeuds non mis a jour, ACK).
+        char text[256];
+        size_t n = (len < sizeof(text) - 1) ? len : sizeof(text) - 1;
+        memcpy(text, data, n);
+        text[n] = '\0';
+        handleReceivedFrame(text, n, now);
+        return;
+    }
+
+    uint8_t version = rucheFrameVersion(data, len);
+    if (version != RUCHE_FRAME_VERSION) {
+        // Emetteur d'une autre generation: ses trames et nos ACK sont illisibles de part et d'autre.
+        RucheFrameHeader hdr;
+        memcpy(&hdr, data, sizeof(hdr));
+        char line[96];
+        snprintf(line, sizeof(line), "Trame binaire version %u de RUCHE%u ignoree (passerelle en version %u)",
+                 (unsigned)version, (unsigned)hdr.nodeId, (unsigned)RUCHE_FRAME_VERSION);
+        Serial.println(line);
+        return;
+    }
+
+    uint8_t type = rucheFrameType(data, len);
+    if (type == RUCHE_FRAME_TYPE_TELEMETRY) {
+        RucheTelemetry tm;
+        if (rucheDecodeTelemetry(data, len, &tm)) {
+            NodeState* node = nodeFor(tm.nodeId);
+            if (node == NULL || !acceptFrameSeq(*node, tm.seq, tm.flags)) return;
+            sendTelemetryAck(*node, tm.seq, tm.flags);
+            noteNodeFrame(*node, tm.seq, tm.flags, now);
+            sampleAlreadyPublished(*node, sampleClockS());   // date de reference seulement
+            // raw: trame de base seule, le bloc de statistiques part decode.
+            char hexRaw[2 * sizeof(RucheTelemetryFrame) + 1];
+            for (size_t i = 0; i < sizeof(RucheTelemetryFrame); i++) {
+                snprintf(&hexRaw[2 * i], 3, "%02X", data[i]);
+            }
+            applyBinaryTelemetry(*node, tm, 0, hexRaw, now);
+            return;
+        }
+    } else if (type == RUCHE_FRAME_TYPE_BATCH) {
+        RucheBatch batch;
+        if (rucheDecodeBatch(data, len, &batch)) {
+            NodeState* node = nodeFor(batch.nodeId);
+            if (node == NULL || !acceptFrameSeq(*node, batch.seq, batch.flags)) return;
+            sendTelemetryAck(*node, batch.seq, batch.flags);
+            noteNodeFrame(*node, batch.seq, batch.flags, now);
+            // Chaque mesure du lot est publiee avec son anciennete, sauf
+            // celles deja publiees par un envoi precedent.
+            uint32_t nowS = sampleClockS();
+            uint8_t resent = 0;
+            for (uint8_t i = 0; i < batch.count; i++) {
+                const RucheBatchEntry& e = batch.entries[i];
+                if (sampleAlreadyPublished(*node, nowS - e.ageS)) {
+                    resent++;
+                    continue;
+                }
+                RucheTelemetry tm;
+                tm.nodeId = batch.nodeId;
+                tm.seq = batch.seq;
+                tm.weightG = e.weightG;
+                tm.tempC = e.tempC;
+                tm.humPct = e.humPct;
+                tm.battPct = batch.battPct;
+                tm.flags = batch.flags;
+                // Statistiques de l'intervalle: une fois, avec la mesure la plus recente.
+                if (i + 1 < batch.count) {
+                    tm.flags &= (uint8_t)~RUCHE_FLAG_STATS;
+                } else {
+                    tm.stats = batch.stats;
+                }
+                char rawTag[32];
+                snprintf(rawTag, sizeof(rawTag), "BATCH:%u:%u/%u", (unsigned)batch.seq,
+                         (unsigned)(i + 1), (unsigned)batch.count);
+                applyBinaryTelemetry(*node, tm, e.ageS, rawTag, now);
+            }
+            if (resent > 0) {
+                Serial.print("Mesures deja publiees ignorees ");
+                Serial.print(node->name);
+                Serial.print(": ");
+                Serial.println(resent);
+            }
+            return;
+        }
+    }
+
+    Serial.print("Trame binaire invalide, taille=");
+    Serial.println((unsigned)len);
+}
+
+void applyBinaryTelemetry(NodeState& node, const RucheTelemetry& tm, uint32_t ageS, const char* raw, unsigned long now) {
+    setOledSleep(false);
+    node.lastSeq = tm.seq;
+    node.lastFlags = tm.flags;
+    node.weightG = tm.weightG;
+    if (!isnan(tm.tempC)) node.tempC = tm.tempC;
+    if (!isnan(tm.humPct)) node.humPct = tm.humPct;
+    if (tm.battPct >= 0) node.battPct = (float)tm.battPct;
+    node.rssi = lastRSSI;
+    node.snr = lastSNR;
+    node.lastPacketMs = now;
+    lastNode = &node;
+    lastLoraPacketMs = now;
+    updateNodeAlerts(node);
+    mirrorCloudProperties(node);
+    publishTelemetryMqtt(node, raw, ageS, (tm.flags & RUCHE_FLAG_STATS) ? &tm.stats : NULL);
+
+    Serial.print("Paquet #");
+    Serial.print(packetCount);
+    Serial.print(" ");
+    Serial.print(node.name);
+    Serial.print(" seq=");
+    Serial.print(tm.seq);
+    Serial.print(" age=");
+    Serial.print(ageS);
+    Serial.print("s poids=");
+    Serial.print(node.weightG, 2);
+    Serial.print(" g flags=0x");
+    Serial.print(tm.flags, HEX);
+    Serial.println((tm.flags & RUCHE_FLAG_HEARTBEAT) ? " (inchange, battement)" : "");
+
+    updateDisplay();
+}
+
+// taskRadio: trame recue copiee sur place dans une case de rxFrames.
+void radioReadFrame() {
+    RxFrameSlot* slot = rxFrames.claim();
+    if (slot == NULL) {
+        // loop() en retard: trame perdue (comptee par la file).
+        return;
+    }
+    size_t len = radio.getPacketLength();
+    if (len > RX_FRAME_MAX) len = RX_FRAME_MAX;
+    if (radio.readData(slot->data, len) != RADIOLIB_ERR_NONE) return;
+    slot->len = (uint16_t)len;
+    slot->rssi = (int16_t)radio.getRSSI();
+    slot->snr = radio.getSNR();
+    slot->rxMs = millis();
+    rxFrames.publish();
+    if (loopTaskHandle != NULL) xTaskNotifyGive(loopTaskHandle);
+}
+
+// taskRadio: une emission en file, puis retour en reception.
+bool radioTransmit(RadioTxRequest& req) {
+    if (req.delayMs > 0) vTaskDelay(pdMS_TO_TICKS(req.delayMs));
+    int state = RADIOLIB_ERR_NONE;
+    if (req.len > 0) {
+        RucheAck ack;
+        if (req.stampAck && rucheDecodeAck(req.data, req.len, &ack)) {
+            // Horodatage au plus pres du debut d'emission: l'emetteur
+            // compense seulement le temps d'antenne de l'ACK.
+            ack.cyclePosMs = tdmaCyclePosMs();
+            rucheEncodeAck(ack, req.data, sizeof(req.data));
+        }
+        state = radio.transmit(req.data, req.len);
+        if (state != RADIOLIB_ERR_NONE) {
+            Serial.print("Erreur emission LoRa: ");
+            Serial.println(state);
+        }
+    }
+    if (req.setSf != 0) {
+        radio.standby();
+        radio.setSpreadingFactor(req.setSf);
+        Serial.print("ADR: reception en SF");
+        Serial.println(req.setSf);
+    }
+    radio_receiveMode = false;
+    ensureReceiveMode();
+    return state == RADIOLIB_ERR_NONE;
+}
+
+void taskRadio(void* pv) {
+    (void)pv;
+    bool lastTxOk = true;
+    for (;;) {
+        uint32_t events = 0;
+        xTaskNotifyWait(0, 0xFFFFFFFF, &events, pdMS_TO_TICKS(RADIO_RX_CHECK_MS));
+
+        // RX_DONE lu a chaque reveil: couvre aussi une interruption manquee.
+        int irq = radio.getIrqStatus();
+        if (irq > 0 && (irq & RADIOLIB_SX126X_IRQ_RX_DONE)) {
+            radioReadFrame();
+            radio_receiveMode = false;
+        }
+        ensureReceiveMode();
+
+        RadioTxRequest req;
+        while (xQueueReceive(radioTxQueue, &req, 0) == pdTRUE) {
+            if (req.afterPrevious && !lastTxOk) continue;
+            lastTxOk = radioTransmit(req);
+        }
+    }
+}
+
+// taskNetwork
 void ensureMqtt() {
     if (mqttClient.connected()) {
         if (!mqttInfoPrinted) {
@@ -530,8 +1434,9 @@ void ensureMqtt() {
     lastMqttTryMs = now;
 
     mqttClient.setServer(MQTT_HOST, MQTT_PORT);
-    String clientId = "ruches-rx-" + String((uint32_t)ESP.getEfuseMac(), HEX);
-    bool ok = mqttClient.connect(clientId.c_str());
+    char clientId[24];
+    snprintf(clientId, sizeof(clientId), "ruches-rx-%lx", (unsigned long)(uint32_t)ESP.getEfuseMac());
+    bool ok = mqttClient.connect(clientId);
     if (ok) {
         Serial.print("MQTT connecte sur ");
         Serial.print(MQTT_HOST);
@@ -546,30 +1451,518 @@ void ensureMqtt() {
     }
 }
 
-void publishTelemetryMqtt(const String& rawPayload) {
-    if (!mqttClient.connected()) return;
+// Publication confiee a taskNetwork; false (et comptee) si la file est
+// pleine, le reseau etant bloque.
+bool queueNetPublish(const char* topic, const char* payload, bool retain) {
+    NetPublish msg;
+    size_t topicLen = strlen(topic);
+    size_t payloadLen = strlen(payload);
+    if (topicLen >= sizeof(msg.topic) || payloadLen >= sizeof(msg.payload)) return false;
+    memcpy(msg.topic, topic, topicLen + 1);
+    memcpy(msg.payload, payload, payloadLen + 1);
+    msg.retain = retain;
+    if (xQueueSend(netOutQueue, &msg, 0) != pdTRUE) {
+        netDropped++;
+        return false;
+    }
+    return true;
+}
+
+// loop(): instantane du noeud pour taskNetwork, qui le publie ou le
+// stocke si le broker est injoignable.
+void publishTelemetryMqtt(const NodeState& node, const char* raw, uint32_t ageS,
+                          const RucheIntervalStats* stats) {
+    TelemetryRecord rec;
+    memset(&rec, 0, sizeof(rec));          // octets de remplissage fixes en flash
+    time_t t = time(NULL);
+    rec.epochS = (t > NTP_VALID_EPOCH) ? (uint32_t)t : 0;
+    rec.uptimeMs = millis();
+    rec.bootId = storeBootId;
+    rec.nodeId = node.nodeId;
+    rec.seq = node.lastSeq;
+    rec.packet = node.frames.received;
+    rec.lost = node.frames.lost;
+    rec.duplicates = node.frames.duplicates;
+    rec.outOfOrder = node.frames.outOfOrder;
+    rec.resyncs = node.frames.resyncs;
+    rec.lastLoraS = (node.lastPacketMs == 0) ? 0 : (rec.uptimeMs - node.lastPacketMs) / 1000UL;
+    rec.ageS = ageS;
+    rec.weightG = node.weightG;
+    rec.tempC = node.tempC;
+    rec.humPct = node.humPct;
+    rec.battPct = node.battPct;
+    rec.snr = node.snr;
+    rec.perPct = node.frames.perPct();
+    rec.rssi = node.rssi;
+    rec.txDbm = node.adrSetting.powerDbm;
+    rec.sf = rxSpreadingFactor;
+    rec.flags = (node.alertSignalLost ? TLM_FLAG_SIGNAL_LOST : 0) |
+                (node.alertBatteryLow ? TLM_FLAG_BATT_LOW : 0) |
+                ((node.lastFlags & RUCHE_FLAG_HEARTBEAT) ? TLM_FLAG_UNCHANGED : 0);
+    if (stats != NULL) {
+        rucheEncodeStats(*stats, &rec.stats);
+        rec.flags |= TLM_FLAG_STATS;
+    }
+    strncpy(rec.raw, raw, sizeof(rec.raw) - 1);
+    if (xQueueSend(netTelemetryQueue, &rec, 0) != pdTRUE) {
+        netDropped++;
+    }
+}
+
+// taskNetwork: anciennete a la publication, l'attente en stockage
+// comprise. Heure UTC si connue des deux cotes, sinon millis() du meme
+// demarrage; autrement l'attente est ignoree.
+uint32_t telemetryAgeS(const TelemetryRecord& rec) {
+    time_t t = time(NULL);
+    if (rec.epochS != 0 && t > NTP_VALID_EPOCH && (uint32_t)t >= rec.epochS) {
+        return rec.ageS + ((uint32_t)t - rec.epochS);
+    }
+    if (rec.bootId == storeBootId) {
+        return rec.ageS + (millis() - rec.uptimeMs) / 1000UL;
+    }
+    return rec.ageS;
+}
 
-    char json[320];
-    unsigned long lastLoraAgeSec = (lastLoraPacketMs == 0) ? 0 : (millis() - lastLoraPacketMs) / 1000UL;
+// taskNetwork: statistiques de l'intervalle ajoutees au JSON de longueur
+// n, grandeurs sans mesure omises. Retourne la nouvelle longueur (>= size
+// si le tampon est trop petit).
+int appendStatsJson(char* json, size_t n, size_t size, const RucheStatsBlock& block) {
+    RucheIntervalStats st;
+    rucheDecodeStats(block, &st);
+    n += snprintf(json + n, size - n, ",\"stat_span_s\":%lu", (unsigned long)st.spanS);
+    const char* const prefixes[] = {"w", "t", "h"};
+    const RucheStatField* fields[] = {&st.weight, &st.temp, &st.hum};
+    for (uint8_t i = 0; i < 3 && n < size; i++) {
+        const RucheStatField& f = *fields[i];
+        if (f.count == 0) continue;
+        const char* p = prefixes[i];
+        n += snprintf(json + n, size - n,
+                      ",\"%s_n\":%u,\"%s_mean\":%.2f,\"%s_min\":%.2f,\"%s_max\":%.2f,\"%s_sd\":%.2f",
+                      p, (unsigned)f.count, p, f.mean, p, f.min, p, f.max, p, f.stddev);
+    }
+    return (int)n;
+}
+
+// taskNetwork. Une sous-rubrique par noeud: "ruches/telemetry/RUCHE12",
+// retenue pour la derniere valeur seulement (pas pour un rejeu).
+bool publishTelemetryRecord(const TelemetryRecord& rec, bool replay) {
+    char name[16];
+    rucheFormatNodeName(rec.nodeId, name, sizeof(name));
+    char topic[48];
+    snprintf(topic, sizeof(topic), "%s/%s", MQTT_TOPIC_TELEMETRY, name);
+    static char json[896];
     int n = snprintf(
         json,
         sizeof(json),
-        "{\"packet\":%lu,\"weight_g\":%.2f,\"temp_c\":%.1f,\"hum_pct\":%.1f,\"batt_pct\":%.0f,\"rssi\":%d,\"rssi_dbm\":%d,\"alert_signal_lost\":%d,\"alert_batt_low\":%d,\"last_lora_s\":%lu,\"raw\":\"%s\"}",
-        (unsigned long)packetCount,
-        lastWeight,
-        isnan(lastTempC) ? -999.0f : lastTempC,
-        isnan(lastHumPct) ? -999.0f : lastHumPct,
-        (lastBattPct < 0.0f) ? -1.0f : lastBattPct,
-        (int)lastRSSI,
-        (int)lastRSSI,
-        alertSignalLost ? 1 : 0,
-        alertBatteryLow ? 1 : 0,
-        lastLoraAgeSec,
-        rawPayload.c_str()
+        "{\"packet\":%lu,\"node\":\"%s\",\"seq\":%ld,\"weight_g\":%.2f,\"temp_c\":%.1f,\"hum_pct\":%.1f,\"batt_pct\":%.0f,\"rssi\":%d,\"rssi_dbm\":%d,\"snr_db\":%.1f,\"sf\":%u,\"tx_dbm\":%d,\"alert_signal_lost\":%d,\"alert_batt_low\":%d,\"last_lora_s\":%lu,\"age_s\":%lu,\"unchanged\":%d,\"lost\":%lu,\"dup\":%lu,\"ooo\":%lu,\"resync\":%lu,\"per_pct\":%.1f,\"replay\":%d,\"raw\":\"%s\"",
+        (unsigned long)rec.packet,
+        name,
+        (long)rec.seq,
+        rec.weightG,
+        isnan(rec.tempC) ? -999.0f : rec.tempC,
+        isnan(rec.humPct) ? -999.0f : rec.humPct,
+        (rec.battPct < 0.0f) ? -1.0f : rec.battPct,
+        (int)rec.rssi,
+        (int)rec.rssi,
+        rec.snr,
+        (unsigned)rec.sf,
+        (int)rec.txDbm,
+        (rec.flags & TLM_FLAG_SIGNAL_LOST) ? 1 : 0,
+        (rec.flags & TLM_FLAG_BATT_LOW) ? 1 : 0,
+        (unsigned long)rec.lastLoraS,
+        (unsigned long)telemetryAgeS(rec),
+        (rec.flags & TLM_FLAG_UNCHANGED) ? 1 : 0,
+        (unsigned long)rec.lost,
+        (unsigned long)rec.duplicates,
+        (unsigned long)rec.outOfOrder,
+        (unsigned long)rec.resyncs,
+        rec.perPct,
+        replay ? 1 : 0,
+        rec.raw
     );
-    if (n <= 0 || n >= (int)sizeof(json)) return;
+    if (n > 0 && n < (int)sizeof(json) && (rec.flags & TLM_FLAG_STATS)) {
+        n = appendStatsJson(json, (size_t)n, sizeof(json), rec.stats);
+    }
+    if (n <= 0 || n >= (int)sizeof(json) - 1) return true;  // jamais publiable: abandonne
+    json[n++] = '}';
+    json[n] = '\0';
+
+    return mqttClient.publish(topic, json, !replay);
+}
+
+// taskNetwork. {"v":1,"replay":b,"k":[colonnes],"r":[[valeurs],...]},
+// valeur absente = nil; non retenu (plusieurs ruches par message).
+bool publishTelemetryPacked(const TelemetryRecord* recs, uint8_t n, bool replay) {
+    static uint8_t buf[MQTT_BATCH_BUF];
+    MsgPackWriter w;
+    w.begin(buf, sizeof(buf));
+    w.mapHeader(4);
+    w.str("v");
+    w.uint(1);
+    w.str("replay");
+    w.boolean(replay);
+    w.str("k");
+    w.arrayHeader(PACK_KEY_COUNT);
+    for (uint8_t i = 0; i < PACK_KEY_COUNT; i++) {
+        w.str(PACK_KEYS[i]);
+    }
+    w.str("r");
+    w.arrayHeader(n);
+    for (uint8_t i = 0; i < n; i++) {
+        const TelemetryRecord& r = recs[i];
+        w.arrayHeader(PACK_KEY_COUNT);
+        w.uint(r.nodeId);
+        w.sint(r.seq);
+        w.uint(telemetryAgeS(r));
+        w.f32(r.weightG);
+        w.f32(r.tempC);
+        w.f32(r.humPct);
+        w.f32((r.battPct < 0.0f) ? NAN : r.battPct);
+        w.sint(r.rssi);
+        w.f32(r.snr);
+        w.uint(r.sf);
+        w.sint(r.txDbm);
+        w.boolean((r.flags & TLM_FLAG_SIGNAL_LOST) != 0);
+        w.boolean((r.flags & TLM_FLAG_BATT_LOW) != 0);
+        w.boolean((r.flags & TLM_FLAG_UNCHANGED) != 0);
+        w.uint(r.packet);
+        w.uint(r.lost);
+        w.uint(r.duplicates);
+        w.uint(r.outOfOrder);
+        w.uint(r.resyncs);
+        w.f32(r.perPct);
+        RucheIntervalStats st;
+        if (r.flags & TLM_FLAG_STATS) {
+            rucheDecodeStats(r.stats, &st);
+            w.uint(st.spanS);
+        } else {
+            memset(&st, 0, sizeof(st));
+            w.nil();
+        }
+        const RucheStatField* fields[] = {&st.weight, &st.temp, &st.hum};
+        for (uint8_t k = 0; k < 3; k++) {
+            const RucheStatField& f = *fields[k];
+            if (f.count == 0) {
+                for (uint8_t j = 0; j < 5; j++) w.nil();
+                continue;
+            }
+            w.uint(f.count);
+            w.f32(f.mean);
+            w.f32(f.min);
+            w.f32(f.max);
+            w.f32(f.stddev);
+        }
+    }
+    if (!w.ok()) return true;                               // jamais publiable: abandonne
+
+    // Publication en flux: le lot ne passe pas par le tampon PubSubClient.
+    if (!mqttClient.beginPublish(MQTT_TOPIC_BATCH, w.len, false)) return false;
+    size_t written = mqttClient.write(buf, w.len);
+    return mqttClient.endPublish() && written == w.len;
+}
+
+bool publishTelemetry(const TelemetryRecord* recs, uint8_t n, bool replay) {
+    if (MQTT_UPLINK_MSGPACK) {
+        return publishTelemetryPacked(recs, n, replay);
+    }
+    for (uint8_t i = 0; i < n; i++) {
+        if (!publishTelemetryRecord(recs[i], replay)) return false;
+    }
+    return true;
+}
+
+void segmentPath(uint32_t segment, char* out, size_t outSize) {
+    snprintf(out, outSize, "/tlm_%08lu", (unsigned long)segment);
+}
+
+bool storeWriteMeta() {
+    File f = LittleFS.open(STORE_META_PATH, "w");
+    if (!f) return false;
+    size_t n = f.write((const uint8_t*)&storeMeta, sizeof(storeMeta));
+    f.close();
+    return n == sizeof(storeMeta);
+}
+
+// setup(), avant les taches: file RAM, journal existant, nouveau
+// numero de demarrage.
+void storeInit() {
+    uint32_t cap = STORE_RAM_RECORDS_HEAP;
+    TelemetryRecord* buf = NULL;
+    if (ESP.psramFound()) {
+        buf = (TelemetryRecord*)ps_malloc(STORE_RAM_RECORDS_PSRAM * sizeof(TelemetryRecord));
+        if (buf != NULL) cap = STORE_RAM_RECORDS_PSRAM;
+    }
+    if (buf == NULL) {
+        buf = (TelemetryRecord*)malloc(cap * sizeof(TelemetryRecord));
+    }
+    storeRam.attach(buf, cap);
+    replayBucket.reset();
+
+    memset(&storeMeta, 0, sizeof(storeMeta));
+    storeFlashOk = LittleFS.begin(true);
+    if (storeFlashOk) {
+        File f = LittleFS.open(STORE_META_PATH, "r");
+        if (f) {
+            if (f.read((uint8_t*)&storeMeta, sizeof(storeMeta)) != sizeof(storeMeta)) {
+                memset(&storeMeta, 0, sizeof(storeMeta));
+            }
+            f.close();
+        }
+        if (storeMeta.magic == STORE_META_MAGIC && storeMeta.recordSize != sizeof(TelemetryRecord)) {
+            // Autre format d'enregistrement (mise a jour): illisible.
+            char path[24];
+            for (uint32_t seg = storeMeta.firstSegment; seg != storeMeta.nextSegment; seg++) {
+                segmentPath(seg, path, sizeof(path));
+                LittleFS.remove(path);
+            }
+            storeMeta.magic = 0;
+        }
+        if (storeMeta.magic != STORE_META_MAGIC) {
+            uint16_t bootId = storeMeta.bootId;
+            memset(&storeMeta, 0, sizeof(storeMeta));
+            storeMeta.magic = STORE_META_MAGIC;
+            storeMeta.recordSize = sizeof(TelemetryRecord);
+            storeMeta.bootId = bootId;
+        }
+    }
+    storeMeta.bootId++;
+    storeBootId = storeMeta.bootId;
+    if (storeFlashOk) {
+        storeFlashOk = storeWriteMeta();
+    }
+
+    Serial.print("Stockage differe: ");
+    Serial.print(cap);
+    Serial.print(cap == STORE_RAM_RECORDS_PSRAM ? " en PSRAM, " : " en RAM interne, ");
+    if (storeFlashOk) {
+        Serial.print(storeMeta.nextSegment - storeMeta.firstSegment);
+        Serial.println(" segment(s) en flash");
+        if (LittleFS.totalBytes() < STORE_MAX_SEGMENTS * STORE_SEGMENT_FLASH_BYTES) {
+            // Autre table de partitions: le journal remplira la flash avant STORE_MAX_SEGMENTS.
+            Serial.print("Attention: partition LittleFS de ");
+            Serial.print((unsigned long)(LittleFS.totalBytes() / 1024));
+            Serial.println(" ko, journal plus petit que prevu");
+        }
+    } else {
+        Serial.println("flash indisponible");
+    }
+}
+
+// Ferme et efface le segment le plus ancien. Efface avant la fin du
+// rejeu (journal plein): le reste est compte perdu.
+void storeRemoveOldestSegment(bool countLost) {
+    char path[24];
+    segmentPath(storeMeta.firstSegment, path, sizeof(path));
+    if (countLost) {
+        uint32_t size = 0;
+        if (replayOpen) {
+            size = replayFile.size();
+        } else {
+            File f = LittleFS.open(path, "r");
+            if (f) {
+                size = f.size();
+                f.close();
+            }
+        }
+        uint32_t done = replayOpen ? replayOffset : 0;
+        if (size > done) {
+            storeFlashDropped += (size - done) / sizeof(TelemetryRecord);
+        }
+    }
+    if (replayOpen) {
+        replayFile.close();
+        replayOpen = false;
+    }
+    replayOffset = 0;
+    LittleFS.remove(path);
+    storeMeta.firstSegment++;
+    storeWriteMeta();
+}
+
+// Plus anciens enregistrements en RAM -> un nouveau segment.
+bool storeSpill(uint32_t maxRecords) {
+    if (!storeFlashOk || storeRam.empty()) return false;
+    uint32_t n = (storeRam.count < maxRecords) ? storeRam.count : maxRecords;
+    if (storeMeta.nextSegment - storeMeta.firstSegment >= STORE_MAX_SEGMENTS) {
+        storeRemoveOldestSegment(true);
+    }
+    char path[24];
+    segmentPath(storeMeta.nextSegment, path, sizeof(path));
+    File f = LittleFS.open(path, "w");
+    if (!f) return false;
+    size_t written = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        written += f.write((const uint8_t*)&storeRam.at(i), sizeof(TelemetryRecord));
+    }
+    f.close();
+    if (written != n * sizeof(TelemetryRecord)) {
+        LittleFS.remove(path);
+        return false;
+    }
+    storeMeta.nextSegment++;
+    storeWriteMeta();
+    storeRam.dropFront(n);
+    storeSpilled += n;
+    return true;
+}
+
+void storeSpillAll() {
+    while (!storeRam.empty() && storeSpill(STORE_SEGMENT_RECORDS)) {
+    }
+}
+
+void storeEnqueue(const TelemetryRecord& rec) {
+    // Pleine: le plus ancien part en flash plutot que d'etre ecrase.
+    if (storeRam.full()) {
+        storeSpill(STORE_SEGMENT_RECORDS);
+    }
+    storeRam.push(rec);
+}
+
+// Jusqu'a maxRecords enregistrements suivants du segment le plus ancien;
+// 0 si le journal est vide.
+uint32_t storeReadFlash(TelemetryRecord* out, uint32_t maxRecords) {
+    while (storeMeta.firstSegment != storeMeta.nextSegment) {
+        if (!replayOpen) {
+            char path[24];
+            segmentPath(storeMeta.firstSegment, path, sizeof(path));
+            replayFile = LittleFS.open(path, "r");
+            if (!replayFile) {
+                storeRemoveOldestSegment(false);
+                continue;
+            }
+            replayOpen = true;
+            replayOffset = 0;
+        }
+        uint32_t size = replayFile.size();
+        uint32_t avail = (size > replayOffset) ? (size - replayOffset) / sizeof(TelemetryRecord) : 0;
+        if (avail > 0 && replayFile.seek(replayOffset)) {
+            uint32_t n = (avail < maxRecords) ? avail : maxRecords;
+            size_t bytes = n * sizeof(TelemetryRecord);
+            if (replayFile.read((uint8_t*)out, bytes) == bytes) return n;
+        }
+        // Segment rejoue (ou fin tronquee par une coupure): efface.
+        storeRemoveOldestSegment(false);
+    }
+    return 0;
+}
 
-    mqttClient.publish(MQTT_TOPIC_TELEMETRY, json, true);
+// Broker joignable: rejoue le journal puis la RAM. Un jeton par
+// publication (une mesure en JSON, un lot en MessagePack).
+void storeDrain(unsigned long now) {
+    replayBucket.refill(now, REPLAY_RATE_PER_S, REPLAY_BURST);
+    while (replayBucket.available() > 0) {
+        uint32_t n = storeFlashOk ? storeReadFlash(replayBatch, MQTT_BATCH_RECORDS) : 0;
+        bool fromFlash = n > 0;
+        if (!fromFlash) {
+            n = (storeRam.count < MQTT_BATCH_RECORDS) ? storeRam.count : MQTT_BATCH_RECORDS;
+            if (n == 0) return;
+            for (uint32_t i = 0; i < n; i++) {
+                replayBatch[i] = storeRam.at(i);
+            }
+        }
+        if (!publishTelemetry(replayBatch, (uint8_t)n, true)) return;     // reessaye plus tard
+        replayBucket.take();
+        storeReplayed += n;
+        if (fromFlash) {
+            replayOffset += n * sizeof(TelemetryRecord);
+        } else {
+            storeRam.dropFront(n);
+        }
+    }
+}
+
+// Lot en cours publie, ou stocke si le broker est injoignable.
+void flushLiveBatch(bool connected) {
+    if (liveBatchCount == 0) return;
+    if (!connected || !publishTelemetry(liveBatch, liveBatchCount, false)) {
+        for (uint8_t i = 0; i < liveBatchCount; i++) {
+            storeEnqueue(liveBatch[i]);
+        }
+    }
+    liveBatchCount = 0;
+}
+
+// Deverse vers la flash avant que la RAM deborde et, broker absent,
+// quand l'attente depasse STORE_SPILL_AGE_MS (coupure secteur).
+void storeMaintain(unsigned long now, bool connected) {
+    if (storeRam.nearlyFull(STORE_SEGMENT_RECORDS)) {
+        storeSpill(STORE_SEGMENT_RECORDS);
+    } else if (!connected && !storeRam.empty() && (now - storeRam.front().uptimeMs) > STORE_SPILL_AGE_MS) {
+        storeSpillAll();
+    }
+}
+
+void taskNetwork(void* pv) {
+    (void)pv;
+    static NetPublish msg;             // 560 o: hors de la pile
+    for (;;) {
+        unsigned long now = millis();
+        ensureWiFiConnection();
+
+        CloudSnapshot snap;
+        if (xQueueReceive(netCloudSlot, &snap, 0) == pdTRUE) {
+            applyCloudSnapshot(snap);
+        }
+        if (cloudEnabled) {
+            ArduinoCloud.update();
+        }
+        ensureMqtt();
+        mqttClient.loop();
+        bool connected = mqttClient.connected();
+        netMqttUp = connected;
+
+        // Alertes et echos d'ACK: perdus si deconnecte, comme avant.
+        while (xQueueReceive(netOutQueue, &msg, 0) == pdTRUE) {
+            if (connected) {
+                mqttClient.publish(msg.topic, msg.payload, msg.retain);
+            }
+        }
+
+        // Telemetrie: en direct (par lots), sinon stockee puis rejouee.
+        TelemetryRecord rec;
+        while (xQueueReceive(netTelemetryQueue, &rec, 0) == pdTRUE) {
+            if (liveBatchCount == 0) liveBatchStartMs = now;
+            liveBatch[liveBatchCount++] = rec;
+            if (liveBatchCount >= MQTT_BATCH_RECORDS || !connected) {
+                flushLiveBatch(connected);
+            }
+        }
+        if (liveBatchCount > 0 && (now - liveBatchStartMs) >= MQTT_BATCH_MAX_MS) {
+            flushLiveBatch(connected);
+        }
+        if (connected) {
+            storeDrain(now);
+        }
+        storeMaintain(now, connected);
+
+        if (WiFi.status() == WL_CONNECTED && !wifiInfoPrinted) {
+            Serial.print("WiFi OK IP=");
+            Serial.print(WiFi.localIP());
+            Serial.print(" RSSI=");
+            Serial.println(WiFi.RSSI());
+            wifiInfoPrinted = true;
+            if (!ntpStarted) {
+                // Heure UTC des enregistrements stockes (SNTP en tache de fond).
+                configTime(0, 0, "pool.ntp.org", "time.google.com");
+                ntpStarted = true;
+            }
+        } else if (WiFi.status() != WL_CONNECTED) {
+            wifiInfoPrinted = false;
+        }
+
+        if (WiFi.status() == WL_CONNECTED && mqttClient.connected()) {
+            lastHealthyNetworkMs = now;
+        }
+        if (lastHealthyNetworkMs > 0 && (now - lastHealthyNetworkMs) > NETWORK_STALL_RESTART_MS) {
+            Serial.println("Redemarrage securite reseau (stall > 5 min)...");
+            flushLiveBatch(false);
+            storeSpillAll();
+            delay(100);
+            ESP.restart();
+        }
+        vTaskDelay(pdMS_TO_TICKS(NET_IDLE_MS));
+    }
 }
 
 // ===== Initialisation LoRa =====
@@ -599,7 +1992,7 @@ bool initLoRa() {
         
         Serial.println("   Frequence: 868.000 MHz");
         
-        radio.setDio1Action(setFlag);
+        radio.setDio1Action(onRadioDio1);
         
         state = radio.startReceive();
         if (state == RADIOLIB_ERR_NONE) {
@@ -646,6 +2039,13 @@ void setup() {
     }
     mqttClient.setServer(MQTT_HOST, MQTT_PORT);
     mqttClient.setCallback(mqttCallback);
+    // Le JSON de telemetrie depasse le tampon PubSubClient par defaut (256 o).
+    mqttClient.setBufferSize(1024);
+    Serial.println(MQTT_UPLINK_MSGPACK ? "Telemetrie MQTT: lots MessagePack" : "Telemetrie MQTT: JSON par mesure");
+    nodes.reset();
+    livenessWheel.reset(livenessTickNow());
+    broadcastDownlink.reset();
+    storeInit();
     
     oled_working = initOLED();
     delay(500);
@@ -659,6 +2059,21 @@ void setup() {
             delay(100);
         }
     }
+
+    // Reception prioritaire sur le meme coeur que loop(): la trame est
+    // sortie du SX1262 avant toute publication reseau.
+    loopTaskHandle = xTaskGetCurrentTaskHandle();
+    radioTxQueue = xQueueCreate(RADIO_TX_QUEUE_LEN, sizeof(RadioTxRequest));
+    xTaskCreatePinnedToCore(taskRadio, "task_radio", 4096, NULL, 4, &radioTaskHandle, 1);
+
+    // Reseau seul sur le coeur 0 (avec la pile WiFi): pas dans le
+    // chien de garde, une panne reseau est geree par le redemarrage
+    // de securite apres NETWORK_STALL_RESTART_MS.
+    netOutQueue = xQueueCreate(NET_OUT_QUEUE_LEN, sizeof(NetPublish));
+    netTelemetryQueue = xQueueCreate(NET_TELEMETRY_QUEUE_LEN, sizeof(TelemetryRecord));
+    netCommandQueue = xQueueCreate(NET_COMMAND_QUEUE_LEN, sizeof(NetCommand));
+    netCloudSlot = xQueueCreate(1, sizeof(CloudSnapshot));
+    xTaskCreatePinnedToCore(taskNetwork, "task_network", 8192, NULL, 1, &networkTaskHandle, 0);
     
     Serial.println("\n=== EN ATTENTE ===");
     Serial.println("Commandes serie: tare | cal:500 | help");
@@ -671,127 +2086,65 @@ void loop() {
     unsigned long now = millis();
     esp_task_wdt_reset();
 
-    ensureWiFiConnection();
-    updateAlertStates(now);
-
-    if (cloudEnabled) {
-        ArduinoCloud.update();
-    }
-    ensureMqtt();
-    mqttClient.loop();
-    if (WiFi.status() == WL_CONNECTED && !wifiInfoPrinted) {
-        Serial.print("WiFi OK IP=");
-        Serial.print(WiFi.localIP());
-        Serial.print(" RSSI=");
-        Serial.println(WiFi.RSSI());
-        wifiInfoPrinted = true;
-    } else if (WiFi.status() != WL_CONNECTED) {
-        wifiInfoPrinted = false;
-    }
-
-    if (WiFi.status() == WL_CONNECTED && mqttClient.connected()) {
-        lastHealthyNetworkMs = now;
-    }
-    if (lastHealthyNetworkMs > 0 && (now - lastHealthyNetworkMs) > NETWORK_STALL_RESTART_MS) {
-        Serial.println("Redemarrage securite reseau (stall > 5 min)...");
-        delay(100);
-        ESP.restart();
-    }
+    advanceLiveness(now);
     
     while (Serial.available() > 0) {
         char ch = Serial.read();
         if (ch == '\n' || ch == '\r') {
-            if (serialLine.length() > 0) {
-                processLocalCommand(serialLine);
-                serialLine = "";
+            if (serialLineLen > 0) {
+                serialLine[serialLineLen] = '\0';
+                processLocalCommand(serialLine, serialLineLen);
+                serialLineLen = 0;
             }
-        } else if (isPrintable(ch) && serialLine.length() < 64) {
-            serialLine += ch;
+        } else if (isPrintable(ch) && serialLineLen < sizeof(serialLine) - 1) {
+            serialLine[serialLineLen++] = ch;
         }
     }
 
-    if (pendingCmdActive) {
-        if (pendingCmdAttempts == 0 || (now - pendingCmdLastTxMs) >= COMMAND_RETRY_MS) {
-            bool ok = sendLoRaFrame(pendingCmdFrame);
-            pendingCmdLastTxMs = now;
-            pendingCmdAttempts++;
-            if (ok) {
-                Serial.print("Commande en attente ACK, tentative ");
-                Serial.print(pendingCmdAttempts);
-                Serial.print("/");
-                Serial.println(COMMAND_MAX_ATTEMPTS);
-            }
-            if (pendingCmdAttempts >= COMMAND_MAX_ATTEMPTS) {
-                Serial.println("Commande abandonnee: aucun ACK");
-                pendingCmdActive = false;
-                pendingCmdFrame = "";
-                pendingCmdAttempts = 0;
-            }
-        }
+    // Trames deposees par taskRadio, lues sur place.
+    RxFrameSlot* rx;
+    while ((rx = rxFrames.peek()) != NULL) {
+        packetCount++;
+        lastRSSI = rx->rssi;
+        lastSNR = rx->snr;
+        handleReceivedPacket(rx->data, rx->len, rx->rxMs);
+        rxFrames.consume();
     }
 
-    // POLLING toutes les 100ms
-    if (now - lastReceiveCheck > 100) {
-        lastReceiveCheck = now;
-        
-        // Via interruption
-        if (receivedFlag) {
-            receivedFlag = false;
-            
-            String received;
-            int state = radio.readData(received);
-            
-            if (state == RADIOLIB_ERR_NONE) {
-                packetCount++;
-                lastRSSI = radio.getRSSI();
-                handleReceivedFrame(received, now);
-            }
-            
-            radio_receiveMode = false;
-            ensureReceiveMode();
-        }
-        
-        // Polling direct
-        int irq = radio.getIrqStatus();
-        if (irq > 0) {
-            if (irq & RADIOLIB_SX126X_IRQ_RX_DONE) {
-                String received;
-                int state = radio.readData(received);
-                
-                if (state == RADIOLIB_ERR_NONE) {
-                    packetCount++;
-                    lastRSSI = radio.getRSSI();
-                    handleReceivedFrame(received, now);
-                }
-                
-                radio_receiveMode = false;
-                ensureReceiveMode();
-            }
-        }
+    NetCommand cmd;
+    while (xQueueReceive(netCommandQueue, &cmd, 0) == pdTRUE) {
+        handleMqttCommand(cmd.text);
     }
     
-    // Verification periodique
-    static unsigned long lastCheckMode = 0;
-    if (now - lastCheckMode > 2000) {
-        lastCheckMode = now;
-        
-        if (!radio_receiveMode) {
-            ensureReceiveMode();
+    // ADR: plus rien recu sur le SF recommande, retour au profil commun.
+    if (rxSpreadingFactor != RUCHE_ADR_DEFAULT_SF && lastLoraPacketMs > 0 &&
+        (now - lastLoraPacketMs) > ADR_RX_FALLBACK_MS) {
+        Serial.println("ADR: lien perdu, retour au SF par defaut");
+        for (uint16_t i = 0; i < NODE_TABLE_CAPACITY; i++) {
+            if (!nodes.used[i]) continue;
+            nodes.values[i].adrSetting = rucheAdrDefault();
+            nodes.values[i].adrLink.reset();
         }
+        setReceiveSpreadingFactor(RUCHE_ADR_DEFAULT_SF);
     }
-    
+
     // Mise a jour affichage
     static unsigned long lastDisplay = 0;
     if (now - lastDisplay > DISPLAY_REFRESH_MS) {
         lastDisplay = now;
-        updateAlertStates(now);
-        if ((lastLoraPacketMs > 0) && ((now - lastLoraPacketMs) > OLED_IDLE_SLEEP_MS) && !alertSignalLost) {
+        if ((lastLoraPacketMs > 0) && ((now - lastLoraPacketMs) > OLED_IDLE_SLEEP_MS) && !anySignalLost()) {
             setOledSleep(true);
         }
+        // Une page par noeud, en rotation.
+        if (nodes.count > 1 && (now - lastDisplayPageMs) >= DISPLAY_PAGE_MS) {
+            lastDisplayPageMs = now;
+            displaySlot = nodes.nextUsed(displaySlot);
+        }
         updateDisplay();
     }
     
-    delay(5);
+    // Reveil immediat par taskRadio quand une trame arrive.
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOOP_IDLE_MS));
 }
 
 